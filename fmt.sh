@@ -2,7 +2,62 @@
 uncrustify -c fmt.cfg --replace src/main.c
 uncrustify -c fmt.cfg --replace src/util.c
 uncrustify -c fmt.cfg --replace src/viewport.c
+uncrustify -c fmt.cfg --replace src/spatial.c
+uncrustify -c fmt.cfg --replace src/store.c
+uncrustify -c fmt.cfg --replace src/cull.c
+uncrustify -c fmt.cfg --replace src/grid.c
+uncrustify -c fmt.cfg --replace src/redraw.c
+uncrustify -c fmt.cfg --replace src/labelcache.c
+uncrustify -c fmt.cfg --replace src/cluster.c
+uncrustify -c fmt.cfg --replace src/scenefile.c
+uncrustify -c fmt.cfg --replace src/pick.c
+uncrustify -c fmt.cfg --replace src/synth.c
+uncrustify -c fmt.cfg --replace src/bench.c
+uncrustify -c fmt.cfg --replace src/timing.c
+uncrustify -c fmt.cfg --replace src/profiler.c
+uncrustify -c fmt.cfg --replace src/arena.c
+uncrustify -c fmt.cfg --replace src/adjacency.c
+uncrustify -c fmt.cfg --replace src/layout.c
+uncrustify -c fmt.cfg --replace src/journal.c
+uncrustify -c fmt.cfg --replace src/storage.c
+uncrustify -c fmt.cfg --replace src/selection.c
+uncrustify -c fmt.cfg --replace src/spritebatch.c
+uncrustify -c fmt.cfg --replace src/edgedensity.c
+uncrustify -c fmt.cfg --replace src/pager.c
+uncrustify -c fmt.cfg --replace src/pathfind.c
+uncrustify -c fmt.cfg --replace src/pacer.c
+uncrustify -c fmt.cfg --replace src/importer.c
+uncrustify -c fmt.cfg --replace src/pngwriter.c
+uncrustify -c fmt.cfg --replace src/export.c
+uncrustify -c fmt.cfg --replace src/minimap.c
 
 # Format header files
 uncrustify -c fmt.cfg --replace include/viewport.h
-uncrustify -c fmt.cfg --replace include/util.h
\ No newline at end of file
+uncrustify -c fmt.cfg --replace include/util.h
+uncrustify -c fmt.cfg --replace include/spatial.h
+uncrustify -c fmt.cfg --replace include/store.h
+uncrustify -c fmt.cfg --replace include/cull.h
+uncrustify -c fmt.cfg --replace include/grid.h
+uncrustify -c fmt.cfg --replace include/redraw.h
+uncrustify -c fmt.cfg --replace include/labelcache.h
+uncrustify -c fmt.cfg --replace include/cluster.h
+uncrustify -c fmt.cfg --replace include/scenefile.h
+uncrustify -c fmt.cfg --replace include/pick.h
+uncrustify -c fmt.cfg --replace include/synth.h
+uncrustify -c fmt.cfg --replace include/timing.h
+uncrustify -c fmt.cfg --replace include/profiler.h
+uncrustify -c fmt.cfg --replace include/arena.h
+uncrustify -c fmt.cfg --replace include/adjacency.h
+uncrustify -c fmt.cfg --replace include/layout.h
+uncrustify -c fmt.cfg --replace include/journal.h
+uncrustify -c fmt.cfg --replace include/storage.h
+uncrustify -c fmt.cfg --replace include/selection.h
+uncrustify -c fmt.cfg --replace include/spritebatch.h
+uncrustify -c fmt.cfg --replace include/edgedensity.h
+uncrustify -c fmt.cfg --replace include/pager.h
+uncrustify -c fmt.cfg --replace include/pathfind.h
+uncrustify -c fmt.cfg --replace include/pacer.h
+uncrustify -c fmt.cfg --replace include/importer.h
+uncrustify -c fmt.cfg --replace include/pngwriter.h
+uncrustify -c fmt.cfg --replace include/export.h
+uncrustify -c fmt.cfg --replace include/minimap.h
\ No newline at end of file
@@ -0,0 +1,130 @@
+/**
+ * Adjacency index from objects to the connections touching them, so that
+ * the edges of one node can be found in O(degree) instead of by scanning
+ * every connection.
+ *
+ * The bulk of the index is a compressed sparse row (CSR) array: the edges of
+ * every object slot packed back to back, with an offset per slot. Edges
+ * added since it was built go into a small delta log, chained per slot.
+ * Removed edges aren't taken out; their handles go stale and queries skip
+ * them. Once the delta log and the stale edges grow past a fraction of the
+ * index, it is compacted by rebuilding the CSR from the connection store.
+ *
+ * The index also keeps a hash set of connected object pairs, to tell in O(1)
+ * whether two objects are already connected in either direction. Each pair
+ * remembers one of its connections. Pairs can be joined by more than one
+ * connection, so once the remembered one is removed, looking the pair up
+ * scans the edges of its less connected end for another.
+ */
+#ifndef ADJACENCY_H
+#define ADJACENCY_H
+
+#include <stdint.h>
+#include "store.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Compact once the delta log and stale edges make up this fraction of the
+// CSR edges, but never before there are ADJACENCY_MIN_DELTA of them
+#define ADJACENCY_DELTA_FRACTION 8
+#define ADJACENCY_MIN_DELTA      1024
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * An edge added since the last compaction.
+ */
+struct adjacencyDelta {
+    struct handle con;
+
+    // Next delta of the same object slot, or STORE_NONE
+    uint32_t      next;
+};
+
+/**
+ * Entry of the connected pair set. The pair is stored lowest slot first;
+ * con.index is STORE_NONE for an empty entry. Entries stay when their
+ * connection is removed, so a stale con means the pair was connected at
+ * some point since the last compaction.
+ */
+struct adjacencyPair {
+    struct handle a, b;
+    struct handle con;
+};
+
+struct adjacencyIndex {
+    // CSR base: the edges of slot s are edges[offsets[s]..offsets[s + 1])
+    uint32_t *              offsets;
+    uint32_t                slotCount;
+    struct handle *         edges;
+    uint32_t                edgesLen;
+
+    // Delta log, with the newest delta of every slot in deltaHead
+    struct adjacencyDelta * deltas;
+    uint32_t                deltasLen;
+    uint32_t                deltasCap;
+    uint32_t *              deltaHead;
+    uint32_t                deltaHeadCap;
+
+    // Edges removed since the last compaction
+    uint32_t                removed;
+
+    // Open addressing set of connected pairs
+    struct adjacencyPair *  pairs;
+    uint32_t                pairsCap;
+    uint32_t                pairsLen;
+};
+
+/**
+ * Called once for every live connection touching the queried object. The
+ * index isn't changed by removing connections, so the visitor may remove
+ * the connection it is given.
+ */
+typedef void (*adjacencyVisitor)(struct handle con, void * ctx);
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void adjacencyInit(struct adjacencyIndex * index);
+
+void adjacencyFree(struct adjacencyIndex * index);
+
+/**
+ * Rebuilds the whole index from the connection store, e.g. after
+ * connections were added to the store in bulk.
+ */
+void adjacencyRebuild(struct adjacencyIndex * index,
+  struct connectionStore * cons);
+
+/**
+ * Records a connection just added to the store. May compact the index.
+ */
+void adjacencyAdd(struct adjacencyIndex * index, struct connectionStore * cons,
+  struct handle con);
+
+/**
+ * Records that a connection was removed from the store, so that the stale
+ * entries it leaves behind count towards the next compaction.
+ */
+void adjacencyRemove(struct adjacencyIndex * index);
+
+/**
+ * Visits every live connection with obj as its source or destination.
+ */
+void adjacencyQuery(struct adjacencyIndex * index,
+  struct connectionStore * cons, struct handle obj, adjacencyVisitor visit,
+  void * ctx);
+
+/**
+ * Returns the handle of a live connection between a and b in either
+ * direction, or NULL_HANDLE if they aren't connected.
+ */
+struct handle adjacencyFind(struct adjacencyIndex * index,
+  struct connectionStore * cons, struct handle a, struct handle b);
+
+#endif // ADJACENCY_H
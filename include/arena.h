@@ -0,0 +1,69 @@
+/**
+ * String arena with interning, used for object and connection labels.
+ *
+ * Strings are copied into large blocks instead of getting a heap allocation
+ * each, and interning the same text twice returns the same pointer, so
+ * identical labels share storage. Strings live until the arena is cleared or
+ * freed; there is no way to release a single one.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define ARENA_BLOCK_SIZE (256 * 1024)
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * A block of string storage. Blocks are chained newest first.
+ */
+struct arenaBlock {
+    struct arenaBlock * next;
+    size_t              used;
+    size_t              size;
+    char                data[];
+};
+
+struct internEntry {
+    // Interned string, NULL for an empty slot
+    const char * text;
+    uint32_t     hash;
+};
+
+struct stringArena {
+    struct arenaBlock *  blocks;
+
+    // Open addressing hash table of every string in the arena
+    struct internEntry * entries;
+    uint32_t             entriesCap;
+    uint32_t             entriesLen;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void stringArenaInit(struct stringArena * arena);
+
+void stringArenaFree(struct stringArena * arena);
+
+/**
+ * Releases every string at once, keeping one block around for reuse. All
+ * pointers handed out before become invalid.
+ */
+void stringArenaClear(struct stringArena * arena);
+
+/**
+ * Returns the arena's copy of text, adding it if it isn't there yet. NULL
+ * stays NULL.
+ */
+const char * stringArenaIntern(struct stringArena * arena, const char * text);
+
+#endif // ARENA_H
@@ -0,0 +1,86 @@
+/**
+ * Multi-resolution clustering of object positions, for drawing the plane
+ * when it is zoomed too far out to show individual objects.
+ *
+ * Level 0 groups objects into square cells CLUSTER_BASE_CELL wide, and every
+ * level above doubles the cell size. Each cell keeps how many objects it
+ * holds and the sum of their positions, so the cluster centroid is known
+ * without visiting the objects. Cells are updated as objects are added,
+ * moved and removed, so nothing needs recomputing when the view changes.
+ */
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stdint.h>
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define CLUSTER_LEVELS    12
+#define CLUSTER_BASE_CELL 200
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct clusterCell {
+    int      cy, cx;
+    uint32_t count;
+    int64_t  sumY, sumX;
+    uint8_t  used;
+};
+
+/**
+ * One level of the hierarchy: an open addressing table of cells.
+ */
+struct clusterLevel {
+    int                  cellSize;
+    struct clusterCell * cells;
+    uint32_t             cap;
+    uint32_t             len;
+};
+
+struct clusterIndex {
+    struct clusterLevel levels[CLUSTER_LEVELS];
+};
+
+/**
+ * Called once per non-empty cell found by clusterQuery(), with the cluster's
+ * centroid in world coordinates.
+ */
+typedef void (*clusterVisitor)(int y, int x, uint32_t count, void * ctx);
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void clusterIndexInit(struct clusterIndex * index);
+
+void clusterIndexFree(struct clusterIndex * index);
+
+/**
+ * Empties every level but keeps the tables allocated.
+ */
+void clusterIndexClear(struct clusterIndex * index);
+
+void clusterAdd(struct clusterIndex * index, int y, int x);
+
+void clusterRemove(struct clusterIndex * index, int y, int x);
+
+void clusterMove(struct clusterIndex * index, int oldY, int oldX, int newY,
+  int newX);
+
+/**
+ * Picks the finest level whose cells are at least minPixels wide on screen
+ * at the given zoom.
+ */
+int clusterLevelFor(float scale, int minPixels);
+
+/**
+ * Visits the non-empty cells of a level overlapping the world rectangle
+ * [minY, maxY] x [minX, maxX].
+ */
+void clusterQuery(struct clusterIndex * index, int level, int minY, int minX,
+  int maxY, int maxX, clusterVisitor visit, void * ctx);
+
+#endif // CLUSTER_H
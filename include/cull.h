@@ -0,0 +1,83 @@
+/**
+ * Culling pass which works out, once per frame, which objects and which
+ * parts of which connections can actually be seen in the viewport. The
+ * drawing functions then only go through this visible set.
+ *
+ * Every object is projected exactly once per pass, a chunk at a time with
+ * projectBatch(), into arrays indexed like the store; the connections take
+ * their ends from there instead of projecting them again.
+ */
+#ifndef CULL_H
+#define CULL_H
+
+#include <stdint.h>
+#include "viewport.h"
+#include "store.h"
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * An object to draw, with its position already projected to render texture
+ * coordinates (and clamped to the border if it is sticky and offscreen).
+ */
+struct visibleObject {
+    uint32_t dense;
+    float    x, y;
+};
+
+/**
+ * A connection clipped to the viewport, in render texture coordinates.
+ */
+struct visibleConnection {
+    uint32_t dense;
+    float    x0, y0;
+    float    x1, y1;
+};
+
+struct visibleSet {
+    struct visibleObject *     objects;
+    uint32_t                   objectsLen;
+    uint32_t                   objectsCap;
+
+    struct visibleConnection * connections;
+    uint32_t                   connectionsLen;
+    uint32_t                   connectionsCap;
+
+    // Connections left out for being shorter than a pixel
+    uint32_t                   connectionsElided;
+
+    // Every object's projected position by dense index, and whether it
+    // overlaps the screen, as of the last pass
+    float *                    projectedY;
+    float *                    projectedX;
+    uint8_t *                  onScreen;
+    uint32_t                   projectedCap;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void visibleSetInit(struct visibleSet * set);
+
+void visibleSetFree(struct visibleSet * set);
+
+/**
+ * Rebuilds the visible set for the current viewport. margin is added around
+ * every object's radius, to cover things drawn bigger than their radius such
+ * as sprites. Connections shorter than a pixel on screen are left out.
+ */
+void buildVisibleSet(struct visibleSet * set, struct viewport * vp,
+  struct objectStore * objs, struct connectionStore * cons, int margin);
+
+/**
+ * Cohen-Sutherland line clipping against the rectangle
+ * [minX, maxX] x [minY, maxY]. Moves the endpoints onto the rectangle and
+ * returns 1 if any part of the line is inside, else returns 0.
+ */
+int clipLine(float minX, float minY, float maxX, float maxY, float * x0,
+  float * y0, float * x1, float * y1);
+
+#endif // CULL_H
@@ -0,0 +1,67 @@
+/**
+ * Edge density image, drawn in place of individual connections when there
+ * are too many on screen to tell apart. Visible connections are rasterized
+ * into a grid of hit counts at a fraction of the screen resolution, and the
+ * counts are shaded into an image whose darkness grows with the log of the
+ * number of edges crossing each pixel.
+ *
+ * The rasterizing work is capped at a budget of pixel steps: past it, only
+ * every n-th connection is drawn, counting n times, which keeps the overall
+ * picture while bounding the cost.
+ */
+#ifndef EDGEDENSITY_H
+#define EDGEDENSITY_H
+
+#include <stdint.h>
+#include "raylib.h"
+#include "cull.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Pixel steps rasterized per build at most
+#define EDGE_DENSITY_BUDGET 2000000
+
+// Alpha of a pixel crossed by one edge; each doubling adds as much again
+#define EDGE_DENSITY_ALPHA  48
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct edgeDensity {
+    // Image size, the screen size shifted right by shift
+    int        w, h;
+    int        shift;
+
+    uint32_t * counts;
+
+    // Shaded image, w x h, ready to upload as an RGBA texture
+    Color *    pixels;
+
+    // Every stride-th connection went into the last build
+    uint32_t   stride;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Sets up an image for a screen of screenW x screenH pixels, at 1 / 2^shift
+ * of its resolution.
+ */
+void edgeDensityInit(struct edgeDensity * density, int screenW, int screenH,
+  int shift);
+
+void edgeDensityFree(struct edgeDensity * density);
+
+/**
+ * Rasterizes the visible connections, which are clipped to the screen, and
+ * shades the pixels with color.
+ */
+void edgeDensityBuild(struct edgeDensity * density,
+  const struct visibleConnection * cons, uint32_t n, Color color);
+
+#endif // EDGEDENSITY_H
@@ -0,0 +1,101 @@
+/**
+ * Scene export to PNG and SVG, at any resolution and without a window or a
+ * GPU, for poster sized images of large graphs from batch jobs.
+ *
+ * PNG export rasterizes the scene on the CPU in bands of EXPORT_TILE_SIZE
+ * rows, each split into square tiles that a pool of worker threads draws
+ * in parallel. While the workers draw one band, the calling thread feeds
+ * the one before it to the streaming PNG encoder, so only two bands of the
+ * image are ever in memory. Connections are antialiased lines with round
+ * ends and objects are antialiased discs; sprites, which need their image,
+ * are drawn as discs too, and labels are left out, as there is no font to
+ * draw them with here. Under emscripten there are no threads and tiles are
+ * drawn one after the other.
+ *
+ * SVG export streams the same primitives, plus labels, in world units
+ * straight to the file.
+ *
+ * Given the pager, the objects and connections paged out are read from
+ * their pages as well, so a paged scene exports whole without being
+ * brought back into memory. Pass NULL when not paging.
+ */
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stdint.h>
+#include "store.h"
+#include "pager.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Side of a tile, and height of a band, in pixels
+#define EXPORT_TILE_SIZE     256
+#define EXPORT_MAX_WORKERS   8
+
+// Largest image side, well past any printer
+#define EXPORT_MAX_SIDE      65536
+
+// Room left around the objects when exporting the whole scene, in world
+// units
+#define EXPORT_MARGIN        50
+
+// Radius sprites are drawn with, in world units
+#define EXPORT_SPRITE_RADIUS 16
+
+// Label size in SVG exports, in pixels at the exported width
+#define EXPORT_LABEL_SIZE    10
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * A world rectangle, top left corner and size.
+ */
+struct exportRect {
+    float y, x;
+    float h, w;
+};
+
+struct exportStats {
+    uint32_t width;
+    uint32_t height;
+    uint32_t tiles;
+    int      workers;
+
+    // Drawn, after culling to the rectangle
+    uint32_t objects;
+    uint32_t connections;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Sets rect to the bounds of all objects, with EXPORT_MARGIN around them.
+ */
+void exportSceneBounds(struct objectStore * objs, struct pager * pager,
+  struct exportRect * rect);
+
+/**
+ * Writes the part of the scene inside rect to a PNG at path, width pixels
+ * wide and as high as keeps rect's aspect. A rect too tall for that to fit
+ * in EXPORT_MAX_SIDE rows is drawn narrower instead; stats has the size
+ * used. Returns 0 on success.
+ */
+int exportPng(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, struct pager * pager,
+  const struct exportRect * rect, uint32_t width, struct exportStats * stats);
+
+/**
+ * Writes the part of the scene inside rect to an SVG at path, sized like
+ * exportPng() would. Returns 0 on success.
+ */
+int exportSvg(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, struct pager * pager,
+  const struct exportRect * rect, uint32_t width, struct exportStats * stats);
+
+#endif // EXPORT_H
@@ -0,0 +1,50 @@
+/**
+ * Background gridline renderer. The dotted grid is rasterized once into a
+ * sheet slightly larger than the viewport, and every frame draws the part of
+ * that sheet lined up with the viewport in a single call. Panning only moves
+ * the source rectangle; the sheet is rebuilt when the viewport is resized or
+ * the on-screen grid spacing changes.
+ */
+#ifndef GRID_H
+#define GRID_H
+
+#include "raylib.h"
+#include "viewport.h"
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct gridRenderer {
+    // Grid spacing in world units
+    int       spacing;
+
+    // Length of each dash and each gap, in pixels
+    int       segLength;
+
+    Color     color;
+
+    // Sheet and the viewport size and spacing in pixels it was built for
+    Texture2D sheet;
+    int       sheetW, sheetH;
+    int       step;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Sets up the renderer. The sheet is built lazily on the first draw.
+ */
+void gridRendererInit(struct gridRenderer * grid, int spacing, int segLength,
+  Color color);
+
+/**
+ * Draws the gridlines for the viewport into the current render target.
+ */
+void gridRendererDraw(struct gridRenderer * grid, struct viewport * vp);
+
+void gridRendererUnload(struct gridRenderer * grid);
+
+#endif // GRID_H
@@ -0,0 +1,89 @@
+/**
+ * Graph importer for edge lists, CSV and a subset of Graphviz DOT.
+ *
+ * The file is read in chunks of IMPORT_CHUNK_SIZE bytes, cut at line ends,
+ * and the chunks are parsed in parallel by a pool of worker threads while
+ * the next ones are read. Node names are resolved with a hash map split
+ * into IMPORT_SHARDS shards, each behind its own lock, so workers only
+ * contend when they hit the same shard at the same moment. Once the whole
+ * file is parsed, nodes are numbered in the order they first appear in the
+ * file and everything is added to the stores in one go, in file order, with
+ * the nodes laid out on a grid for the auto-layout to untangle. The same
+ * file always comes out the same, however the chunks were shared out.
+ * Under emscripten, or if no thread can be started, the chunks are parsed
+ * as they are read.
+ *
+ * Formats, one record per line:
+ *
+ *   - Edge list: "a b", whitespace separated. Anything after the second
+ *     name, like a weight, is ignored, a lone name is a node without edges
+ *     and lines starting with # or % are comments.
+ *   - CSV: "a,b" with optional double quoted fields. A first line naming
+ *     its columns (source, target, from, to...) is skipped.
+ *   - DOT: node statements "a;" and edge chains "a -> b -> c;" or with --,
+ *     several to a line. Attribute lists, graph, node and edge defaults,
+ *     assignments like "rankdir=LR", braces and comments are skipped.
+ *     Statements may not span lines, and subgraphs as edge ends aren't
+ *     supported.
+ */
+#ifndef IMPORTER_H
+#define IMPORTER_H
+
+#include <stdint.h>
+#include "store.h"
+#include "arena.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+#define IMPORT_CHUNK_SIZE  (4 * 1024 * 1024)
+#define IMPORT_SHARDS      64
+#define IMPORT_MAX_WORKERS 8
+
+// Chunks read ahead of the workers at most, per worker
+#define IMPORT_QUEUE_DEPTH 2
+
+// Spacing of the grid imported nodes are placed on, in world units
+#define IMPORT_SPACING     200
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum importFormat {
+    IMPORT_EDGE_LIST,
+    IMPORT_CSV,
+    IMPORT_DOT
+};
+
+struct importStats {
+    uint64_t bytes;
+    uint32_t nodes;
+    uint32_t edges;
+
+    // Lines that had something on them but no node
+    uint32_t skipped;
+    int      workers;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Guesses the format from the file name: .csv, .dot or .gv, and an edge
+ * list for anything else.
+ */
+enum importFormat importFormatFromPath(const char * path);
+
+/**
+ * Adds the graph in the file at path to the stores, interning node names
+ * as labels. Returns 0 on success, or -1 if the file couldn't be read, in
+ * which case the stores are untouched.
+ */
+int importGraph(const char * path, enum importFormat format,
+  struct objectStore * objs, struct connectionStore * cons,
+  struct stringArena * labels, struct importStats * stats);
+
+#endif // IMPORTER_H
@@ -0,0 +1,164 @@
+/**
+ * Autosave journal. Edits are appended to a journal file as small records
+ * instead of rewriting the whole scene, so autosaving costs as much as the
+ * edit rather than the scene. Every so often the scene is checkpointed into
+ * a full scene file and the journal starts over.
+ *
+ *   checkpoint  a scene file (see scenefile.h) with checkpoint number n
+ *   journal     struct journalHeader with the same n, then records
+ *
+ * Each record is a struct journalRecord followed by its payload, and carries
+ * a checksum so that a record torn by a crash ends the replay instead of
+ * being applied. A journal whose number doesn't match the checkpoint's was
+ * left over from before the checkpoint and is ignored.
+ *
+ * Records are written out once per frame. While edits keep coming they are
+ * synced to disk at most every JOURNAL_SYNC_MS, so a burst of edits costs
+ * one sync, and the first frame without new edits syncs the rest at once.
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "store.h"
+#include "arena.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define JOURNAL_MAGIC            "CVJL"
+#define JOURNAL_VERSION          1
+#define JOURNAL_SYNC_MS          1000
+
+// Checkpoint once the journal outgrows the last checkpoint, but not before
+// it reaches this size
+#define JOURNAL_MIN_CHECKPOINT   (1 << 20)
+
+// Label length meaning "no label"
+#define JOURNAL_NO_LABEL         UINT16_MAX
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum journalOp {
+    JOURNAL_ADD = 1,
+    JOURNAL_MOVE,
+    JOURNAL_CONNECT,
+    JOURNAL_RELABEL,
+    JOURNAL_DELETE
+};
+
+struct journalHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t checkpoint;
+    uint32_t reserved;
+};
+
+struct journalRecord {
+    uint16_t op;
+
+    // Payload bytes after this header
+    uint16_t length;
+
+    // FNV-1a over the op, length and payload
+    uint32_t checksum;
+};
+
+/**
+ * Applies replayed records. Labels point into a temporary buffer and have to
+ * be copied (interned) by the callee. loaded is called once the checkpoint is
+ * in the stores, before any record, to build whatever the others rely on.
+ */
+struct journalHandler {
+    void (*loaded)(void * ctx);
+    void (*add)(struct handle h, struct object obj, void * ctx);
+    void (*move)(struct handle h, int y, int x, void * ctx);
+    void (*connect)(struct connection con, void * ctx);
+    void (*relabel)(struct handle h, const char * label, void * ctx);
+    void (*remove)(struct handle h, void * ctx);
+};
+
+struct journal {
+    char *    scenePath;
+    char *    journalPath;
+    FILE *    file;
+    uint32_t  checkpoint;
+
+    // Set while replaying, so the edits being replayed aren't journaled
+    // all over again
+    int       replaying;
+
+    // Encoded records not yet written to the file
+    uint8_t * pending;
+    size_t    pendingLen;
+    size_t    pendingCap;
+
+    // Bytes in the journal, and the rough size of the last checkpoint
+    size_t    bytes;
+    size_t    checkpointBytes;
+
+    int       unsynced;
+    double    lastSync;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Sets up a journal next to the checkpoint at scenePath. Nothing is written
+ * until journalCheckpoint() or journalRecover().
+ */
+void journalInit(struct journal * j, const char * scenePath);
+
+/**
+ * Flushes and syncs anything pending, and closes the journal.
+ */
+void journalClose(struct journal * j);
+
+/**
+ * Loads the last checkpoint into the (empty) stores and replays the journal
+ * on top through the handler, after which new records are appended to it.
+ * Returns 0 on success, -1 if there is no usable checkpoint.
+ */
+int journalRecover(struct journal * j, struct objectStore * objs,
+  struct connectionStore * cons, struct stringArena * labels,
+  const struct journalHandler * handler, void * ctx);
+
+/**
+ * Saves the whole scene as a new checkpoint and starts an empty journal.
+ * Returns 0 on success.
+ */
+int journalCheckpoint(struct journal * j, struct objectStore * objs,
+  struct connectionStore * cons);
+
+/**
+ * Writes out pending records, syncs if the last sync was long enough ago or
+ * there was nothing new to write, and checkpoints if the journal has grown
+ * too big. Call once per frame with the current time in seconds.
+ */
+void journalTick(struct journal * j, struct objectStore * objs,
+  struct connectionStore * cons, double now);
+
+/**
+ * Returns 1 while some records aren't on disk yet. A caller that sleeps
+ * until the next input event has to keep ticking until this is 0, or the
+ * last edits wait for that event to be synced.
+ */
+int journalUnsynced(struct journal * j);
+
+void journalAdd(struct journal * j, struct handle h, struct object obj);
+
+void journalMove(struct journal * j, struct handle h, int y, int x);
+
+void journalConnect(struct journal * j, struct connection con);
+
+void journalRelabel(struct journal * j, struct handle h, const char * label);
+
+void journalDelete(struct journal * j, struct handle h);
+
+#endif // JOURNAL_H
@@ -0,0 +1,98 @@
+/**
+ * Label cache. Each distinct label text is rasterized once into a shared
+ * atlas texture and drawn from there afterwards, so all labels go out as
+ * quads from a single texture instead of laying out glyphs every frame.
+ *
+ * Label placement also does level of detail: labels are placed into a
+ * screen-space occupancy grid and any label landing on cells already taken
+ * is left out, as are all labels once they would be too small to read.
+ */
+#ifndef LABELCACHE_H
+#define LABELCACHE_H
+
+#include <stdint.h>
+#include "raylib.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define LABEL_OCCUPANCY_CELL 8
+#define LABEL_MIN_FONT_SIZE  8
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct labelEntry {
+    // Owned copy of the text, NULL for an empty slot
+    char *    text;
+    uint32_t  hash;
+
+    // Where the text sits in the atlas
+    Rectangle rec;
+};
+
+struct placedLabel {
+    const char * text;
+    Rectangle    src;
+    Rectangle    dest;
+};
+
+struct labelCache {
+    Texture2D            atlas;
+    int                  atlasSize;
+
+    // Size the labels are rasterized at
+    int                  fontSize;
+
+    // Shelf packing cursor
+    int                  shelfX, shelfY, shelfH;
+
+    // Open addressing hash table of rasterized labels
+    struct labelEntry *  entries;
+    uint32_t             entriesCap;
+    uint32_t             entriesLen;
+
+    // Occupancy grid for the current layout, one byte per cell
+    uint8_t *            occupied;
+    int                  gridW, gridH;
+
+    // Labels placed by the current layout
+    struct placedLabel * placed;
+    uint32_t             placedLen;
+    uint32_t             placedCap;
+    uint32_t             suppressed;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Creates the atlas. Needs a window, since it allocates a texture.
+ */
+void labelCacheInit(struct labelCache * cache, int atlasSize, int fontSize);
+
+void labelCacheUnload(struct labelCache * cache);
+
+/**
+ * Starts a new layout for a screen of the given size, clearing the
+ * occupancy grid and the placed labels.
+ */
+void labelCacheBeginLayout(struct labelCache * cache, int screenW,
+  int screenH);
+
+/**
+ * Tries to place a label with its top left corner at (x, y), drawn at the
+ * given font size. Returns 1 if it was placed, or 0 if it was suppressed for
+ * overlapping an earlier label or being too small.
+ */
+int labelCachePlace(struct labelCache * cache, const char * text, float x,
+  float y, float fontSize);
+
+/**
+ * Draws every label placed by the current layout.
+ */
+void labelCacheDraw(struct labelCache * cache, Color tint);
+
+#endif // LABELCACHE_H
@@ -0,0 +1,205 @@
+/**
+ * Force-directed auto-layout. Connected objects pull together like springs
+ * and every pair of objects pushes apart, with the pushing approximated by
+ * Barnes-Hut: objects are bucketed into a quadtree and far away cells act
+ * as one body at their centre of mass, so a step costs O(n log n) instead
+ * of O(n^2). Displacements are capped by a temperature that cools every
+ * step until the layout has converged.
+ *
+ * The simulation runs on its own thread, with the per-object work split
+ * across a pool of workers. It works on a snapshot of the graph and never
+ * touches the stores. Positions are double buffered: the simulation reads
+ * the front buffer and writes the back one, then swaps them, so the game
+ * loop can copy out the latest complete step at any time. Under emscripten,
+ * or if the simulation thread can't be started, layoutSync() runs one step
+ * per frame instead.
+ */
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+#include "store.h"
+
+#ifndef __EMSCRIPTEN__
+# define LAYOUT_THREADS
+# include <pthread.h>
+#endif
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Distance connected objects settle at, in world units
+#define LAYOUT_EDGE_LENGTH     150.0f
+
+// Barnes-Hut accuracy: cells smaller than this times their distance are
+// treated as one body
+#define LAYOUT_THETA           0.8f
+
+// Pull towards the centre of mass, keeping disconnected parts together
+#define LAYOUT_GRAVITY         0.02f
+
+#define LAYOUT_COOLING         0.985f
+#define LAYOUT_MIN_TEMPERATURE 0.5f
+
+// Coincident objects stop being split this deep in the quadtree
+#define LAYOUT_MAX_DEPTH       24
+#define LAYOUT_MAX_WORKERS     8
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * Quadtree cell. A leaf holds one body, or several coincident ones at
+ * LAYOUT_MAX_DEPTH; the sums give the centre of mass.
+ */
+struct layoutCell {
+    float    cy, cx, half;
+    float    sumY, sumX;
+    uint32_t count;
+
+    // Body of a leaf, STORE_NONE for an inner cell
+    uint32_t body;
+    int32_t  child[4];
+};
+
+/**
+ * A change requested from the game loop, applied before the next step.
+ */
+struct layoutCommand {
+    uint32_t node;
+
+    // 1 or 0 to pin or unpin, -1 to leave as is
+    int      pin;
+    int      move;
+    float    y, x;
+
+    // Warm the whole layout up, with node STORE_NONE
+    int      reheat;
+};
+
+struct layoutWorker {
+    struct layoutEngine * engine;
+    int                   index;
+    #ifdef LAYOUT_THREADS
+        pthread_t         thread;
+    #endif
+};
+
+struct layoutEngine {
+    int                    running;
+    int                    paused;
+    int                    converged;
+    float                  temperature;
+
+    // Snapshot of the graph. Nodes are numbered by dense position at the
+    // time of the snapshot; nodeOfSlot maps object slots back to them.
+    uint32_t               nodeCount;
+    struct handle *        handles;
+    uint32_t *             nodeOfSlot;
+    uint32_t               slotCount;
+    uint32_t *             neighborOffsets;
+    uint32_t *             neighbors;
+
+    // Pins as the simulation sees them, and as the game loop set them
+    uint8_t *              pinned;
+    uint8_t *              uiPinned;
+
+    // y, x pairs. front and back swap under the lock; shown is the game
+    // loop's copy of the last published step.
+    float *                front;
+    float *                back;
+    float *                shown;
+    uint32_t               version;
+    uint32_t               syncedVersion;
+
+    struct layoutCommand * commands;
+    uint32_t               commandsLen;
+    uint32_t               commandsCap;
+
+    struct layoutCell *    cells;
+    uint32_t               cellsLen;
+    uint32_t               cellsCap;
+
+    struct layoutWorker    workers[LAYOUT_MAX_WORKERS];
+    int                    workerCount;
+
+    #ifdef LAYOUT_THREADS
+        // Whether the simulation runs on its own thread
+        int                threaded;
+        pthread_t          thread;
+        pthread_mutex_t    lock;
+
+        // Signalled on commands, resume and stop, to wake an idle simulation
+        pthread_cond_t     wake;
+        pthread_cond_t     workReady;
+        pthread_cond_t     workDone;
+        uint32_t           jobGeneration;
+        int                jobsPending;
+        int                quit;
+    #endif
+};
+
+/**
+ * Called by layoutSync() for every unpinned object, with its new position.
+ */
+typedef void (*layoutVisitor)(struct handle obj, int y, int x, void * ctx);
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void layoutInit(struct layoutEngine * layout);
+
+/**
+ * Snapshots the stores and starts the simulation from the objects' current
+ * positions. If it is already running it is restarted on the new snapshot,
+ * keeping the pins of objects that are still there and the temperature, so
+ * a settled layout stays settled.
+ */
+void layoutStart(struct layoutEngine * layout, struct objectStore * objs,
+  struct connectionStore * cons);
+
+/**
+ * Stops the simulation, waits for its threads and frees the snapshot.
+ */
+void layoutStop(struct layoutEngine * layout);
+
+void layoutSetPaused(struct layoutEngine * layout, int paused);
+
+/**
+ * Returns 1 while the simulation is running, not paused and not converged,
+ * i.e. while positions keep changing.
+ */
+int layoutActive(struct layoutEngine * layout);
+
+/**
+ * Pins or unpins an object. Pinned objects feel no forces and stay where
+ * the game loop puts them.
+ */
+void layoutPin(struct layoutEngine * layout, struct handle obj, int pinned);
+
+int layoutIsPinned(struct layoutEngine * layout, struct handle obj);
+
+/**
+ * Tells the simulation an object was moved by hand, and warms the layout up
+ * again so its neighbours follow.
+ */
+void layoutMove(struct layoutEngine * layout, struct handle obj, int y,
+  int x);
+
+/**
+ * Warms a settled layout up again after the graph was edited, so that new
+ * objects find their place and the rest makes room, without shaking up the
+ * whole layout like a fresh start.
+ */
+void layoutReheat(struct layoutEngine * layout);
+
+/**
+ * Hands the newest published positions to visit. Returns 1 if there was a
+ * new step since the last call, else 0 without visiting anything.
+ */
+int layoutSync(struct layoutEngine * layout, layoutVisitor visit, void * ctx);
+
+#endif // LAYOUT_H
@@ -0,0 +1,104 @@
+/**
+ * Minimap of the whole world, drawn from a pyramid of object counts.
+ *
+ * Level 0 counts objects in a MINIMAP_CELLS x MINIMAP_CELLS grid of square
+ * cells over the part of the world the minimap covers, and each level above
+ * halves the resolution. Counts are updated as objects are added, moved and
+ * removed, and so is the pixel of the level 0 image each touched cell
+ * shades, so keeping the minimap current costs a few increments per change
+ * and never a pass over the objects.
+ *
+ * When an object turns up outside the covered square, the square doubles
+ * around its centre. Every cell of the doubled grid's level l is then a
+ * cell of the old grid's level l + 1, so the pyramid is shifted down a
+ * level instead of recounted.
+ */
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <stdint.h>
+#include "raylib.h"
+#include "store.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Level 0 cells per side, and the size of the image
+#define MINIMAP_CELLS     128
+#define MINIMAP_LEVELS    8
+
+// Smallest and largest cell sides of level 0, in world units
+#define MINIMAP_MIN_CELL  16
+#define MINIMAP_MAX_CELL  (1 << 23)
+
+// Alpha of a pixel holding one object; each doubling adds as much again
+#define MINIMAP_ALPHA     64
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct minimap {
+    // Covered square: its top left corner and the side of a level 0 cell
+    int        originY, originX;
+    int        cellSize;
+    int        anchored;
+
+    // Level l holds (MINIMAP_CELLS >> l)^2 counts, row by row
+    uint32_t * counts[MINIMAP_LEVELS];
+
+    // Level 0 shaded, ready to upload as an RGBA texture
+    Color      pixels[MINIMAP_CELLS * MINIMAP_CELLS];
+
+    // Pixels changed since minimapTakeDirty() last returned 1
+    int        dirty;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void minimapInit(struct minimap * map);
+
+void minimapFree(struct minimap * map);
+
+/**
+ * Forgets every object. The next one added decides where the covered
+ * square is.
+ */
+void minimapClear(struct minimap * map);
+
+/**
+ * Clears the minimap and counts every object in the store, covering their
+ * bounds, after objects were added to it in bulk.
+ */
+void minimapRebuild(struct minimap * map, struct objectStore * objs);
+
+void minimapAdd(struct minimap * map, int y, int x);
+
+void minimapRemove(struct minimap * map, int y, int x);
+
+void minimapMove(struct minimap * map, int oldY, int oldX, int newY,
+  int newX);
+
+/**
+ * Returns 1 if the image changed since the last call, clearing the flag.
+ */
+int minimapTakeDirty(struct minimap * map);
+
+/**
+ * Converts a world position to a position on the minimap, as fractions
+ * of its height and width.
+ */
+void minimapFromWorld(struct minimap * map, int y, int x, float * v,
+  float * u);
+
+/**
+ * Converts a position on the minimap, as fractions of its height and width,
+ * to a world position.
+ */
+void minimapToWorld(struct minimap * map, float v, float u, int * y,
+  int * x);
+
+#endif // MINIMAP_H
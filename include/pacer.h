@@ -0,0 +1,110 @@
+/**
+ * Frame pacer and input latency meter. The pacer picks the frame rate to
+ * ask raylib for from a ladder of rates, going by how long frames take to
+ * build: as soon as the smoothed cost stops fitting in the frame budget
+ * with some headroom to spare, it drops to the next slower rate, and it
+ * only climbs back after a good while of frames that would fit the faster
+ * one. A steady slower rate looks smoother than a fast one that keeps
+ * missing its deadline.
+ *
+ * Latency is measured for frames that move something with the mouse, from
+ * when the frame's input was polled, which raylib does at the end of the
+ * previous EndDrawing(), to when the frame is handed to EndDrawing() to be
+ * presented. Input that arrives while the previous frame is still being
+ * built or waited out sits in the queue before that and isn't counted;
+ * at most one frame interval of it.
+ *
+ * Times are in seconds from monotonicSeconds() unless named otherwise.
+ */
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Largest share of the frame budget a frame may take
+#define PACER_HEADROOM        0.8f
+
+// Weight of the newest frame in the smoothed cost
+#define PACER_SMOOTHING       0.1f
+
+// Most a single frame counts for in the smoothed cost, in frame budgets at
+// the current rate, so one stall doesn't drag the rate down the ladder
+#define PACER_SPIKE_BUDGETS   2.0f
+
+// Frames in a row that would fit the next faster rate before moving up
+#define PACER_UP_FRAMES       120
+
+// Drag frames kept for the latency figures
+#define PACER_LATENCY_WINDOW  240
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * Rolling latency figures, in milliseconds.
+ */
+struct pacerLatency {
+    float    avg;
+    float    p99;
+    float    max;
+    uint32_t samples;
+};
+
+struct framePacer {
+    // Index into the ladder of rates of the current target, and the
+    // fastest one allowed
+    int      rung;
+    int      topRung;
+
+    double   frameStart;
+    float    cost;
+    uint32_t fastFrames;
+
+    int      dragging;
+    float    latencies[PACER_LATENCY_WINDOW];
+    uint32_t latencyLen;
+    uint32_t latencyNext;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Starts pacing at maxRate frames per second, which is never exceeded.
+ */
+void pacerInit(struct framePacer * pacer, int maxRate);
+
+/**
+ * Marks the start of a frame, right after the last EndDrawing() polled
+ * input.
+ */
+void pacerBeginFrame(struct framePacer * pacer, double now);
+
+/**
+ * Marks the frame as one that moves something with the mouse.
+ */
+void pacerMarkDrag(struct framePacer * pacer);
+
+/**
+ * Marks the frame as built, right before EndDrawing(). Returns 1 if the
+ * target rate changed, which is then pacerRate().
+ */
+int pacerEndFrame(struct framePacer * pacer, double now);
+
+int pacerRate(struct framePacer * pacer);
+
+/**
+ * Smoothed time it takes to build a frame, in milliseconds.
+ */
+float pacerCost(struct framePacer * pacer);
+
+void pacerLatencyStats(struct framePacer * pacer,
+  struct pacerLatency * stats);
+
+#endif // PACER_H
@@ -0,0 +1,187 @@
+/**
+ * Tile pager, for scenes too big to keep in memory. The world is split into
+ * square tiles lined up with the gridlines, and only the objects in tiles
+ * around the viewport stay in the stores. The rest are evicted into one
+ * page file per tile and restored, under the same handles, once the
+ * viewport comes near again. Tiles ahead of the direction the viewport is
+ * panning in are restored early.
+ *
+ * A connection is paged out with the first of its ends to be evicted, and
+ * comes back once both ends are in memory; if the other end is still
+ * paged out at that point, the connection moves over to that end's page.
+ *
+ * A saved scene can also be loaded straight into pages, so that only the
+ * tiles around the viewport are ever in memory, and saved or exported by
+ * walking the pages instead of bringing them all back.
+ *
+ * Page files are a cache for this run only, in the machine's own byte
+ * order, and are deleted when the pager is cleared.
+ */
+#ifndef PAGER_H
+#define PAGER_H
+
+#include <stdint.h>
+#include "store.h"
+#include "adjacency.h"
+#include "arena.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Tiles kept around the viewport on every side, and the further ring that
+// objects may be in before they are evicted, so that panning back and forth
+// over a tile edge doesn't page the same tile in and out
+#define PAGER_MARGIN_TILES     1
+#define PAGER_HYSTERESIS_TILES 1
+
+// How far ahead of the pan to restore tiles, in seconds of panning
+#define PAGER_PREFETCH_SECONDS 0.5f
+
+// Weight of the newest sample in the smoothed pan velocity
+#define PAGER_VELOCITY_SMOOTHING 0.3f
+
+// Most tiles kept across in either direction, however far out the view is
+#define PAGER_MAX_SPAN         16
+
+// Bytes of records gathered in memory while loading a scene into pages,
+// before they are all written out
+#define PAGER_LOAD_BUFFER      (8 << 20)
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * Called as objects leave and come back, to keep other indexes in step.
+ * Connections are taken care of by the pager. paged is called instead of
+ * evicting for objects loaded straight into a page.
+ */
+struct pagerHandler {
+    void (*evicting)(struct handle h, int y, int x, void * ctx);
+    void (*restored)(struct handle h, struct object obj, void * ctx);
+    void (*paged)(struct handle h, int y, int x, void * ctx);
+};
+
+/**
+ * Called for what is in the pages by pagerWalk(). Labels are only valid
+ * during the call. Connections come with the positions of their ends, which
+ * may be in memory or paged out. Either function may be NULL.
+ */
+struct pagerVisitor {
+    void (*object)(struct handle h, struct object obj, void * ctx);
+    void (*connection)(struct connection con, int srcY, int srcX, int destY,
+      int destX, void * ctx);
+};
+
+struct pagerTile {
+    int ty, tx;
+};
+
+struct pagerHome;
+
+/**
+ * A rectangle of tiles, inclusive.
+ */
+struct pagerRegion {
+    int ty0, tx0;
+    int ty1, tx1;
+};
+
+struct pager {
+    char *             dir;
+
+    // Tile side in world units
+    int                tileSize;
+
+    // Tiles with a page on disk, sorted by (ty, tx)
+    struct pagerTile * paged;
+    uint32_t           pagedLen;
+    uint32_t           pagedCap;
+
+    // Tile and generation of every paged out object, by slot
+    struct pagerHome * homes;
+    uint32_t           homesLen;
+
+    // Tiles kept in memory as of the last update
+    struct pagerRegion kept;
+    int                keptValid;
+
+    // Viewport position and time of the last update, and the smoothed pan
+    // velocity in world units per second
+    float              lastY, lastX;
+    double             lastTime;
+    float              velY, velX;
+
+    // Objects paged out and in so far
+    uint32_t           evicted;
+    uint32_t           restored;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Sets up a pager keeping its pages in dir, which is created if need be.
+ * Returns 0 on success.
+ */
+int pagerInit(struct pager * pager, const char * dir, int tileSize);
+
+/**
+ * Forgets every page and deletes the files.
+ */
+void pagerClear(struct pager * pager);
+
+void pagerFree(struct pager * pager);
+
+/**
+ * Pages tiles in and out for a viewport covering the world rectangle of
+ * height h and width w from (y, x). Call once per frame with the current
+ * time in seconds; it does nothing unless the tiles to keep change.
+ */
+void pagerUpdate(struct pager * pager, struct objectStore * objs,
+  struct connectionStore * cons, struct adjacencyIndex * adjacency,
+  struct stringArena * labels, const struct pagerHandler * handler, void * ctx,
+  int y, int x, int h, int w, double now);
+
+/**
+ * Brings every paged out tile back.
+ */
+void pagerRestoreAll(struct pager * pager, struct objectStore * objs,
+  struct connectionStore * cons, struct adjacencyIndex * adjacency,
+  struct stringArena * labels, const struct pagerHandler * handler,
+  void * ctx);
+
+/**
+ * Reads every page, calling visitor for the objects and connections in them,
+ * one record at a time. Connections to deleted objects are skipped. With
+ * the objects in memory, this covers the whole scene.
+ */
+void pagerWalk(struct pager * pager, struct objectStore * objs,
+  const struct pagerVisitor * visitor, void * ctx);
+
+/**
+ * Loads the scene file at path into empty stores and a cleared pager for a
+ * viewport covering the world rectangle of height h and width w from (y, x).
+ * Objects in the tiles around the viewport go into the stores, and the rest
+ * are written straight to their pages under handles reserved for them. The
+ * caller indexes what is in the stores, including the adjacency index, once
+ * it returns. Returns 0 on success, -1 if the file can't be read or is
+ * invalid, in which case nothing is loaded, or if a page can't be written,
+ * in which case the scene is left part loaded to be cleared.
+ */
+int pagerLoadScene(struct pager * pager, const char * path,
+  struct objectStore * objs, struct connectionStore * cons,
+  struct stringArena * labels, const struct pagerHandler * handler,
+  void * ctx, int y, int x, int h, int w);
+
+/**
+ * Saves the whole scene, in memory and paged out, to path as sceneSave()
+ * would, without bringing any tiles back. Returns 0 on success.
+ */
+int pagerSaveScene(struct pager * pager, const char * path,
+  struct objectStore * objs, struct connectionStore * cons,
+  uint32_t checkpoint);
+
+#endif // PAGER_H
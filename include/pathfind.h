@@ -0,0 +1,166 @@
+/**
+ * Shortest path queries between two objects, over the connections as an
+ * undirected graph where every edge weighs its length in world units. The
+ * search is A* with the straight line distance to the goal as heuristic,
+ * which never overestimates since no edge is shorter than the line between
+ * its ends, so the first route found is a shortest one.
+ *
+ * Starting a query copies the objects' positions and the connections' ends
+ * out of the stores a chunk at a time; the graph is built from the copy and
+ * searched on a thread of its own, so the game loop only pays for the
+ * copy. Starting another query cancels the one in flight. Under emscripten,
+ * or if no thread can be started, pathFinderPoll() builds and searches a
+ * slice of the graph every frame instead.
+ */
+#ifndef PATHFIND_H
+#define PATHFIND_H
+
+#include <stdint.h>
+#include "store.h"
+
+#ifndef __EMSCRIPTEN__
+# define PATH_THREADS
+# include <pthread.h>
+#endif
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Nodes expanded between checks for cancelling, and per frame without
+// threads
+#define PATH_STEP_BUDGET  4096
+
+// Nodes or connections the graph is built from in the same slice
+#define PATH_BUILD_BUDGET 65536
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * How far building the graph has got. Each stage walks its nodes or
+ * connections in slices.
+ */
+enum pathBuildStage {
+    PATH_BUILD_NODES,
+    PATH_BUILD_COUNT,
+    PATH_BUILD_SUM,
+    PATH_BUILD_FILL,
+    PATH_BUILD_DONE
+};
+
+enum pathState {
+    PATH_IDLE,
+    PATH_SEARCHING,
+    PATH_FOUND,
+    PATH_NOT_FOUND
+};
+
+struct pathHeapEntry {
+    float    f;
+    uint32_t node;
+};
+
+/**
+ * One query: the snapshot it searches and the search's state. Owned by the
+ * search thread until it finishes.
+ */
+struct pathSearch {
+    // Snapshot. Nodes are numbered by dense position at the time.
+    uint32_t               nodeCount;
+    uint32_t *             nodeSlot;
+    int *                  y;
+    int *                  x;
+    uint32_t *             generation;
+    uint32_t               slotCount;
+    struct handle *        edgeSrc;
+    struct handle *        edgeDest;
+    uint32_t               edgeCount;
+    struct handle          start;
+    struct handle          goal;
+    double                 startTime;
+
+    // Neighbours of every node as CSR, built by the search, and the
+    // building's progress: the stage, where in it, the node of every slot
+    // and where each node's next neighbour goes
+    uint32_t *             offsets;
+    uint32_t *             neighbors;
+    enum pathBuildStage    stage;
+    uint32_t               stageAt;
+    uint32_t *             nodeOfSlot;
+    uint32_t *             cursor;
+
+    // A* state: best known distance from the start, the node it came from
+    // and whether it is settled, by node
+    float *                g;
+    uint32_t *             from;
+    uint8_t *              closed;
+    struct pathHeapEntry * heap;
+    uint32_t               heapLen;
+    uint32_t               heapCap;
+    uint32_t               startNode;
+    uint32_t               goalNode;
+    uint32_t               expanded;
+    double                 seconds;
+    int                    found;
+
+    // Set under the finder's lock
+    int                    cancel;
+    int                    finished;
+};
+
+struct pathFinder {
+    enum pathState      state;
+    struct pathSearch * search;
+
+    // Objects along the last route found, from start to goal, and its
+    // length in world units
+    struct handle *     route;
+    uint32_t            routeLen;
+    uint32_t            routeCap;
+    float               length;
+
+    // Nodes the last search expanded and how long it took
+    uint32_t            expanded;
+    double              seconds;
+
+    #ifdef PATH_THREADS
+        pthread_t       thread;
+        pthread_mutex_t lock;
+
+        // Whether the search in flight runs on the thread
+        int             threaded;
+    #endif
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void pathFinderInit(struct pathFinder * finder);
+
+/**
+ * Cancels any search in flight and frees everything.
+ */
+void pathFinderFree(struct pathFinder * finder);
+
+/**
+ * Starts looking for a shortest route from start to goal, cancelling the
+ * search in flight if there is one. The last route is forgotten.
+ */
+void pathFinderStart(struct pathFinder * finder, struct objectStore * objs,
+  struct connectionStore * cons, struct handle start, struct handle goal);
+
+/**
+ * Cancels the search in flight and forgets the last route.
+ */
+void pathFinderClear(struct pathFinder * finder);
+
+/**
+ * Picks up the result of a finished search. Call once per frame. Returns 1
+ * if the search finished since the last call, else 0.
+ */
+int pathFinderPoll(struct pathFinder * finder);
+
+#endif // PATHFIND_H
@@ -0,0 +1,26 @@
+/**
+ * Hit-testing: finding the object under a world position with the help of
+ * the spatial grid.
+ */
+#ifndef PICK_H
+#define PICK_H
+
+#include "spatial.h"
+#include "store.h"
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Returns the handle of the object whose circle contains the world position
+ * (y, x), widened by margin world units, or NULL_HANDLE if there is none.
+ * The grid must hold handle indices and maxRadius must be at least the
+ * largest radius in the store. If several objects match, the one in the
+ * lowest slot wins, which is stable from frame to frame but says nothing
+ * about age, as slots of removed objects are reused.
+ */
+struct handle pickObject(struct spatialGrid * grid, struct objectStore * objs,
+  int y, int x, float margin, int maxRadius);
+
+#endif // PICK_H
@@ -0,0 +1,71 @@
+/**
+ * Streaming PNG encoder. Rows are written one at a time, top to bottom,
+ * and compressed as they come, so an image of any size can be written with
+ * only a row of it in memory.
+ *
+ * Compression is deliberately simple: each row goes through the PNG Sub
+ * filter, which turns runs of one colour into runs of zeros, and the
+ * result is deflated with run length matches and the fixed Huffman codes,
+ * like zlib's Z_RLE strategy. Rendered graphs are mostly background, which
+ * this shrinks to almost nothing, without the memory or the time a full
+ * LZ77 search would take.
+ */
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Compressed bytes gathered before they are written out as an IDAT chunk
+#define PNG_IDAT_SIZE (64 * 1024)
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct pngWriter {
+    FILE *    file;
+    uint32_t  width;
+    uint32_t  height;
+    uint32_t  rows;
+
+    // Previous byte of the filtered stream and how many times it has been
+    // repeated since, not yet encoded
+    int       last;
+    uint32_t  run;
+
+    uint32_t  adler;
+    uint64_t  bits;
+    int       bitCount;
+    uint8_t * filtered;
+    uint8_t   idat[PNG_IDAT_SIZE];
+    uint32_t  idatLen;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Creates the file at path for an 8 bit RGB image of the given size.
+ * Returns 0 on success.
+ */
+int pngWriterOpen(struct pngWriter * png, const char * path, uint32_t width,
+  uint32_t height);
+
+/**
+ * Adds the next row, width RGB triples.
+ */
+void pngWriterRow(struct pngWriter * png, const uint8_t * rgb);
+
+/**
+ * Finishes the image and closes the file. Returns 0 if all of it was
+ * written, which needs every row to have been added.
+ */
+int pngWriterClose(struct pngWriter * png);
+
+#endif // PNGWRITER_H
@@ -0,0 +1,89 @@
+/**
+ * Per-phase frame profiler. Phases of the game loop are wrapped in scoped
+ * timers, and the last PROFILE_WINDOW frames of each phase are kept for
+ * rolling min, average and 99th percentile figures. Every frame can also be
+ * streamed to a CSV file as it completes.
+ *
+ * Timings are CPU side: for drawing phases they measure how long raylib
+ * takes to take the draw calls, not how long the GPU spends on them.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define PROFILE_WINDOW 240
+
+/**
+ * Times the statement or block after it as part of a phase, e.g.
+ *
+ *     PROFILE(PHASE_INPUT) handleInput();
+ *
+ * Time spent in the same phase more than once a frame adds up. Don't return
+ * or break out of the block, or the timer is never stopped.
+ */
+#define PROFILE(phase) \
+        for (int profiling_ = (profilerBegin(phase), 1); profiling_; \
+          profiling_ = (profilerEnd(phase), 0))
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum profilePhase {
+    PHASE_INPUT,
+    PHASE_CULL,
+    PHASE_GRIDLINES,
+    PHASE_CONNECTIONS,
+    PHASE_OBJECTS,
+    PHASE_LABELS,
+    PHASE_BLIT,
+
+    // The whole frame, up to but not including EndDrawing()
+    PHASE_FRAME,
+    PHASE_COUNT
+};
+
+/**
+ * Rolling statistics for one phase, in milliseconds.
+ */
+struct phaseStats {
+    float min;
+    float avg;
+    float p99;
+    float last;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void profilerBegin(enum profilePhase phase);
+
+void profilerEnd(enum profilePhase phase);
+
+/**
+ * Stores this frame's times in the rolling window, writes them to the CSV
+ * file if one is open, and starts the next frame.
+ */
+void profilerEndFrame(void);
+
+/**
+ * Computes the rolling statistics of a phase over the frames recorded so
+ * far, up to PROFILE_WINDOW of them.
+ */
+void profilerStats(enum profilePhase phase, struct phaseStats * stats);
+
+const char * profilerPhaseName(enum profilePhase phase);
+
+/**
+ * Starts writing one CSV row per frame to path. Returns 0 on success.
+ */
+int profilerOpenCsv(const char * path);
+
+void profilerCloseCsv(void);
+
+#endif // PROFILER_H
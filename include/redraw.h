@@ -0,0 +1,56 @@
+/**
+ * Tracks what has changed since the scene was last rendered, so the render
+ * texture is only redrawn when something on it is actually different.
+ */
+#ifndef REDRAW_H
+#define REDRAW_H
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum redrawFlag {
+    REDRAW_NONE    = 0,
+
+    // Objects, connections or the viewport changed
+    REDRAW_SCENE   = 1 << 0,
+
+    // The label edit overlay was opened, closed or typed into
+    REDRAW_OVERLAY = 1 << 1,
+
+    REDRAW_ALL     = REDRAW_SCENE | REDRAW_OVERLAY
+};
+
+enum redrawMode {
+    // Redraw everything every frame at the target frame rate
+    REDRAW_ALWAYS,
+
+    // Redraw only what changed, and sleep until input arrives
+    REDRAW_ON_DEMAND
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Records that the given parts need redrawing.
+ */
+void markDirty(int flags);
+
+/**
+ * Returns 1 if any of the given parts need redrawing. Always 1 when
+ * rendering in REDRAW_ALWAYS mode.
+ */
+int isDirty(int flags);
+
+/**
+ * Called once everything dirty has been redrawn.
+ */
+void clearDirty(void);
+
+void setRedrawMode(enum redrawMode mode);
+
+enum redrawMode getRedrawMode(void);
+
+#endif // REDRAW_H
@@ -0,0 +1,183 @@
+/**
+ * Binary scene files. A scene file is a header followed by fixed width
+ * object records, fixed width connection records and a string table:
+ *
+ *   header      struct sceneHeader
+ *   objects     objectCount x struct sceneObjectRecord
+ *   connections connectionCount x struct sceneConnectionRecord
+ *   strings     stringBytes of NUL terminated labels
+ *
+ * Connections refer to objects by record index and labels are byte offsets
+ * into the string table. Everything is little endian, and records are plain
+ * 32-bit fields so the file can be used straight out of a memory mapping.
+ *
+ * Version 2 adds each object's handle to its record, so that a scene loaded
+ * into an empty store gets the same handles it was saved with and an
+ * autosave journal written against those handles can be replayed on top.
+ * Version 1 files, whose object records stop before the handle, still load.
+ */
+#ifndef SCENEFILE_H
+#define SCENEFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "store.h"
+#include "arena.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define SCENE_MAGIC    "CVSN"
+#define SCENE_VERSION  2
+
+// Label offset meaning "no label"
+#define SCENE_NO_LABEL UINT32_MAX
+
+// Bytes of records, and of labels, a scene writer gathers between writes
+#define SCENE_WRITER_BUFFER 65536
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct sceneHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t objectCount;
+    uint32_t connectionCount;
+    uint32_t stringBytes;
+
+    // Autosave checkpoint number, matched against the journal's
+    uint32_t checkpoint;
+    uint32_t reserved[2];
+};
+
+struct sceneObjectRecord {
+    int32_t  x, y;
+    int32_t  radius;
+    uint32_t color; // r, g, b, a bytes in memory order
+    uint32_t label;
+    uint8_t  type;
+    uint8_t  sticky;
+    uint8_t  pad[2];
+
+    // Version 2 and up
+    uint32_t slot, generation;
+};
+
+// Size of an object record in a version 1 file
+#define SCENE_V1_OBJECT_BYTES 24
+
+struct sceneConnectionRecord {
+    uint32_t src, dest;
+    int32_t  width;
+    uint32_t color;
+    uint32_t label;
+};
+
+/**
+ * Receives a scene file's contents as it is read. Labels point into the file
+ * and are only valid during the call. object gets the handle the object was
+ * saved with (NULL_HANDLE for version 1 files) and returns the handle it was
+ * given, or NULL_HANDLE to drop it along with its connections.
+ */
+struct sceneSink {
+    struct handle (* object)(struct handle saved, struct object obj,
+      void * ctx);
+    void (* connection)(struct connection con, void * ctx);
+};
+
+// Record index and generation an object's slot was written with
+struct sceneWritten {
+    uint32_t record;
+    uint32_t generation;
+};
+
+/**
+ * Writes a scene file one record at a time, for scenes that are not all in
+ * one store. Every object must be written before the first connection.
+ */
+struct sceneWriter {
+    FILE *                file;
+    FILE *                strings;
+    const char *          path;
+    char                  tmpPath[4096];
+    struct sceneHeader    header;
+
+    // Records and labels gathered for the next write to file and strings
+    uint8_t *             records;
+    size_t                recordsLen;
+    uint8_t *             labels;
+    size_t                labelsLen;
+
+    // Indexed by handle slot
+    struct sceneWritten * written;
+    uint32_t              cap;
+
+    int                   failed;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Writes every live object and connection to path, tagged with a checkpoint
+ * number. The file is written and synced beside it first, then renamed into
+ * place, so a crash never leaves a half written scene. Returns 0 on success,
+ * -1 on failure.
+ */
+int sceneSave(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, uint32_t checkpoint);
+
+/**
+ * Appends the objects and connections in the scene file at path to the
+ * stores. Labels are interned into the given arena. If the object store is
+ * empty, objects get back the handles they were saved with. The file's
+ * checkpoint number is stored in checkpoint unless it is NULL. Returns 0 on
+ * success, -1 if the file can't be read or is invalid, in which case nothing
+ * is added.
+ */
+int sceneLoad(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, struct stringArena * labels,
+  uint32_t * checkpoint);
+
+/**
+ * Reads the scene file at path into a sink instead of stores. The whole file
+ * is checked first, so the sink sees nothing from an invalid file. Returns 0
+ * on success, -1 if the file can't be read or is invalid.
+ */
+int sceneLoadWith(const char * path, const struct sceneSink * sink,
+  void * ctx, uint32_t * checkpoint);
+
+/**
+ * Returns 0 if the file at path is a valid scene file, -1 otherwise.
+ */
+int sceneCheck(const char * path);
+
+/**
+ * Starts writing a scene file to path, tagged with a checkpoint number. As
+ * with sceneSave, nothing replaces path until sceneWriterClose succeeds.
+ * Returns 0 on success, -1 on failure.
+ */
+int sceneWriterOpen(struct sceneWriter * w, const char * path,
+  uint32_t checkpoint);
+
+/**
+ * Writes an object under its handle.
+ */
+void sceneWriterObject(struct sceneWriter * w, struct handle h,
+  struct object obj);
+
+/**
+ * Writes a connection, unless one of its ends was never written.
+ */
+void sceneWriterConnection(struct sceneWriter * w, struct connection con);
+
+/**
+ * Finishes the file and renames it into place. Returns 0 on success, -1 if
+ * anything failed to write, in which case path is left alone.
+ */
+int sceneWriterClose(struct sceneWriter * w);
+
+#endif // SCENEFILE_H
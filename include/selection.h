@@ -0,0 +1,89 @@
+/**
+ * A set of selected objects, picked with a box or a lasso and moved as a
+ * group. Objects are kept by slot index, which stays put when the store
+ * moves dense elements around, in a list for walking the set and a bitset
+ * for asking whether an object is selected.
+ */
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <stdint.h>
+#include "spatial.h"
+#include "store.h"
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * A lasso vertex in world coordinates.
+ */
+struct selectionPoint {
+    int y, x;
+};
+
+struct selection {
+    // Bit per slot
+    uint64_t * bits;
+    uint32_t   words;
+
+    // Selected slots, and for each the position it had when the group move
+    // started and the position it is being moved to
+    uint32_t * slots;
+    int *      startY;
+    int *      startX;
+    int *      y;
+    int *      x;
+    uint32_t   len;
+    uint32_t   cap;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void selectionInit(struct selection * sel);
+
+void selectionFree(struct selection * sel);
+
+/**
+ * Deselects everything, in time proportional to the selection.
+ */
+void selectionClear(struct selection * sel);
+
+int selectionContains(struct selection * sel, uint32_t slot);
+
+void selectionAdd(struct selection * sel, uint32_t slot);
+
+/**
+ * Deselects a slot, as when its object is deleted.
+ */
+void selectionRemove(struct selection * sel, uint32_t slot);
+
+/**
+ * Selects the objects centred inside the world rectangle
+ * [minY, maxY] x [minX, maxX]. The grid must hold handle indices.
+ */
+void selectBox(struct selection * sel, struct spatialGrid * grid,
+  struct objectStore * objs, int minY, int minX, int maxY, int maxX);
+
+/**
+ * Selects the objects centred inside the closed polygon of n points.
+ */
+void selectLasso(struct selection * sel, struct spatialGrid * grid,
+  struct objectStore * objs, const struct selectionPoint * points,
+  uint32_t n);
+
+/**
+ * Remembers where every selected object is, as the origin of a group move.
+ */
+void selectionBeginMove(struct selection * sel, struct objectStore * objs);
+
+/**
+ * Works out where every selected object goes when the group is moved by
+ * (dy, dx) from where selectionBeginMove() found it, into sel->y and
+ * sel->x.
+ */
+void selectionOffset(struct selection * sel, int dy, int dx);
+
+#endif // SELECTION_H
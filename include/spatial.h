@@ -0,0 +1,88 @@
+/**
+ * Spatial hash grid for finding objects near a point without looking at
+ * every object. The plane is split into square cells in world coordinates
+ * and each cell keeps the ids of the items positioned inside it. Cells are
+ * hashed into a fixed number of buckets, so empty space costs nothing.
+ */
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct spatialEntry {
+    // Cell coordinates, kept so that hash collisions can be told apart
+    int cy, cx;
+    int id;
+};
+
+struct spatialBucket {
+    struct spatialEntry * entries;
+    int                   len;
+    int                   cap;
+};
+
+struct spatialGrid {
+    // Width and height of a cell in world units
+    int                    cellSize;
+
+    // Always a power of two so the hash can be masked
+    int                    bucketCount;
+    struct spatialBucket * buckets;
+
+    // Number of ids currently in the grid
+    int                    count;
+};
+
+/**
+ * Called once for every id found by a query. ctx is passed through untouched.
+ */
+typedef void (*spatialVisitor)(int id, void * ctx);
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Sets up an empty grid. bucketCount is rounded up to a power of two.
+ */
+void spatialGridInit(struct spatialGrid * grid, int cellSize, int bucketCount);
+
+/**
+ * Releases all memory held by the grid.
+ */
+void spatialGridFree(struct spatialGrid * grid);
+
+/**
+ * Empties the grid but keeps its buckets allocated.
+ */
+void spatialGridClear(struct spatialGrid * grid);
+
+/**
+ * Adds an id at the given world position.
+ */
+void spatialGridInsert(struct spatialGrid * grid, int id, int y, int x);
+
+/**
+ * Removes an id which was inserted at the given world position.
+ * Returns 1 if it was found.
+ */
+int spatialGridRemove(struct spatialGrid * grid, int id, int y, int x);
+
+/**
+ * Moves an id from one world position to another. Does nothing when both
+ * positions fall in the same cell.
+ */
+void spatialGridMove(struct spatialGrid * grid, int id, int oldY, int oldX,
+  int newY, int newX);
+
+/**
+ * Visits every id in the cells overlapping the world rectangle
+ * [minY, maxY] x [minX, maxX]. Ids near the rectangle may be visited too,
+ * so the visitor must do its own exact test.
+ */
+void spatialGridQuery(struct spatialGrid * grid, int minY, int minX, int maxY,
+  int maxX, spatialVisitor visit, void * ctx);
+
+#endif // SPATIAL_H
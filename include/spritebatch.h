@@ -0,0 +1,75 @@
+/**
+ * Batched object renderer. Every shape an object can be drawn with (a
+ * filled circle for dots, a ring for highlighting and the sprite image) is
+ * rasterized once into a single atlas texture, and objects go out as
+ * textured quads between spriteBatchBegin() and spriteBatchEnd(). Since all
+ * quads sample the same texture, raylib sends a whole frame's objects in one
+ * draw call per filled vertex buffer instead of tessellating every circle.
+ */
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "raylib.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+
+// Size of each cell in the atlas, and the radius of the circles drawn in
+// them. The gap keeps the mipmaps of neighbouring cells from bleeding.
+#define SPRITE_CELL          128
+#define SPRITE_CIRCLE_RADIUS 56
+#define SPRITE_RING_WIDTH    8
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum spriteShape {
+    SPRITE_DISC,
+    SPRITE_RING,
+    SPRITE_IMAGE,
+    SPRITE_SHAPES
+};
+
+struct spriteBatch {
+    Texture2D atlas;
+
+    // Texture coordinates of each shape's cell
+    Rectangle cells[SPRITE_SHAPES];
+
+    // Size of the sprite image as loaded, which is what it is drawn at
+    int       imageWidth;
+    int       imageHeight;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Builds the atlas, with the image at imagePath as the sprite. Needs a GL
+ * context.
+ */
+void spriteBatchInit(struct spriteBatch * batch, const char * imagePath);
+
+void spriteBatchUnload(struct spriteBatch * batch);
+
+void spriteBatchBegin(struct spriteBatch * batch);
+
+void spriteBatchEnd(struct spriteBatch * batch);
+
+/**
+ * Adds a disc or ring of the given radius centred on (x, y).
+ */
+void spriteBatchCircle(struct spriteBatch * batch, enum spriteShape shape,
+  float x, float y, float radius, Color color);
+
+/**
+ * Adds the sprite image, scaled by scale and turned 180 degrees about
+ * (x, y), the way the render texture is flipped.
+ */
+void spriteBatchImage(struct spriteBatch * batch, float x, float y,
+  float scale, Color tint);
+
+#endif // SPRITEBATCH_H
@@ -0,0 +1,89 @@
+/**
+ * Persistent storage for small named files, the same on native and web
+ * builds. On the web, files live in an IndexedDB-backed directory which is
+ * loaded asynchronously once at startup and written back in the background;
+ * natively they are plain files in the working directory.
+ *
+ * Files read through storageGet() are read once and then served from an
+ * in-memory cache. Writes through storagePut() go to the cache and reach the
+ * disk after STORAGE_FLUSH_MS without further writes, so a burst of writes
+ * costs one flush. Files written some other way under storagePath() (with
+ * stdio, say) are reported with storageTouch() to be persisted along with
+ * them.
+ */
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stddef.h>
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#ifdef __EMSCRIPTEN__
+# define STORAGE_DIR "/work"
+#else
+# define STORAGE_DIR "."
+#endif
+
+// Flush once writes have stopped for this long, or have kept coming for
+// STORAGE_MAX_DELAY_MS
+#define STORAGE_FLUSH_MS     500
+#define STORAGE_MAX_DELAY_MS 5000
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Starts loading the storage directory. Nothing may be read or written
+ * until storageReady() says so.
+ */
+void storageInit(void);
+
+/**
+ * Writes anything left unflushed and frees the cache.
+ */
+void storageClose(void);
+
+/**
+ * Returns 1 once the storage directory has been loaded. Always 1 natively.
+ */
+int storageReady(void);
+
+/**
+ * Writes the path of the named file in the storage directory into buf.
+ * Returns 0, or -1 if it didn't fit.
+ */
+int storagePath(char * buf, size_t size, const char * name);
+
+/**
+ * Returns the contents of the named file, NUL-terminated, or NULL if there
+ * is no such file. The pointer stays valid until the next storagePut() of
+ * the same name.
+ */
+const char * storageGet(const char * name);
+
+/**
+ * Replaces the contents of the named file. Reaches the disk with a later
+ * flush.
+ */
+void storagePut(const char * name, const char * data, size_t len);
+
+/**
+ * Notes that files under storagePath() were written directly and need
+ * persisting with the next flush.
+ */
+void storageTouch(void);
+
+/**
+ * Flushes if writes have settled. Call once per frame with the current time
+ * in seconds.
+ */
+void storageTick(double now);
+
+/**
+ * Writes out every cached change now and starts persisting it.
+ */
+void storageFlush(void);
+
+#endif // STORAGE_H
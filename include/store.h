@@ -0,0 +1,257 @@
+/**
+ * Growable storage for the objects (nodes) and connections (edges) on the
+ * plane.
+ *
+ * Elements are referred to by handles rather than pointers. A handle is a
+ * slot index plus the generation the slot had when the element was added, so
+ * a handle to a removed element is detected instead of silently pointing at
+ * whatever took its place.
+ *
+ * The element data itself is kept dense (no holes) and split into fixed size
+ * chunks with one array per field, so per-frame loops can walk x, y and
+ * radius contiguously and growing the store never moves existing data.
+ */
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdint.h>
+#include "raylib.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define STORE_CHUNK_SHIFT 12
+#define STORE_CHUNK_SIZE  (1 << STORE_CHUNK_SHIFT)
+#define STORE_CHUNK_MASK  (STORE_CHUNK_SIZE - 1)
+
+// Marks a missing index, and the end of the free list
+#define STORE_NONE        UINT32_MAX
+
+#define NULL_HANDLE       ((struct handle) { STORE_NONE, 0 })
+
+// Field of the element at a dense position, e.g. OBJECT_FIELD(s, x, i)
+#define OBJECT_FIELD(store, field, dense) \
+        ((store)->chunks[(dense) >> STORE_CHUNK_SHIFT]->field[(dense) & \
+        STORE_CHUNK_MASK])
+#define CONNECTION_FIELD(store, field, dense) OBJECT_FIELD(store, field, dense)
+
+// Number of dense elements living in chunk c of a store holding len elements
+#define STORE_CHUNK_LEN(len, c) \
+        ((len) - ((c) << STORE_CHUNK_SHIFT) > STORE_CHUNK_SIZE ? \
+        STORE_CHUNK_SIZE : (len) - ((c) << STORE_CHUNK_SHIFT))
+
+// Number of chunks holding at least one element
+#define STORE_CHUNKS_USED(len) \
+        (((len) + STORE_CHUNK_SIZE - 1) >> STORE_CHUNK_SHIFT)
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum objectType {
+    DOT,
+    SPRITE
+};
+
+struct handle {
+    uint32_t index;
+    uint32_t generation;
+};
+
+/**
+ * Value type used to describe a new object. Once added, the object lives in
+ * the store's chunks and is reached through its handle.
+ */
+struct object {
+    enum objectType type;
+
+    // sticky = 1: Should be drawn at edge when offscreen.
+    // sticky = 0: Hidden when offscreen.
+    int    sticky: 1;
+
+    // A label that can be drawn next to this object, normally interned in a
+    // string arena
+    const char * label;
+
+    // Circle radius.
+    int    radius;
+
+    Color  color;
+
+    // Object world position with origin at top left
+    int    y, x;
+};
+
+/**
+ * A connection is an edge between two objects.
+ */
+struct connection {
+    // A label that can be drawn next to this object
+    const char *  label;
+
+    int           width;
+
+    Color         color;
+
+    struct handle src;
+    struct handle dest;
+};
+
+/**
+ * Maps handle indices to dense positions. A free slot stores the index of
+ * the next free slot in place of its dense position.
+ */
+struct slotTable {
+    uint32_t * generation;
+    uint32_t * dense;
+
+    // For free slots, the one before on the free list, so that any free
+    // slot can be taken off it without walking the list
+    uint32_t * prevFree;
+    uint32_t   len;
+    uint32_t   cap;
+    uint32_t   freeHead;
+};
+
+struct objectChunk {
+    // Hot fields, read by every per-frame pass
+    int      x[STORE_CHUNK_SIZE];
+    int      y[STORE_CHUNK_SIZE];
+    int      radius[STORE_CHUNK_SIZE];
+
+    // Cold fields
+    Color    color[STORE_CHUNK_SIZE];
+    uint8_t  type[STORE_CHUNK_SIZE];
+    uint8_t  sticky[STORE_CHUNK_SIZE];
+    const char * label[STORE_CHUNK_SIZE];
+
+    // Slot owning each dense position, to fix up handles on removal
+    uint32_t slot[STORE_CHUNK_SIZE];
+};
+
+struct objectStore {
+    struct slotTable     slots;
+    struct objectChunk ** chunks;
+    uint32_t             chunkCount;
+    uint32_t             len;
+};
+
+struct connectionChunk {
+    struct handle src[STORE_CHUNK_SIZE];
+    struct handle dest[STORE_CHUNK_SIZE];
+    int           width[STORE_CHUNK_SIZE];
+    Color         color[STORE_CHUNK_SIZE];
+    const char *  label[STORE_CHUNK_SIZE];
+    uint32_t      slot[STORE_CHUNK_SIZE];
+};
+
+struct connectionStore {
+    struct slotTable         slots;
+    struct connectionChunk ** chunks;
+    uint32_t                 chunkCount;
+    uint32_t                 len;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Returns 1 if both handles refer to the same element.
+ */
+int handleEqual(struct handle a, struct handle b);
+
+void objectStoreInit(struct objectStore * store);
+
+/**
+ * Releases the store's memory. Labels are owned by the caller.
+ */
+void objectStoreFree(struct objectStore * store);
+
+/**
+ * Adds an object and returns its handle.
+ */
+struct handle objectStoreAdd(struct objectStore * store, struct object obj);
+
+/**
+ * Adds an object under a given handle, as when restoring a saved scene that
+ * other records refer to by handle. The slot must be free or past the end
+ * of the slot table. Returns h, or NULL_HANDLE if the slot is taken.
+ */
+struct handle objectStoreAddAt(struct objectStore * store, struct handle h,
+  struct object obj);
+
+/**
+ * Removes an object in O(1) by moving the last dense element into its place.
+ * Returns 0 if the handle was stale.
+ */
+int objectStoreRemove(struct objectStore * store, struct handle h);
+
+/**
+ * Takes an object out of the store but keeps its slot reserved, so that it
+ * can be put back under the same handle with objectStoreRestore(). In the
+ * meantime the handle looks stale. Returns 0 if the handle was stale.
+ */
+int objectStoreEvict(struct objectStore * store, struct handle h);
+
+/**
+ * Puts an evicted object back. Returns 0 if h isn't an evicted object.
+ */
+int objectStoreRestore(struct objectStore * store, struct handle h,
+  struct object obj);
+
+/**
+ * Reserves a slot for an object that starts out evicted, as when a scene is
+ * loaded straight to disk. Takes h if its slot is free, as objectStoreAddAt
+ * does, or a fresh slot otherwise. Returns the handle reserved; the object
+ * can then be put in with objectStoreRestore().
+ */
+struct handle objectStoreReserve(struct objectStore * store,
+  struct handle h);
+
+/**
+ * Returns the dense position of a handle, or STORE_NONE if it is stale.
+ */
+uint32_t objectStoreDense(struct objectStore * store, struct handle h);
+
+/**
+ * Returns the handle of the object at a dense position.
+ */
+struct handle objectStoreHandle(struct objectStore * store, uint32_t dense);
+
+/**
+ * Returns the handle currently living in a slot, or NULL_HANDLE if the slot
+ * is free.
+ */
+struct handle objectStoreSlotHandle(struct objectStore * store, uint32_t slot);
+
+void connectionStoreInit(struct connectionStore * store);
+
+/**
+ * Releases the store's memory. Labels are owned by the caller.
+ */
+void connectionStoreFree(struct connectionStore * store);
+
+/**
+ * Adds a connection and returns its handle.
+ */
+struct handle connectionStoreAdd(struct connectionStore * store,
+  struct connection con);
+
+/**
+ * Removes a connection in O(1). Returns 0 if the handle was stale.
+ */
+int connectionStoreRemove(struct connectionStore * store, struct handle h);
+
+/**
+ * Returns the dense position of a handle, or STORE_NONE if it is stale.
+ */
+uint32_t connectionStoreDense(struct connectionStore * store, struct handle h);
+
+/**
+ * Returns the handle of the connection at a dense position.
+ */
+struct handle connectionStoreHandle(struct connectionStore * store,
+  uint32_t dense);
+
+#endif // STORE_H
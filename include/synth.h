@@ -0,0 +1,57 @@
+/**
+ * Synthetic scene generator, for benchmarking and for trying the app out on
+ * scenes far bigger than anyone would click together by hand. Scenes are
+ * deterministic for a given seed.
+ */
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+#include "store.h"
+#include "arena.h"
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+enum synthShape {
+    // Objects spread evenly, connections between near neighbours
+    SYNTH_UNIFORM,
+
+    // Objects in dense blobs, connections mostly inside a blob
+    SYNTH_CLUSTERED,
+
+    // Objects spread evenly, connections between random far apart objects
+    SYNTH_LONG_EDGES
+};
+
+struct synthParams {
+    enum synthShape shape;
+    uint32_t        objects;
+    uint32_t        connections;
+
+    // Objects are placed in [0, worldSize) on both axes
+    int             worldSize;
+    uint32_t        seed;
+
+    // Give every object an "Object N" label
+    int             labels;
+};
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Adds a generated scene to the stores, interning any labels into the given
+ * arena.
+ */
+void synthGenerate(struct synthParams * params, struct objectStore * objs,
+  struct connectionStore * cons, struct stringArena * labels);
+
+/**
+ * Parses "uniform", "clustered" or "long". Returns -1 for anything else.
+ */
+int synthShapeFromName(const char * name);
+
+#endif // SYNTH_H
@@ -0,0 +1,24 @@
+/**
+ * Wall clock timing. Unlike clock(), which counts CPU time used by the
+ * process, these never jump and keep counting while the process sleeps.
+ */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+/**
+ * Nanoseconds on a monotonic clock with an arbitrary starting point.
+ */
+uint64_t monotonicNanos(void);
+
+/**
+ * Seconds on the same clock as monotonicNanos().
+ */
+double monotonicSeconds(void);
+
+#endif // TIMING_H
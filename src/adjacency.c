@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "adjacency.h"
+
+/*****************************************************************************
+* Connected Pair Set
+*****************************************************************************/
+
+static uint32_t hashPair(struct handle a, struct handle b) {
+    uint32_t h = a.index * 73856093u ^ a.generation * 19349663u;
+
+    return h ^ (b.index * 83492791u) ^ (b.generation * 2654435761u);
+}
+
+/**
+ * Returns the entry holding the pair a, b (lowest slot first), or the empty
+ * entry where it would go.
+ */
+static uint32_t findPair(struct adjacencyIndex * index, struct handle a,
+  struct handle b) {
+    uint32_t mask = index->pairsCap - 1;
+    uint32_t i    = hashPair(a, b) & mask;
+
+    while (index->pairs[i].con.index != STORE_NONE) {
+        if (handleEqual(index->pairs[i].a, a)
+          && handleEqual(index->pairs[i].b, b))
+            return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void growPairs(struct adjacencyIndex * index) {
+    struct adjacencyPair * old = index->pairs;
+    uint32_t oldCap = index->pairsCap;
+
+    index->pairsCap = oldCap ? oldCap * 2 : 256;
+    index->pairs    = malloc(index->pairsCap * sizeof(struct adjacencyPair));
+
+    // All ones makes every con.index STORE_NONE
+    memset(index->pairs, 0xff, index->pairsCap * sizeof(struct adjacencyPair));
+    for (uint32_t i = 0; i < oldCap; i++)
+        if (old[i].con.index != STORE_NONE)
+            index->pairs[findPair(index, old[i].a, old[i].b)] = old[i];
+    free(old);
+}
+
+/**
+ * Empties the set, making sure it has room for at least n pairs.
+ */
+static void resetPairs(struct adjacencyIndex * index, uint32_t n) {
+    if (index->pairs != NULL)
+        memset(index->pairs, 0xff,
+          index->pairsCap * sizeof(struct adjacencyPair));
+    index->pairsLen = 0;
+
+    // Keep the set at most half full
+    while (index->pairsCap < n * 2)
+        growPairs(index);
+}
+
+static void insertPair(struct adjacencyIndex * index, struct handle a,
+  struct handle b, struct handle con) {
+    if (a.index > b.index) {
+        struct handle t = a;
+        a = b;
+        b = t;
+    }
+
+    if ((index->pairsLen + 1) * 2 > index->pairsCap)
+        growPairs(index);
+
+    // A stale entry for the same pair is simply taken over
+    uint32_t i = findPair(index, a, b);
+    if (index->pairs[i].con.index == STORE_NONE)
+        index->pairsLen++;
+    index->pairs[i] = (struct adjacencyPair) { a, b, con };
+}
+
+/*****************************************************************************
+* Delta Log
+*****************************************************************************/
+
+static void pushDelta(struct adjacencyIndex * index, uint32_t slot,
+  struct handle con) {
+    if (slot >= index->deltaHeadCap) {
+        uint32_t cap = index->deltaHeadCap ? index->deltaHeadCap : 256;
+        while (cap <= slot)
+            cap *= 2;
+        index->deltaHead = realloc(index->deltaHead, cap * sizeof(uint32_t));
+        memset(index->deltaHead + index->deltaHeadCap, 0xff,
+          (cap - index->deltaHeadCap) * sizeof(uint32_t));
+        index->deltaHeadCap = cap;
+    }
+
+    if (index->deltasLen == index->deltasCap) {
+        index->deltasCap = index->deltasCap ? index->deltasCap * 2 : 256;
+        index->deltas    = realloc(index->deltas,
+            index->deltasCap * sizeof(struct adjacencyDelta));
+    }
+
+    index->deltas[index->deltasLen] = (struct adjacencyDelta) {
+        con, index->deltaHead[slot]
+    };
+    index->deltaHead[slot] = index->deltasLen++;
+}
+
+/*****************************************************************************
+* Index
+*****************************************************************************/
+
+void adjacencyInit(struct adjacencyIndex * index) {
+    memset(index, 0, sizeof(*index));
+}
+
+void adjacencyFree(struct adjacencyIndex * index) {
+    free(index->offsets);
+    free(index->edges);
+    free(index->deltas);
+    free(index->deltaHead);
+    free(index->pairs);
+    adjacencyInit(index);
+}
+
+void adjacencyRebuild(struct adjacencyIndex * index,
+  struct connectionStore * cons) {
+    // Drop the delta log
+    index->deltasLen = 0;
+    index->removed   = 0;
+    if (index->deltaHead != NULL)
+        memset(index->deltaHead, 0xff, index->deltaHeadCap * sizeof(uint32_t));
+
+    uint32_t slots = 0;
+    for (uint32_t i = 0; i < cons->len; i++) {
+        uint32_t s = CONNECTION_FIELD(cons, src, i).index;
+        uint32_t d = CONNECTION_FIELD(cons, dest, i).index;
+        if (s + 1 > slots)
+            slots = s + 1;
+        if (d + 1 > slots)
+            slots = d + 1;
+    }
+
+    // Count the edges of every slot, then turn the counts into offsets
+    index->slotCount = slots;
+    index->offsets   = realloc(index->offsets, (slots + 1) * sizeof(uint32_t));
+    memset(index->offsets, 0, (slots + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < cons->len; i++) {
+        uint32_t s = CONNECTION_FIELD(cons, src, i).index;
+        uint32_t d = CONNECTION_FIELD(cons, dest, i).index;
+        index->offsets[s + 1]++;
+        if (d != s)
+            index->offsets[d + 1]++;
+    }
+    for (uint32_t s = 0; s < slots; s++)
+        index->offsets[s + 1] += index->offsets[s];
+
+    index->edgesLen = index->offsets[slots];
+    index->edges    = realloc(index->edges,
+        (index->edgesLen + 1) * sizeof(struct handle));
+
+    uint32_t * cursor = malloc((slots + 1) * sizeof(uint32_t));
+    memcpy(cursor, index->offsets, (slots + 1) * sizeof(uint32_t));
+    resetPairs(index, cons->len);
+    for (uint32_t i = 0; i < cons->len; i++) {
+        struct handle con  = connectionStoreHandle(cons, i);
+        struct handle src  = CONNECTION_FIELD(cons, src, i);
+        struct handle dest = CONNECTION_FIELD(cons, dest, i);
+
+        index->edges[cursor[src.index]++] = con;
+        if (dest.index != src.index)
+            index->edges[cursor[dest.index]++] = con;
+        insertPair(index, src, dest, con);
+    }
+    free(cursor);
+} /* adjacencyRebuild */
+
+void adjacencyAdd(struct adjacencyIndex * index, struct connectionStore * cons,
+  struct handle con) {
+    uint32_t dense = connectionStoreDense(cons, con);
+
+    if (dense == STORE_NONE)
+        return;
+
+    // The new connection is already in the store, so a rebuild includes it
+    uint32_t limit = index->edgesLen / ADJACENCY_DELTA_FRACTION;
+    if (limit < ADJACENCY_MIN_DELTA)
+        limit = ADJACENCY_MIN_DELTA;
+    if (index->deltasLen + index->removed >= limit) {
+        adjacencyRebuild(index, cons);
+        return;
+    }
+
+    struct handle src  = CONNECTION_FIELD(cons, src, dense);
+    struct handle dest = CONNECTION_FIELD(cons, dest, dense);
+    pushDelta(index, src.index, con);
+    if (dest.index != src.index)
+        pushDelta(index, dest.index, con);
+    insertPair(index, src, dest, con);
+}
+
+void adjacencyRemove(struct adjacencyIndex * index) {
+    index->removed++;
+}
+
+/**
+ * Visits con if it is still alive and still touches obj.
+ */
+static void visitLive(struct connectionStore * cons, struct handle con,
+  struct handle obj, adjacencyVisitor visit, void * ctx) {
+    uint32_t dense = connectionStoreDense(cons, con);
+
+    if (dense == STORE_NONE)
+        return;
+    if (handleEqual(CONNECTION_FIELD(cons, src, dense), obj)
+      || handleEqual(CONNECTION_FIELD(cons, dest, dense), obj))
+        visit(con, ctx);
+}
+
+void adjacencyQuery(struct adjacencyIndex * index,
+  struct connectionStore * cons, struct handle obj, adjacencyVisitor visit,
+  void * ctx) {
+    uint32_t s = obj.index;
+
+    if (s < index->slotCount)
+        for (uint32_t e = index->offsets[s]; e < index->offsets[s + 1]; e++)
+            visitLive(cons, index->edges[e], obj, visit, ctx);
+
+    if (s < index->deltaHeadCap)
+        for (uint32_t d = index->deltaHead[s]; d != STORE_NONE;
+          d = index->deltas[d].next)
+            visitLive(cons, index->deltas[d].con, obj, visit, ctx);
+}
+
+/**
+ * Looks for a live connection between a and b among the edges of a.
+ */
+struct pairScan {
+    struct connectionStore * cons;
+    struct handle            a, b;
+    struct handle            found;
+};
+
+static void matchPair(struct handle con, void * ctx) {
+    struct pairScan * scan  = ctx;
+    uint32_t          dense = connectionStoreDense(scan->cons, con);
+    struct handle     src   = CONNECTION_FIELD(scan->cons, src, dense);
+    struct handle     dest  = CONNECTION_FIELD(scan->cons, dest, dense);
+
+    if ((handleEqual(src, scan->a) && handleEqual(dest, scan->b))
+      || (handleEqual(src, scan->b) && handleEqual(dest, scan->a)))
+        scan->found = con;
+}
+
+static uint32_t baseDegree(struct adjacencyIndex * index, uint32_t slot) {
+    if (slot >= index->slotCount)
+        return 0;
+    return index->offsets[slot + 1] - index->offsets[slot];
+}
+
+struct handle adjacencyFind(struct adjacencyIndex * index,
+  struct connectionStore * cons, struct handle a, struct handle b) {
+    if (index->pairsCap == 0)
+        return NULL_HANDLE;
+
+    if (a.index > b.index) {
+        struct handle t = a;
+        a = b;
+        b = t;
+    }
+
+    struct adjacencyPair * pair = &index->pairs[findPair(index, a, b)];
+    if (pair->con.index == STORE_NONE)
+        return NULL_HANDLE;
+    if (connectionStoreDense(cons, pair->con) != STORE_NONE)
+        return pair->con;
+
+    // The remembered connection is gone, but a duplicate may be left
+    struct pairScan scan = { cons, a, b, NULL_HANDLE };
+    adjacencyQuery(index, cons,
+      baseDegree(index, a.index) <= baseDegree(index, b.index) ? a : b,
+      matchPair, &scan);
+    if (scan.found.index != STORE_NONE)
+        pair->con = scan.found;
+    return scan.found;
+}
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+static uint32_t hashText(const char * text) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+
+    for (; *text; text++)
+        h = (h ^ (uint8_t) *text) * 16777619u;
+    return h;
+}
+
+/**
+ * Returns the slot holding text, or the empty slot where it would go.
+ */
+static uint32_t findSlot(struct stringArena * arena, const char * text,
+  uint32_t hash) {
+    uint32_t mask = arena->entriesCap - 1;
+    uint32_t i    = hash & mask;
+
+    while (arena->entries[i].text != NULL) {
+        if (arena->entries[i].hash == hash
+          && strcmp(arena->entries[i].text, text) == 0)
+            return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void growTable(struct stringArena * arena) {
+    struct internEntry * old = arena->entries;
+    uint32_t oldCap = arena->entriesCap;
+
+    arena->entriesCap = oldCap ? oldCap * 2 : 1024;
+    arena->entries    = calloc(arena->entriesCap, sizeof(struct internEntry));
+    for (uint32_t i = 0; i < oldCap; i++)
+        if (old[i].text != NULL)
+            arena->entries[findSlot(arena, old[i].text, old[i].hash)] = old[i];
+    free(old);
+}
+
+/**
+ * Returns room for n bytes, starting a new block when the current one is
+ * full. Strings longer than a block get a block of their own.
+ */
+static char * allocate(struct stringArena * arena, size_t n) {
+    struct arenaBlock * block = arena->blocks;
+
+    if (block == NULL || block->size - block->used < n) {
+        size_t size = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+        block         = malloc(sizeof(struct arenaBlock) + size);
+        block->next   = arena->blocks;
+        block->used   = 0;
+        block->size   = size;
+        arena->blocks = block;
+    }
+
+    char * p = block->data + block->used;
+    block->used += n;
+    return p;
+}
+
+void stringArenaInit(struct stringArena * arena) {
+    arena->blocks     = NULL;
+    arena->entries    = NULL;
+    arena->entriesCap = 0;
+    arena->entriesLen = 0;
+}
+
+void stringArenaFree(struct stringArena * arena) {
+    while (arena->blocks != NULL) {
+        struct arenaBlock * next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+    free(arena->entries);
+    stringArenaInit(arena);
+}
+
+void stringArenaClear(struct stringArena * arena) {
+    if (arena->blocks == NULL)
+        return;
+
+    // Keep the oldest block so the next scene doesn't start from nothing
+    struct arenaBlock * keep = arena->blocks;
+    while (keep->next != NULL) {
+        struct arenaBlock * next = keep->next;
+        free(keep);
+        keep = next;
+    }
+    keep->used    = 0;
+    arena->blocks = keep;
+
+    if (arena->entries != NULL)
+        memset(arena->entries, 0,
+          arena->entriesCap * sizeof(struct internEntry));
+    arena->entriesLen = 0;
+}
+
+const char * stringArenaIntern(struct stringArena * arena, const char * text) {
+    if (text == NULL)
+        return NULL;
+
+    // Keep the table at most half full
+    if ((arena->entriesLen + 1) * 2 > arena->entriesCap)
+        growTable(arena);
+
+    uint32_t hash = hashText(text);
+    uint32_t slot = findSlot(arena, text, hash);
+    if (arena->entries[slot].text != NULL)
+        return arena->entries[slot].text;
+
+    size_t n    = strlen(text) + 1;
+    char * copy = allocate(arena, n);
+    memcpy(copy, text, n);
+
+    arena->entries[slot] = (struct internEntry) { copy, hash };
+    arena->entriesLen++;
+    return copy;
+}
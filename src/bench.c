@@ -0,0 +1,973 @@
+/**
+ * Canvas Demo headless benchmark
+ *
+ * Generates a synthetic scene and times the per-frame code paths that don't
+ * need a window: hit-testing, selection and group moves, projection, culling,
+ * edge density images, building the cluster draw list and keeping the
+ * minimap up to date, plus index building, route queries, scene file I/O,
+ * the autosave journal, graph import, image export and paging tiles out and
+ * back in while panning. Meant for catching performance regressions on
+ * machines without a GPU, so nothing here may call into raylib; only its
+ * types are used.
+ *
+ * The journal stage also checks that replaying the journal gives back the
+ * scene it was written from, and the paging stage that a scene saved from
+ * pages and loaded back into them is whole; the benchmark exits with status
+ * 1 if not.
+ *
+ * usage: canvas_bench [--objects N] [--connections N] [--shape NAME]
+ *                     [--world SIZE] [--iterations N] [--seed N] [--csv]
+ *                     [--no-io]
+ */
+
+// Standard library header includes -------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Project header includes ----------------------------------------------------
+#include "viewport.h"
+#include "store.h"
+#include "spatial.h"
+#include "cull.h"
+#include "cluster.h"
+#include "pick.h"
+#include "scenefile.h"
+#include "synth.h"
+#include "timing.h"
+#include "adjacency.h"
+#include "selection.h"
+#include "edgedensity.h"
+#include "pager.h"
+#include "pathfind.h"
+#include "importer.h"
+#include "export.h"
+#include "minimap.h"
+#include "journal.h"
+
+/*****************************************************************************
+* Macros and Constants
+*****************************************************************************/
+#define SCREEN_WIDTH            960
+#define SCREEN_HEIGHT           480
+#define MINOR_GRIDLINE_DISTANCE 100
+#define GRID_BUCKETS            1024
+#define CLUSTER_MIN_PX          48
+#define BENCH_SCENE_PATH        "canvas_bench.cvs"
+#define BENCH_PAGE_DIR          "canvas_bench_pages"
+#define BENCH_EDGE_LIST_PATH    "canvas_bench.edges"
+#define BENCH_EXPORT_PATH       "canvas_bench.png"
+#define BENCH_EXPORT_WIDTH      4096
+#define BENCH_AUTOSAVE_PATH     "canvas_bench_autosave.cvs"
+#define BENCH_JOURNAL_PATH      BENCH_AUTOSAVE_PATH ".journal"
+#define BENCH_EXPECTED_PATH     "canvas_bench_expected.cvs"
+
+// Rounds of edits journaled at a time, few enough to stay under
+// JOURNAL_MIN_CHECKPOINT
+#define BENCH_JOURNAL_EDITS     1000
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct benchOptions {
+    struct synthParams synth;
+    int                iterations;
+    int                csv;
+    int                io;
+};
+
+/**
+ * A scene of its own, for the stages that edit one.
+ */
+struct benchScene {
+    struct objectStore     objs;
+    struct connectionStore cons;
+    struct stringArena     labels;
+};
+
+/*****************************************************************************
+* Global Variables
+*****************************************************************************/
+struct objectStore objs;
+struct connectionStore cons;
+struct stringArena labels;
+struct spatialGrid objGrid;
+struct clusterIndex clusters;
+struct adjacencyIndex adjacency;
+int maxObjectRadius = 0;
+
+// Keeps the compiler from throwing away work whose result isn't used
+volatile long sink;
+
+/*****************************************************************************
+* Functions
+*****************************************************************************/
+
+/**
+ * Prints one line of results. items is how many things the stage processed
+ * in total, for the throughput column.
+ */
+static void report(struct benchOptions * opts, const char * stage,
+  int iterations, double seconds, double items) {
+    double ms = seconds * 1000;
+
+    if (opts->csv)
+        printf("%s,%d,%.3f,%.4f,%.0f\n", stage, iterations, ms,
+          ms / iterations, items / seconds);
+    else
+        printf("%-14s %6d %12.3f %12.4f %16.0f\n", stage, iterations, ms,
+          ms / iterations, items / seconds);
+}
+
+/**
+ * A viewport somewhere on the plane, picked deterministically from i.
+ */
+static struct viewport viewportAt(struct benchOptions * opts, int i,
+  float scale) {
+    int world = opts->synth.worldSize;
+    struct viewport vp = {
+        .y     = (int) ((i * 7919L) % world) - SCREEN_HEIGHT / 2,
+        .x     = (int) ((i * 104729L) % world) - SCREEN_WIDTH / 2,
+        .w     = SCREEN_WIDTH,
+        .h     = SCREEN_HEIGHT,
+        .scale = scale
+    };
+
+    return vp;
+}
+
+static void clusterCount(int y, int x, uint32_t count, void * ctx) {
+    (*(long *) ctx)++;
+}
+
+static void benchIndexes(struct benchOptions * opts) {
+    double start = monotonicSeconds();
+
+    for (uint32_t i = 0; i < objs.len; i++) {
+        int y = OBJECT_FIELD(&objs, y, i);
+        int x = OBJECT_FIELD(&objs, x, i);
+        spatialGridInsert(&objGrid, OBJECT_FIELD(&objs, slot, i), y, x);
+        clusterAdd(&clusters, y, x);
+        if (OBJECT_FIELD(&objs, radius, i) > maxObjectRadius)
+            maxObjectRadius = OBJECT_FIELD(&objs, radius, i);
+    }
+    report(opts, "index", 1, monotonicSeconds() - start, objs.len);
+}
+
+static void benchHitTest(struct benchOptions * opts) {
+    // One cursor position per simulated frame, half of them on an object
+    int    n     = opts->iterations * 100;
+    long   hits  = 0;
+    double start = monotonicSeconds();
+
+    for (int i = 0; i < n; i++) {
+        int y, x;
+        if (i % 2 == 0 && objs.len > 0) {
+            uint32_t d = (i * 2654435761u) % objs.len;
+            y = OBJECT_FIELD(&objs, y, d) + 3;
+            x = OBJECT_FIELD(&objs, x, d) - 3;
+        } else {
+            struct viewport vp = viewportAt(opts, i, 1);
+            y = vp.y;
+            x = vp.x;
+        }
+        struct handle h = pickObject(&objGrid, &objs, y, x, 2,
+            maxObjectRadius);
+        hits += h.index != STORE_NONE;
+    }
+    sink = hits;
+    report(opts, "hit-test", n, monotonicSeconds() - start, n);
+}
+
+/**
+ * Moves a selected object as the editor does, keeping the grid and the
+ * clusters in step.
+ */
+static void moveSelected(struct selection * sel, uint32_t i) {
+    uint32_t d    = objs.slots.dense[sel->slots[i]];
+    int      oldY = OBJECT_FIELD(&objs, y, d);
+    int      oldX = OBJECT_FIELD(&objs, x, d);
+
+    OBJECT_FIELD(&objs, y, d) = sel->y[i];
+    OBJECT_FIELD(&objs, x, d) = sel->x[i];
+    spatialGridMove(&objGrid, sel->slots[i], oldY, oldX, sel->y[i], sel->x[i]);
+    clusterMove(&clusters, oldY, oldX, sel->y[i], sel->x[i]);
+}
+
+static void benchSelection(struct benchOptions * opts) {
+    struct selection sel;
+    int    world = opts->synth.worldSize;
+    long   found = 0;
+
+    // Boxes a tenth of the world across
+    selectionInit(&sel);
+    double start = monotonicSeconds();
+    for (int it = 0; it < opts->iterations; it++) {
+        struct viewport vp = viewportAt(opts, it, 1);
+        selectionClear(&sel);
+        selectBox(&sel, &objGrid, &objs, vp.y, vp.x, vp.y + world / 10,
+          vp.x + world / 10);
+        found += sel.len;
+    }
+    sink = found;
+    report(opts, "box-select", opts->iterations, monotonicSeconds() - start,
+      found);
+
+    // Drag the last box around for a while, one move per simulated frame,
+    // ending where it started
+    selectionBeginMove(&sel, &objs);
+    start = monotonicSeconds();
+    for (int it = 0; it <= opts->iterations; it++) {
+        int offset = it < opts->iterations ? (it % 50) * 7 : 0;
+        selectionOffset(&sel, offset, -offset);
+        for (uint32_t i = 0; i < sel.len; i++)
+            moveSelected(&sel, i);
+    }
+    report(opts, "group-move", opts->iterations + 1,
+      monotonicSeconds() - start, (double) sel.len * (opts->iterations + 1));
+    selectionFree(&sel);
+}
+
+static void countEdge(struct handle con, void * ctx) {
+    (*(long *) ctx)++;
+}
+
+static void benchAdjacency(struct benchOptions * opts) {
+    double start = monotonicSeconds();
+
+    adjacencyRebuild(&adjacency, &cons);
+    report(opts, "adjacency", 1, monotonicSeconds() - start, cons.len);
+
+    // The edges of one node per simulated frame, as when deleting a node
+    int  n     = opts->iterations * 100;
+    long edges = 0;
+    start = monotonicSeconds();
+    for (int i = 0; i < n && objs.len > 0; i++) {
+        uint32_t d = (i * 2654435761u) % objs.len;
+        adjacencyQuery(&adjacency, &cons, objectStoreHandle(&objs, d),
+          countEdge, &edges);
+    }
+    sink = edges;
+    report(opts, "edge-query", n, monotonicSeconds() - start, n);
+}
+
+/**
+ * Routes between objects a fixed stride apart in the store. The snapshot is
+ * what the game loop waits for; the query runs on the search thread.
+ */
+static void benchPaths(struct benchOptions * opts) {
+    struct pathFinder finder;
+    int               n        = opts->iterations / 10 + 1;
+    double            snapshot = 0;
+    long              expanded = 0;
+
+    pathFinderInit(&finder);
+    double start = monotonicSeconds();
+    for (int i = 0; i < n && objs.len > 1; i++) {
+        uint32_t a = (i * 2654435761u) % objs.len;
+        uint32_t b = (a + objs.len / 2) % objs.len;
+
+        double begin = monotonicSeconds();
+        pathFinderStart(&finder, &objs, &cons, objectStoreHandle(&objs, a),
+          objectStoreHandle(&objs, b));
+        snapshot += monotonicSeconds() - begin;
+        while (!pathFinderPoll(&finder))
+            ;
+        expanded += finder.expanded;
+    }
+    double elapsed = monotonicSeconds() - start;
+    sink = expanded;
+    report(opts, "path-snapshot", n, snapshot, objs.len + cons.len);
+    report(opts, "path-query", n, elapsed, expanded);
+    pathFinderFree(&finder);
+} /* benchPaths */
+
+/**
+ * Projects every object with projectBatch(), as the culling pass does, and
+ * a point at a time for comparison.
+ */
+static void benchProjection(struct benchOptions * opts) {
+    float *   ys      = malloc(STORE_CHUNK_SIZE * sizeof(float));
+    float *   xs      = malloc(STORE_CHUNK_SIZE * sizeof(float));
+    uint8_t * visible = malloc(STORE_CHUNK_SIZE);
+    long      acc     = 0;
+    double    start   = monotonicSeconds();
+
+    for (int it = 0; it < opts->iterations; it++) {
+        struct viewport vp = viewportAt(opts, it, 1);
+        for (uint32_t c = 0; c < STORE_CHUNKS_USED(objs.len); c++) {
+            struct objectChunk * chunk = objs.chunks[c];
+            uint32_t n = STORE_CHUNK_LEN(objs.len, c);
+            projectBatch(&vp, chunk->y, chunk->x, chunk->radius, n, 0, ys,
+              xs, visible);
+            acc += visible[n - 1];
+        }
+    }
+    report(opts, "projection", opts->iterations, monotonicSeconds() - start,
+      (double) objs.len * opts->iterations);
+
+    start = monotonicSeconds();
+    for (int it = 0; it < opts->iterations; it++) {
+        struct viewport vp = viewportAt(opts, it, 1);
+        for (uint32_t c = 0; c < STORE_CHUNKS_USED(objs.len); c++) {
+            struct objectChunk * chunk = objs.chunks[c];
+            uint32_t n = STORE_CHUNK_LEN(objs.len, c);
+            for (uint32_t i = 0; i < n; i++)
+                acc += projectX(&vp, chunk->x[i]) + projectY(&vp, chunk->y[i]);
+        }
+    }
+    sink = acc;
+    report(opts, "project-scalar", opts->iterations,
+      monotonicSeconds() - start, (double) objs.len * opts->iterations);
+
+    free(ys);
+    free(xs);
+    free(visible);
+} /* benchProjection */
+
+static void benchCulling(struct benchOptions * opts) {
+    struct visibleSet visible;
+    long   drawn = 0;
+
+    visibleSetInit(&visible);
+    double start = monotonicSeconds();
+    for (int it = 0; it < opts->iterations; it++) {
+        struct viewport vp = viewportAt(opts, it, 1);
+        buildVisibleSet(&visible, &vp, &objs, &cons, 0);
+        drawn += visible.objectsLen + visible.connectionsLen;
+    }
+    double elapsed = monotonicSeconds() - start;
+    sink = drawn;
+    report(opts, "culling", opts->iterations, elapsed,
+      (double) (objs.len + cons.len) * opts->iterations);
+    if (!opts->csv)
+        printf("%-14s %.1f objects+connections visible per frame\n", "",
+          (double) drawn / opts->iterations);
+    visibleSetFree(&visible);
+}
+
+static void benchEdgeDensity(struct benchOptions * opts) {
+    struct visibleSet  visible;
+    struct edgeDensity density;
+
+    // Zoomed out far enough that a good share of all edges is on screen
+    visibleSetInit(&visible);
+    edgeDensityInit(&density, SCREEN_WIDTH, SCREEN_HEIGHT, 1);
+    long   edges   = 0;
+    double elapsed = 0;
+    for (int it = 0; it < opts->iterations; it++) {
+        struct viewport vp = viewportAt(opts, it, 0.05f);
+        buildVisibleSet(&visible, &vp, &objs, &cons, 0);
+
+        double start = monotonicSeconds();
+        edgeDensityBuild(&density, visible.connections, visible.connectionsLen,
+          BLACK);
+        elapsed += monotonicSeconds() - start;
+        edges   += visible.connectionsLen;
+    }
+    sink = edges;
+    report(opts, "edge-density", opts->iterations, elapsed, edges);
+    edgeDensityFree(&density);
+    visibleSetFree(&visible);
+}
+
+static void benchClusters(struct benchOptions * opts) {
+    // Zoomed all the way out, where clusters stand in for objects
+    long   markers = 0;
+    double start   = monotonicSeconds();
+
+    for (int it = 0; it < opts->iterations; it++) {
+        struct viewport vp = viewportAt(opts, it, MIN_ZOOM);
+        int level = clusterLevelFor(vp.scale, CLUSTER_MIN_PX);
+        int pad   = clusters.levels[level].cellSize;
+        clusterQuery(&clusters, level, vp.y - pad, vp.x - pad,
+          vp.y + worldHeight(&vp) + pad, vp.x + worldWidth(&vp) + pad,
+          clusterCount, &markers);
+    }
+    double elapsed = monotonicSeconds() - start;
+    sink = markers;
+    report(opts, "cluster-list", opts->iterations, elapsed, markers);
+}
+
+/**
+ * Counts every object into a minimap, then nudges every object a little
+ * each iteration, as a running layout would.
+ */
+static void benchMinimap(struct benchOptions * opts) {
+    struct minimap map;
+
+    minimapInit(&map);
+    double start = monotonicSeconds();
+    minimapRebuild(&map, &objs);
+    report(opts, "minimap-build", 1, monotonicSeconds() - start, objs.len);
+
+    start = monotonicSeconds();
+    for (int it = 0; it < opts->iterations; it++) {
+        int d = it % 2 ? -7 : 7;
+        for (uint32_t i = 0; i < objs.len; i++) {
+            int y = OBJECT_FIELD(&objs, y, i);
+            int x = OBJECT_FIELD(&objs, x, i);
+            minimapMove(&map, y, x, y + d, x + d);
+            minimapMove(&map, y + d, x + d, y, x);
+        }
+    }
+    sink = minimapTakeDirty(&map);
+    report(opts, "minimap-move", opts->iterations,
+      monotonicSeconds() - start, 2.0 * objs.len * opts->iterations);
+    minimapFree(&map);
+}
+
+static void benchSceneFile(struct benchOptions * opts) {
+    double start = monotonicSeconds();
+
+    if (sceneSave(BENCH_SCENE_PATH, &objs, &cons, 0) != 0) {
+        fprintf(stderr, "could not write %s\n", BENCH_SCENE_PATH);
+        return;
+    }
+    report(opts, "scene-save", 1, monotonicSeconds() - start,
+      objs.len + cons.len);
+
+    struct objectStore loadedObjs;
+    struct connectionStore loadedCons;
+    struct stringArena loadedLabels;
+    objectStoreInit(&loadedObjs);
+    connectionStoreInit(&loadedCons);
+    stringArenaInit(&loadedLabels);
+
+    start = monotonicSeconds();
+    if (sceneLoad(BENCH_SCENE_PATH, &loadedObjs, &loadedCons,
+      &loadedLabels, NULL) != 0)
+        fprintf(stderr, "could not read %s\n", BENCH_SCENE_PATH);
+    else
+        report(opts, "scene-load", 1, monotonicSeconds() - start,
+          loadedObjs.len + loadedCons.len);
+
+    objectStoreFree(&loadedObjs);
+    connectionStoreFree(&loadedCons);
+    stringArenaFree(&loadedLabels);
+    remove(BENCH_SCENE_PATH);
+} /* benchSceneFile */
+
+static void benchSceneInit(struct benchScene * scene) {
+    objectStoreInit(&scene->objs);
+    connectionStoreInit(&scene->cons);
+    stringArenaInit(&scene->labels);
+}
+
+static void benchSceneFree(struct benchScene * scene) {
+    objectStoreFree(&scene->objs);
+    connectionStoreFree(&scene->cons);
+    stringArenaFree(&scene->labels);
+}
+
+static uint32_t nextRandom(uint32_t * state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/**
+ * Makes n rounds of edits to the scene and journals them. Each round adds
+ * an object, connects it to an existing one, and moves and relabels that
+ * one; every fourth round also adds an object and deletes it again, so the
+ * next add reuses its slot.
+ */
+static void journalEdits(struct journal * j, struct benchScene * scene,
+  int n, int world, uint32_t * seed) {
+    for (int k = 0; k < n; k++) {
+        uint32_t      other  = nextRandom(seed) % scene->objs.len;
+        struct handle target = objectStoreHandle(&scene->objs, other);
+        struct object obj    = {
+            .type   = DOT,
+            .radius = 8,
+            .color  = { 0, 82, 172, 255 },
+            .label  = stringArenaIntern(&scene->labels, "journaled"),
+            .y      = nextRandom(seed) % world,
+            .x      = nextRandom(seed) % world
+        };
+        struct handle h = objectStoreAdd(&scene->objs, obj);
+        journalAdd(j, h, obj);
+
+        struct connection con = {
+            .width = 1,
+            .color = { 0, 0, 0, 255 },
+            .src   = h,
+            .dest  = target
+        };
+        connectionStoreAdd(&scene->cons, con);
+        journalConnect(j, con);
+
+        int y = nextRandom(seed) % world;
+        int x = nextRandom(seed) % world;
+        OBJECT_FIELD(&scene->objs, y, other) = y;
+        OBJECT_FIELD(&scene->objs, x, other) = x;
+        journalMove(j, target, y, x);
+
+        char label[32];
+        snprintf(label, sizeof(label), "edit %d", k);
+        OBJECT_FIELD(&scene->objs, label, other) =
+          stringArenaIntern(&scene->labels, label);
+        journalRelabel(j, target, label);
+
+        if (k % 4 == 0) {
+            struct handle gone = objectStoreAdd(&scene->objs, obj);
+            journalAdd(j, gone, obj);
+            objectStoreRemove(&scene->objs, gone);
+            journalDelete(j, gone);
+        }
+    }
+} /* journalEdits */
+
+static void replayLoaded(void * ctx) {
+}
+
+static void replayAdd(struct handle h, struct object obj, void * ctx) {
+    struct benchScene * scene = ctx;
+
+    obj.label = stringArenaIntern(&scene->labels, obj.label);
+    objectStoreAddAt(&scene->objs, h, obj);
+}
+
+static void replayMove(struct handle h, int y, int x, void * ctx) {
+    struct benchScene * scene = ctx;
+    uint32_t            i     = objectStoreDense(&scene->objs, h);
+
+    if (i == STORE_NONE)
+        return;
+    OBJECT_FIELD(&scene->objs, y, i) = y;
+    OBJECT_FIELD(&scene->objs, x, i) = x;
+}
+
+static void replayConnect(struct connection con, void * ctx) {
+    struct benchScene * scene = ctx;
+
+    con.label = stringArenaIntern(&scene->labels, con.label);
+    connectionStoreAdd(&scene->cons, con);
+}
+
+static void replayRelabel(struct handle h, const char * label, void * ctx) {
+    struct benchScene * scene = ctx;
+    uint32_t            i     = objectStoreDense(&scene->objs, h);
+
+    if (i != STORE_NONE)
+        OBJECT_FIELD(&scene->objs, label, i) =
+          stringArenaIntern(&scene->labels, label);
+}
+
+static void replayRemove(struct handle h, void * ctx) {
+    struct benchScene * scene = ctx;
+
+    objectStoreRemove(&scene->objs, h);
+}
+
+static int sameLabel(const char * a, const char * b) {
+    return a == NULL || b == NULL ? a == b : strcmp(a, b) == 0;
+}
+
+static int sameColor(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+/**
+ * Returns 1 if both scenes have the same objects under the same handles,
+ * and the same connections in the same order.
+ */
+/**
+ * Compares objects by handle, whatever order they are stored in.
+ */
+static int sameObjects(struct objectStore * a, struct objectStore * b) {
+    if (a->len != b->len)
+        return 0;
+
+    for (uint32_t i = 0; i < a->len; i++) {
+        struct handle h = objectStoreHandle(a, i);
+        uint32_t      k = objectStoreDense(b, h);
+        if (k == STORE_NONE
+          || OBJECT_FIELD(a, y, i) != OBJECT_FIELD(b, y, k)
+          || OBJECT_FIELD(a, x, i) != OBJECT_FIELD(b, x, k)
+          || OBJECT_FIELD(a, radius, i) != OBJECT_FIELD(b, radius, k)
+          || OBJECT_FIELD(a, type, i) != OBJECT_FIELD(b, type, k)
+          || OBJECT_FIELD(a, sticky, i) != OBJECT_FIELD(b, sticky, k)
+          || !sameColor(OBJECT_FIELD(a, color, i), OBJECT_FIELD(b, color, k))
+          || !sameLabel(OBJECT_FIELD(a, label, i), OBJECT_FIELD(b, label, k)))
+            return 0;
+    }
+    return 1;
+}
+
+static int sameScene(struct benchScene * a, struct benchScene * b) {
+    if (!sameObjects(&a->objs, &b->objs) || a->cons.len != b->cons.len)
+        return 0;
+
+    for (uint32_t i = 0; i < a->cons.len; i++) {
+        if (!handleEqual(CONNECTION_FIELD(&a->cons, src, i),
+          CONNECTION_FIELD(&b->cons, src, i))
+          || !handleEqual(CONNECTION_FIELD(&a->cons, dest, i),
+          CONNECTION_FIELD(&b->cons, dest, i))
+          || CONNECTION_FIELD(&a->cons, width, i)
+          != CONNECTION_FIELD(&b->cons, width, i)
+          || !sameColor(CONNECTION_FIELD(&a->cons, color, i),
+          CONNECTION_FIELD(&b->cons, color, i))
+          || !sameLabel(CONNECTION_FIELD(&a->cons, label, i),
+          CONNECTION_FIELD(&b->cons, label, i)))
+            return 0;
+    }
+    return 1;
+} /* sameScene */
+
+/**
+ * Cuts the file at path down to its first len bytes, like a crash in the
+ * middle of a write.
+ */
+static int truncateFile(const char * path, size_t len) {
+    FILE * f = fopen(path, "rb");
+
+    if (f == NULL)
+        return -1;
+    char * data = malloc(len);
+    size_t got  = fread(data, 1, len, f);
+    fclose(f);
+
+    f = fopen(path, "wb");
+    if (f == NULL) {
+        free(data);
+        return -1;
+    }
+    fwrite(data, 1, got, f);
+    free(data);
+    return fclose(f) == 0 && got == len ? 0 : -1;
+}
+
+/**
+ * Journals edits against a checkpoint and recovers from it, timing both,
+ * and checks what recovery gives back: the scene as of the last whole
+ * record when the journal ends in a torn one, and just the checkpoint when
+ * the journal is older than the checkpoint. Returns -1 if either is not
+ * the scene it should be.
+ */
+static int benchJournal(struct benchOptions * opts) {
+    struct benchScene     live, expected, recovered;
+    struct journal        j;
+    struct journalHandler handler = {
+        .loaded  = replayLoaded,
+        .add     = replayAdd,
+        .move    = replayMove,
+        .connect = replayConnect,
+        .relabel = replayRelabel,
+        .remove  = replayRemove
+    };
+    uint32_t seed = opts->synth.seed;
+    int      err  = -1;
+
+    benchSceneInit(&live);
+    benchSceneInit(&expected);
+    benchSceneInit(&recovered);
+    synthGenerate(&opts->synth, &live.objs, &live.cons, &live.labels);
+
+    journalInit(&j, BENCH_AUTOSAVE_PATH);
+    if (live.objs.len == 0 || journalCheckpoint(&j, &live.objs, &live.cons)
+      != 0) {
+        fprintf(stderr, "could not write %s\n", BENCH_AUTOSAVE_PATH);
+        journalClose(&j);
+        goto done;
+    }
+
+    double start = monotonicSeconds();
+    journalEdits(&j, &live, BENCH_JOURNAL_EDITS, opts->synth.worldSize,
+      &seed);
+    journalTick(&j, &live.objs, &live.cons, start);
+    report(opts, "journal-write", 1, monotonicSeconds() - start,
+      BENCH_JOURNAL_EDITS);
+
+    // What recovery should give back once the next batch is torn off
+    size_t   whole      = j.bytes;
+    uint32_t checkpoint = j.checkpoint;
+    sceneSave(BENCH_EXPECTED_PATH, &live.objs, &live.cons, 0);
+    journalEdits(&j, &live, BENCH_JOURNAL_EDITS, opts->synth.worldSize,
+      &seed);
+    journalClose(&j);
+    if (truncateFile(BENCH_JOURNAL_PATH,
+      whole + sizeof(struct journalRecord) + 2) != 0
+      || sceneLoad(BENCH_EXPECTED_PATH, &expected.objs, &expected.cons,
+      &expected.labels, NULL) != 0) {
+        fprintf(stderr, "could not rewrite %s\n", BENCH_JOURNAL_PATH);
+        goto done;
+    }
+
+    journalInit(&j, BENCH_AUTOSAVE_PATH);
+    start = monotonicSeconds();
+    int recoverErr = journalRecover(&j, &recovered.objs, &recovered.cons,
+      &recovered.labels, &handler, &recovered);
+    report(opts, "journal-replay", 1, monotonicSeconds() - start,
+      recovered.objs.len + recovered.cons.len);
+    journalClose(&j);
+    if (recoverErr != 0 || !sameScene(&recovered, &expected)) {
+        fprintf(stderr, "journal replay did not give back the scene\n");
+        goto done;
+    }
+
+    // A checkpoint newer than the journal, as a crash right after writing
+    // a checkpoint leaves them
+    benchSceneFree(&recovered);
+    benchSceneInit(&recovered);
+    sceneSave(BENCH_AUTOSAVE_PATH, &expected.objs, &expected.cons,
+      checkpoint + 1);
+    journalInit(&j, BENCH_AUTOSAVE_PATH);
+    recoverErr = journalRecover(&j, &recovered.objs, &recovered.cons,
+      &recovered.labels, &handler, &recovered);
+    journalClose(&j);
+    if (recoverErr != 0 || !sameScene(&recovered, &expected)) {
+        fprintf(stderr, "journal replay applied a stale journal\n");
+        goto done;
+    }
+    err = 0;
+
+done:
+    benchSceneFree(&live);
+    benchSceneFree(&expected);
+    benchSceneFree(&recovered);
+    remove(BENCH_AUTOSAVE_PATH);
+    remove(BENCH_JOURNAL_PATH);
+    remove(BENCH_EXPECTED_PATH);
+    return err;
+} /* benchJournal */
+
+/**
+ * Writes the scene's connections out as an edge list and imports it into
+ * a fresh set of stores.
+ */
+static void benchImport(struct benchOptions * opts) {
+    FILE * f = fopen(BENCH_EDGE_LIST_PATH, "w");
+
+    if (f == NULL) {
+        fprintf(stderr, "could not write %s\n", BENCH_EDGE_LIST_PATH);
+        return;
+    }
+    for (uint32_t i = 0; i < cons.len; i++)
+        fprintf(f, "n%u n%u\n",
+          objectStoreDense(&objs, CONNECTION_FIELD(&cons, src, i)),
+          objectStoreDense(&objs, CONNECTION_FIELD(&cons, dest, i)));
+    fclose(f);
+
+    struct objectStore importedObjs;
+    struct connectionStore importedCons;
+    struct stringArena importedLabels;
+    struct importStats stats;
+    objectStoreInit(&importedObjs);
+    connectionStoreInit(&importedCons);
+    stringArenaInit(&importedLabels);
+
+    double start = monotonicSeconds();
+    if (importGraph(BENCH_EDGE_LIST_PATH, IMPORT_EDGE_LIST, &importedObjs,
+      &importedCons, &importedLabels, &stats) != 0)
+        fprintf(stderr, "could not read %s\n", BENCH_EDGE_LIST_PATH);
+    else
+        report(opts, "import", 1, monotonicSeconds() - start, stats.edges);
+
+    objectStoreFree(&importedObjs);
+    connectionStoreFree(&importedCons);
+    stringArenaFree(&importedLabels);
+    remove(BENCH_EDGE_LIST_PATH);
+} /* benchImport */
+
+/**
+ * Rasterizes the whole scene into a PNG, BENCH_EXPORT_WIDTH pixels wide.
+ */
+static void benchExport(struct benchOptions * opts) {
+    struct exportRect  rect;
+    struct exportStats stats;
+
+    exportSceneBounds(&objs, NULL, &rect);
+    double start = monotonicSeconds();
+    if (exportPng(BENCH_EXPORT_PATH, &objs, &cons, NULL, &rect,
+      BENCH_EXPORT_WIDTH, &stats) != 0)
+        fprintf(stderr, "could not write %s\n", BENCH_EXPORT_PATH);
+    else
+        report(opts, "export-png", 1, monotonicSeconds() - start,
+          (double) stats.width * stats.height);
+    remove(BENCH_EXPORT_PATH);
+}
+
+/**
+ * Pans diagonally across the world one frame at a time, paging tiles in
+ * and out, saves the paged scene and brings it all back. Then loads the
+ * save straight into pages and brings that back too. Runs last, since it
+ * leaves the indexes out of date. Returns -1 if either the save or the
+ * load lost anything.
+ */
+static int benchPaging(struct benchOptions * opts) {
+    struct pager          pager;
+    struct pagerHandler   handler = { 0 };
+    struct benchScene     loaded;
+    struct adjacencyIndex loadedAdjacency;
+    int                   err = -1;
+
+    if (pagerInit(&pager, BENCH_PAGE_DIR, MINOR_GRIDLINE_DISTANCE * 32) != 0) {
+        fprintf(stderr, "could not create %s\n", BENCH_PAGE_DIR);
+        return -1;
+    }
+
+    double start = monotonicSeconds();
+    for (int it = 0; it < opts->iterations; it++) {
+        int pos = (long) it * opts->synth.worldSize / opts->iterations;
+        pagerUpdate(&pager, &objs, &cons, &adjacency, &labels, &handler, NULL,
+          pos, pos, SCREEN_HEIGHT, SCREEN_WIDTH, it / 60.0);
+    }
+    report(opts, "page-pan", opts->iterations, monotonicSeconds() - start,
+      pager.evicted + pager.restored);
+
+    uint32_t total = objs.len + pager.evicted - pager.restored;
+    start = monotonicSeconds();
+    if (pagerSaveScene(&pager, BENCH_SCENE_PATH, &objs, &cons, 0) != 0)
+        fprintf(stderr, "could not write %s\n", BENCH_SCENE_PATH);
+    else
+        report(opts, "page-save", 1, monotonicSeconds() - start, total);
+
+    uint32_t restored = pager.restored;
+    start = monotonicSeconds();
+    pagerRestoreAll(&pager, &objs, &cons, &adjacency, &labels, &handler,
+      NULL);
+    report(opts, "page-restore", 1, monotonicSeconds() - start,
+      pager.restored - restored);
+
+    pagerClear(&pager);
+    benchSceneInit(&loaded);
+    adjacencyInit(&loadedAdjacency);
+    start = monotonicSeconds();
+    if (pagerLoadScene(&pager, BENCH_SCENE_PATH, &loaded.objs, &loaded.cons,
+      &loaded.labels, &handler, NULL, 0, 0, SCREEN_HEIGHT,
+      SCREEN_WIDTH) != 0) {
+        fprintf(stderr, "could not read %s\n", BENCH_SCENE_PATH);
+        goto done;
+    }
+    report(opts, "page-load", 1, monotonicSeconds() - start, total);
+
+    // Everything saved from the pages, and loaded back into them, is there
+    adjacencyRebuild(&loadedAdjacency, &loaded.cons);
+    pagerRestoreAll(&pager, &loaded.objs, &loaded.cons, &loadedAdjacency,
+      &loaded.labels, &handler, NULL);
+    if (!sameObjects(&loaded.objs, &objs) || loaded.cons.len != cons.len) {
+        fprintf(stderr, "paged save and load lost objects or connections: "
+          "%u/%u and %u/%u\n", loaded.objs.len, objs.len, loaded.cons.len,
+          cons.len);
+        goto done;
+    }
+    err = 0;
+
+done:
+    adjacencyFree(&loadedAdjacency);
+    benchSceneFree(&loaded);
+    pagerFree(&pager);
+    remove(BENCH_SCENE_PATH);
+    remove(BENCH_PAGE_DIR);
+    return err;
+} /* benchPaging */
+
+static int parseOptions(int argc, char ** argv, struct benchOptions * opts) {
+    for (int i = 1; i < argc; i++) {
+        const char * arg  = argv[i];
+        const char * next = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--csv") == 0) {
+            opts->csv = 1;
+        } else if (strcmp(arg, "--no-io") == 0) {
+            opts->io = 0;
+        } else if (next == NULL) {
+            return -1;
+        } else if (strcmp(arg, "--objects") == 0) {
+            opts->synth.objects = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--connections") == 0) {
+            opts->synth.connections = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--world") == 0) {
+            opts->synth.worldSize = atoi(argv[++i]);
+        } else if (strcmp(arg, "--iterations") == 0) {
+            opts->iterations = atoi(argv[++i]);
+        } else if (strcmp(arg, "--seed") == 0) {
+            opts->synth.seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(arg, "--shape") == 0) {
+            int shape = synthShapeFromName(argv[++i]);
+            if (shape < 0)
+                return -1;
+            opts->synth.shape = shape;
+        } else {
+            return -1;
+        }
+    }
+
+    return opts->iterations > 0 && opts->synth.worldSize > 0 ? 0 : -1;
+}
+
+/*****************************************************************************
+* Main Function (Point of Entry)
+*****************************************************************************/
+
+int main(int argc, char ** argv) {
+    struct benchOptions opts = {
+        .synth = {
+            .shape       = SYNTH_UNIFORM,
+            .objects     = 100000,
+            .connections = 200000,
+            .worldSize   = 100000,
+            .seed        = 1,
+            .labels      = 1
+        },
+        .iterations = 100,
+        .csv        = 0,
+        .io         = 1
+    };
+    int failed = 0;
+
+    if (parseOptions(argc, argv, &opts) != 0) {
+        fprintf(stderr,
+          "usage: %s [--objects N] [--connections N] "
+          "[--shape uniform|clustered|long] [--world SIZE] "
+          "[--iterations N] [--seed N] [--csv] [--no-io]\n", argv[0]);
+        return 2;
+    }
+
+    objectStoreInit(&objs);
+    connectionStoreInit(&cons);
+    stringArenaInit(&labels);
+    spatialGridInit(&objGrid, MINOR_GRIDLINE_DISTANCE, GRID_BUCKETS);
+    clusterIndexInit(&clusters);
+    adjacencyInit(&adjacency);
+
+    if (opts.csv)
+        printf("stage,iterations,total_ms,ms_per_iteration,items_per_second\n");
+    else
+        printf("%-14s %6s %12s %12s %16s\n", "stage", "iters", "total ms",
+          "ms/iter", "items/s");
+
+    double start = monotonicSeconds();
+    synthGenerate(&opts.synth, &objs, &cons, &labels);
+    report(&opts, "generate", 1, monotonicSeconds() - start,
+      objs.len + cons.len);
+
+    benchIndexes(&opts);
+    benchHitTest(&opts);
+    benchSelection(&opts);
+    benchAdjacency(&opts);
+    benchPaths(&opts);
+    benchProjection(&opts);
+    benchCulling(&opts);
+    benchEdgeDensity(&opts);
+    benchClusters(&opts);
+    benchMinimap(&opts);
+    if (opts.io) {
+        benchSceneFile(&opts);
+        if (benchJournal(&opts) != 0)
+            failed = 1;
+        benchImport(&opts);
+        benchExport(&opts);
+        if (benchPaging(&opts) != 0)
+            failed = 1;
+    }
+
+    spatialGridFree(&objGrid);
+    clusterIndexFree(&clusters);
+    adjacencyFree(&adjacency);
+    objectStoreFree(&objs);
+    connectionStoreFree(&cons);
+    stringArenaFree(&labels);
+    return failed;
+} /* main */
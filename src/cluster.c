@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cluster.h"
+
+static int cellOf(int position, int cellSize) {
+    int q = position / cellSize;
+
+    if ((position % cellSize != 0) && (position < 0))
+        q--;
+    return q;
+}
+
+static uint32_t hashCell(int cy, int cx) {
+    return ((uint32_t) cy * 73856093u) ^ ((uint32_t) cx * 19349663u);
+}
+
+/**
+ * Returns the cell (cy, cx) of a level, or NULL if it was never created.
+ */
+static struct clusterCell * findCell(struct clusterLevel * level, int cy,
+  int cx) {
+    uint32_t mask = level->cap - 1;
+
+    for (uint32_t i = hashCell(cy, cx) & mask;; i = (i + 1) & mask) {
+        struct clusterCell * cell = &level->cells[i];
+        if (!cell->used)
+            return NULL;
+        if (cell->cy == cy && cell->cx == cx)
+            return cell;
+    }
+}
+
+static struct clusterCell * insertCell(struct clusterLevel * level, int cy,
+  int cx);
+
+static void growLevel(struct clusterLevel * level) {
+    struct clusterCell * old = level->cells;
+    uint32_t oldCap = level->cap;
+
+    level->cap   = oldCap * 2;
+    level->cells = calloc(level->cap, sizeof(struct clusterCell));
+    level->len   = 0;
+    for (uint32_t i = 0; i < oldCap; i++) {
+        // Cells which emptied out are dropped while we're at it
+        if (old[i].used && old[i].count > 0) {
+            struct clusterCell * cell = insertCell(level, old[i].cy, old[i].cx);
+            *cell = old[i];
+        }
+    }
+    free(old);
+}
+
+/**
+ * Returns the cell (cy, cx) of a level, creating it if needed.
+ */
+static struct clusterCell * insertCell(struct clusterLevel * level, int cy,
+  int cx) {
+    if ((level->len + 1) * 10 > level->cap * 7)
+        growLevel(level);
+
+    uint32_t mask = level->cap - 1;
+    for (uint32_t i = hashCell(cy, cx) & mask;; i = (i + 1) & mask) {
+        struct clusterCell * cell = &level->cells[i];
+        if (!cell->used) {
+            memset(cell, 0, sizeof(*cell));
+            cell->used = 1;
+            cell->cy   = cy;
+            cell->cx   = cx;
+            level->len++;
+            return cell;
+        }
+        if (cell->cy == cy && cell->cx == cx)
+            return cell;
+    }
+}
+
+void clusterIndexInit(struct clusterIndex * index) {
+    for (int l = 0; l < CLUSTER_LEVELS; l++) {
+        index->levels[l].cellSize = CLUSTER_BASE_CELL << l;
+        index->levels[l].cap      = 64;
+        index->levels[l].len      = 0;
+        index->levels[l].cells    = calloc(64, sizeof(struct clusterCell));
+    }
+}
+
+void clusterIndexFree(struct clusterIndex * index) {
+    for (int l = 0; l < CLUSTER_LEVELS; l++) {
+        free(index->levels[l].cells);
+        index->levels[l].cells = NULL;
+    }
+}
+
+void clusterIndexClear(struct clusterIndex * index) {
+    for (int l = 0; l < CLUSTER_LEVELS; l++) {
+        struct clusterLevel * level = &index->levels[l];
+        memset(level->cells, 0, level->cap * sizeof(struct clusterCell));
+        level->len = 0;
+    }
+}
+
+void clusterAdd(struct clusterIndex * index, int y, int x) {
+    for (int l = 0; l < CLUSTER_LEVELS; l++) {
+        struct clusterLevel * level = &index->levels[l];
+        struct clusterCell *  cell  = insertCell(level,
+            cellOf(y, level->cellSize), cellOf(x, level->cellSize));
+        cell->count++;
+        cell->sumY += y;
+        cell->sumX += x;
+    }
+}
+
+void clusterRemove(struct clusterIndex * index, int y, int x) {
+    for (int l = 0; l < CLUSTER_LEVELS; l++) {
+        struct clusterLevel * level = &index->levels[l];
+        struct clusterCell *  cell  = findCell(level,
+            cellOf(y, level->cellSize), cellOf(x, level->cellSize));
+        if (cell == NULL || cell->count == 0)
+            continue;
+        cell->count--;
+        cell->sumY -= y;
+        cell->sumX -= x;
+    }
+}
+
+void clusterMove(struct clusterIndex * index, int oldY, int oldX, int newY,
+  int newX) {
+    // The centroid shifts even within one cell, so every level is touched,
+    // but only the levels where the cell changes need a second lookup.
+    for (int l = 0; l < CLUSTER_LEVELS; l++) {
+        struct clusterLevel * level = &index->levels[l];
+        int oy = cellOf(oldY, level->cellSize);
+        int ox = cellOf(oldX, level->cellSize);
+        int ny = cellOf(newY, level->cellSize);
+        int nx = cellOf(newX, level->cellSize);
+
+        struct clusterCell * cell = findCell(level, oy, ox);
+        if (cell != NULL && cell->count > 0) {
+            if (oy == ny && ox == nx) {
+                cell->sumY += newY - oldY;
+                cell->sumX += newX - oldX;
+                continue;
+            }
+            cell->count--;
+            cell->sumY -= oldY;
+            cell->sumX -= oldX;
+        }
+
+        cell = insertCell(level, ny, nx);
+        cell->count++;
+        cell->sumY += newY;
+        cell->sumX += newX;
+    }
+}
+
+int clusterLevelFor(float scale, int minPixels) {
+    for (int l = 0; l < CLUSTER_LEVELS; l++)
+        if ((CLUSTER_BASE_CELL << l) * scale >= minPixels)
+            return l;
+    return CLUSTER_LEVELS - 1;
+}
+
+void clusterQuery(struct clusterIndex * index, int level, int minY, int minX,
+  int maxY, int maxX, clusterVisitor visit, void * ctx) {
+    struct clusterLevel * lvl = &index->levels[level];
+    int cy0 = cellOf(minY, lvl->cellSize);
+    int cx0 = cellOf(minX, lvl->cellSize);
+    int cy1 = cellOf(maxY, lvl->cellSize);
+    int cx1 = cellOf(maxX, lvl->cellSize);
+    long cells = (long) (cy1 - cy0 + 1) * (cx1 - cx0 + 1);
+
+    // Pick whichever is smaller to walk: the rectangle's cells or the table
+    if (cells > lvl->cap) {
+        for (uint32_t i = 0; i < lvl->cap; i++) {
+            struct clusterCell * cell = &lvl->cells[i];
+            if (cell->used && cell->count > 0 && cell->cy >= cy0
+              && cell->cy <= cy1 && cell->cx >= cx0 && cell->cx <= cx1)
+                visit(cell->sumY / cell->count, cell->sumX / cell->count,
+                  cell->count, ctx);
+        }
+        return;
+    }
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            struct clusterCell * cell = findCell(lvl, cy, cx);
+            if (cell != NULL && cell->count > 0)
+                visit(cell->sumY / cell->count, cell->sumX / cell->count,
+                  cell->count, ctx);
+        }
+    }
+} /* clusterQuery */
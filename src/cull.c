@@ -0,0 +1,182 @@
+#include <stdlib.h>
+
+#include "cull.h"
+
+// Cohen-Sutherland region codes
+#define INSIDE 0
+#define LEFT   1
+#define RIGHT  2
+#define BOTTOM 4
+#define TOP    8
+
+static int outCode(float minX, float minY, float maxX, float maxY, float x,
+  float y) {
+    int code = INSIDE;
+
+    if (x < minX)
+        code |= LEFT;
+    else if (x > maxX)
+        code |= RIGHT;
+    if (y < minY)
+        code |= BOTTOM;
+    else if (y > maxY)
+        code |= TOP;
+    return code;
+}
+
+int clipLine(float minX, float minY, float maxX, float maxY, float * x0,
+  float * y0, float * x1, float * y1) {
+    int code0 = outCode(minX, minY, maxX, maxY, *x0, *y0);
+    int code1 = outCode(minX, minY, maxX, maxY, *x1, *y1);
+
+    while (1) {
+        // Both ends inside: keep the whole line
+        if (!(code0 | code1))
+            return 1;
+        // Both ends on the same outside side: nothing can be visible
+        if (code0 & code1)
+            return 0;
+
+        // Move the outside endpoint onto the edge it is beyond
+        int   code = code0 ? code0 : code1;
+        float x, y;
+        if (code & TOP) {
+            x = *x0 + (*x1 - *x0) * (maxY - *y0) / (*y1 - *y0);
+            y = maxY;
+        } else if (code & BOTTOM) {
+            x = *x0 + (*x1 - *x0) * (minY - *y0) / (*y1 - *y0);
+            y = minY;
+        } else if (code & RIGHT) {
+            y = *y0 + (*y1 - *y0) * (maxX - *x0) / (*x1 - *x0);
+            x = maxX;
+        } else {
+            y = *y0 + (*y1 - *y0) * (minX - *x0) / (*x1 - *x0);
+            x = minX;
+        }
+
+        if (code == code0) {
+            *x0   = x;
+            *y0   = y;
+            code0 = outCode(minX, minY, maxX, maxY, x, y);
+        } else {
+            *x1   = x;
+            *y1   = y;
+            code1 = outCode(minX, minY, maxX, maxY, x, y);
+        }
+    }
+} /* clipLine */
+
+void visibleSetInit(struct visibleSet * set) {
+    set->objects           = NULL;
+    set->objectsLen        = 0;
+    set->objectsCap        = 0;
+    set->connections       = NULL;
+    set->connectionsLen    = 0;
+    set->connectionsCap    = 0;
+    set->connectionsElided = 0;
+    set->projectedY        = NULL;
+    set->projectedX        = NULL;
+    set->onScreen          = NULL;
+    set->projectedCap      = 0;
+}
+
+void visibleSetFree(struct visibleSet * set) {
+    free(set->objects);
+    free(set->connections);
+    free(set->projectedY);
+    free(set->projectedX);
+    free(set->onScreen);
+    visibleSetInit(set);
+}
+
+static void pushObject(struct visibleSet * set, struct visibleObject o) {
+    if (set->objectsLen == set->objectsCap) {
+        set->objectsCap = set->objectsCap ? set->objectsCap * 2 : 256;
+        set->objects    = realloc(set->objects,
+            set->objectsCap * sizeof(struct visibleObject));
+    }
+    set->objects[set->objectsLen++] = o;
+}
+
+static void pushConnection(struct visibleSet * set,
+  struct visibleConnection c) {
+    if (set->connectionsLen == set->connectionsCap) {
+        set->connectionsCap = set->connectionsCap ? set->connectionsCap * 2 :
+          256;
+        set->connections = realloc(set->connections,
+            set->connectionsCap * sizeof(struct visibleConnection));
+    }
+    set->connections[set->connectionsLen++] = c;
+}
+
+void buildVisibleSet(struct visibleSet * set, struct viewport * vp,
+  struct objectStore * objs, struct connectionStore * cons, int margin) {
+    set->objectsLen        = 0;
+    set->connectionsLen    = 0;
+    set->connectionsElided = 0;
+
+    if (objs->len > set->projectedCap) {
+        set->projectedCap = objs->len * 2;
+        set->projectedY   = realloc(set->projectedY,
+            set->projectedCap * sizeof(float));
+        set->projectedX = realloc(set->projectedX,
+            set->projectedCap * sizeof(float));
+        set->onScreen = realloc(set->onScreen, set->projectedCap);
+    }
+
+    // Objects: project the hot arrays chunk by chunk, keeping anything
+    // whose extent overlaps the screen.
+    for (uint32_t c = 0; c < STORE_CHUNKS_USED(objs->len); c++) {
+        struct objectChunk * chunk = objs->chunks[c];
+        uint32_t n     = STORE_CHUNK_LEN(objs->len, c);
+        uint32_t first = c << STORE_CHUNK_SHIFT;
+
+        projectBatch(vp, chunk->y, chunk->x, chunk->radius, n, margin,
+          set->projectedY + first, set->projectedX + first,
+          set->onScreen + first);
+
+        for (uint32_t i = 0; i < n; i++) {
+            if (set->onScreen[first + i]) {
+                pushObject(set, (struct visibleObject) {
+                    first + i, set->projectedX[first + i],
+                    set->projectedY[first + i]
+                });
+            } else if (chunk->sticky[i]) {
+                // Sticky objects stay on screen, pinned to the border
+                pushObject(set, (struct visibleObject) {
+                    (c << STORE_CHUNK_SHIFT) + i,
+                    clampProjectX(vp, chunk->x[i], 1),
+                    clampProjectY(vp, chunk->y[i], 1)
+                });
+            }
+        }
+    }
+
+    // Connections: clip every edge to the screen so that edges crossing it
+    // with both ends offscreen are still drawn, and only the visible part.
+    for (uint32_t i = 0; i < cons->len; i++) {
+        uint32_t src  = objectStoreDense(objs, CONNECTION_FIELD(cons, src, i));
+        uint32_t dest = objectStoreDense(objs, CONNECTION_FIELD(cons, dest, i));
+        if (src == STORE_NONE || dest == STORE_NONE)
+            continue;
+
+        struct visibleConnection v = {
+            .dense = i,
+            .x0    = set->projectedX[src],
+            .y0    = set->projectedY[src],
+            .x1    = set->projectedX[dest],
+            .y1    = set->projectedY[dest]
+        };
+
+        // Zoomed out, many edges shrink to within a pixel and can't be seen
+        float dx = v.x1 - v.x0;
+        float dy = v.y1 - v.y0;
+        if (dx > -1 && dx < 1 && dy > -1 && dy < 1) {
+            set->connectionsElided++;
+            continue;
+        }
+
+        if (clipLine(0, 0, vp->w, vp->h, &v.x0, &v.y0, &v.x1, &v.y1))
+            pushConnection(set, v);
+    }
+} /* buildVisibleSet */
@@ -0,0 +1,83 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "edgedensity.h"
+
+void edgeDensityInit(struct edgeDensity * density, int screenW, int screenH,
+  int shift) {
+    density->shift  = shift;
+    density->w      = (screenW >> shift) > 0 ? screenW >> shift : 1;
+    density->h      = (screenH >> shift) > 0 ? screenH >> shift : 1;
+    density->counts = malloc(density->w * density->h * sizeof(uint32_t));
+    density->pixels = malloc(density->w * density->h * sizeof(Color));
+    density->stride = 1;
+}
+
+void edgeDensityFree(struct edgeDensity * density) {
+    free(density->counts);
+    free(density->pixels);
+    density->counts = NULL;
+    density->pixels = NULL;
+}
+
+/**
+ * Pixel steps needed to rasterize a connection at the image's resolution.
+ */
+static float stepsFor(struct edgeDensity * density,
+  const struct visibleConnection * c) {
+    float k = 1.0f / (1 << density->shift);
+
+    return fmaxf(fabsf(c->x1 - c->x0), fabsf(c->y1 - c->y0)) * k + 1;
+}
+
+/**
+ * Adds weight to every pixel along a connection, stepping one pixel at a
+ * time along its longer axis.
+ */
+static void rasterize(struct edgeDensity * density,
+  const struct visibleConnection * c, uint32_t weight) {
+    float k     = 1.0f / (1 << density->shift);
+    int   steps = stepsFor(density, c);
+    float x     = c->x0 * k;
+    float y     = c->y0 * k;
+    float dx    = (c->x1 - c->x0) * k / steps;
+    float dy    = (c->y1 - c->y0) * k / steps;
+
+    for (int i = 0; i <= steps; i++, x += dx, y += dy) {
+        // Clipped to the screen already, but the far edge is inclusive
+        int px = x < density->w ? (int) x : density->w - 1;
+        int py = y < density->h ? (int) y : density->h - 1;
+        if (px >= 0 && py >= 0)
+            density->counts[py * density->w + px] += weight;
+    }
+}
+
+void edgeDensityBuild(struct edgeDensity * density,
+  const struct visibleConnection * cons, uint32_t n, Color color) {
+    size_t pixels = (size_t) density->w * density->h;
+
+    memset(density->counts, 0, pixels * sizeof(uint32_t));
+
+    // Thin the connections out evenly if drawing them all would cost more
+    // than the budget
+    double total = 0;
+    for (uint32_t i = 0; i < n; i++)
+        total += stepsFor(density, &cons[i]);
+    density->stride = total > EDGE_DENSITY_BUDGET ?
+      ceil(total / EDGE_DENSITY_BUDGET) : 1;
+
+    for (uint32_t i = 0; i < n; i += density->stride)
+        rasterize(density, &cons[i], density->stride);
+
+    // Darkness grows with the log of the count so that both lone edges and
+    // bundles of thousands still show
+    for (size_t i = 0; i < pixels; i++) {
+        uint32_t c     = density->counts[i];
+        float    alpha = c == 0 ? 0 :
+          EDGE_DENSITY_ALPHA * (1 + log2f(c)) * color.a / 255;
+        density->pixels[i] = (Color) {
+            color.r, color.g, color.b, alpha > 255 ? 255 : alpha
+        };
+    }
+}
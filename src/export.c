@@ -0,0 +1,830 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __EMSCRIPTEN__
+# define EXPORT_THREADS
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#include "export.h"
+#include "pngwriter.h"
+
+#ifdef EXPORT_THREADS
+# define LOCK(band)   pthread_mutex_lock(&(band)->lock)
+# define UNLOCK(band) pthread_mutex_unlock(&(band)->lock)
+#else
+# define LOCK(band)
+# define UNLOCK(band)
+#endif
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+/**
+ * An object, in pixels of the whole image.
+ */
+struct exportDisc {
+    float x, y, r;
+    Color color;
+};
+
+/**
+ * A connection, in pixels of the whole image.
+ */
+struct exportLine {
+    float x0, y0, x1, y1;
+    float halfWidth;
+    Color color;
+};
+
+/**
+ * Indices into a scene's discs or lines.
+ */
+struct exportList {
+    uint32_t * items;
+    uint32_t   len;
+    uint32_t   cap;
+};
+
+/**
+ * Discs or lines grouped by the first band they reach into, as CSR: band
+ * b's start at order[start[b]], in index order.
+ */
+struct exportBuckets {
+    uint32_t * start;
+    uint32_t * order;
+};
+
+/**
+ * Everything inside the rectangle, projected to the image once up front.
+ */
+struct exportScene {
+    uint32_t            width;
+    uint32_t            height;
+
+    struct exportDisc * discs;
+    uint32_t            discsLen;
+    uint32_t            discsCap;
+    struct exportLine * lines;
+    uint32_t            linesLen;
+    uint32_t            linesCap;
+
+    // World to image, set while projecting
+    const struct exportRect * rect;
+    float                     scale;
+
+    // Set up for drawing in bands
+    uint32_t                  bands;
+    struct exportBuckets      discBuckets;
+    struct exportBuckets      lineBuckets;
+};
+
+/**
+ * Where an SVG is being written, and what went into it.
+ */
+struct exportSvgFile {
+    FILE *                    file;
+    const struct exportRect * rect;
+    float                     scale;
+    struct exportStats *      stats;
+};
+
+/**
+ * A band of rows drawn by the workers, and the primitives that reach
+ * into it.
+ */
+struct exportBand {
+    struct exportScene * scene;
+    uint32_t             top;
+    uint32_t             rows;
+    uint8_t *            pixels;
+    struct exportList    discs;
+    struct exportList    lines;
+
+    // Tiles handed out to workers so far, out of tiles
+    uint32_t             nextTile;
+    uint32_t             tiles;
+
+    int                  workers;
+    #ifdef EXPORT_THREADS
+        // Threads drawing the band, of the workers wanted
+        pthread_t        threads[EXPORT_MAX_WORKERS];
+        int              started;
+        pthread_mutex_t  lock;
+    #endif
+};
+
+/*****************************************************************************
+* Projection
+*****************************************************************************/
+
+/**
+ * Sets height to keep rect's aspect at width pixels wide. Where that would
+ * be more than EXPORT_MAX_SIDE rows, width shrinks instead, so the whole
+ * rect still fits at the scale width / rect->w.
+ */
+static void imageSize(const struct exportRect * rect, uint32_t * width,
+  uint32_t * height) {
+    float h = roundf(rect->h * *width / rect->w);
+
+    if (h > EXPORT_MAX_SIDE) {
+        float w = floorf(EXPORT_MAX_SIDE * rect->w / rect->h);
+        *width = w < 1 ? 1 : w;
+        h      = fminf(roundf(rect->h * *width / rect->w), EXPORT_MAX_SIDE);
+    }
+    *height = h < 1 ? 1 : h;
+}
+
+static float objectRadius(enum objectType type, int r) {
+    if (type == SPRITE && r < EXPORT_SPRITE_RADIUS)
+        r = EXPORT_SPRITE_RADIUS;
+    return r;
+}
+
+static void pushIndex(struct exportList * list, uint32_t i) {
+    if (list->len == list->cap) {
+        list->cap   = list->cap ? list->cap * 2 : 1024;
+        list->items = realloc(list->items, list->cap * sizeof(uint32_t));
+    }
+    list->items[list->len++] = i;
+}
+
+/**
+ * Adds an object to the scene if it shows in the image.
+ */
+static void projectObject(struct exportScene * scene, struct object obj) {
+    const struct exportRect * rect = scene->rect;
+    struct exportDisc         d    = {
+        .x     = (obj.x - rect->x) * scene->scale,
+        .y     = (obj.y - rect->y) * scene->scale,
+        .r     = fmaxf(objectRadius(obj.type, obj.radius) * scene->scale,
+          0.5f),
+        .color = obj.color
+    };
+
+    if (d.x + d.r < 0 || d.x - d.r > scene->width || d.y + d.r < 0
+      || d.y - d.r > scene->height)
+        return;
+    if (scene->discsLen == scene->discsCap) {
+        scene->discsCap = scene->discsCap ? scene->discsCap * 2 : 1024;
+        scene->discs    = realloc(scene->discs,
+          scene->discsCap * sizeof(struct exportDisc));
+    }
+    scene->discs[scene->discsLen++] = d;
+}
+
+/**
+ * Adds a connection between two world positions to the scene if it shows
+ * in the image.
+ */
+static void projectConnection(struct exportScene * scene, int width,
+  Color color, float y0, float x0, float y1, float x1) {
+    const struct exportRect * rect = scene->rect;
+
+    // Widths are in pixels, like on screen, whatever the scale
+    struct exportLine l = {
+        .x0        = (x0 - rect->x) * scene->scale,
+        .y0        = (y0 - rect->y) * scene->scale,
+        .x1        = (x1 - rect->x) * scene->scale,
+        .y1        = (y1 - rect->y) * scene->scale,
+        .halfWidth = (width > 1 ? width : 1) / 2.0f,
+        .color     = color
+    };
+    float reach = l.halfWidth + 1;
+
+    if (fmaxf(l.x0, l.x1) + reach < 0
+      || fminf(l.x0, l.x1) - reach > scene->width
+      || fmaxf(l.y0, l.y1) + reach < 0
+      || fminf(l.y0, l.y1) - reach > scene->height)
+        return;
+    if (scene->linesLen == scene->linesCap) {
+        scene->linesCap = scene->linesCap ? scene->linesCap * 2 : 1024;
+        scene->lines    = realloc(scene->lines,
+          scene->linesCap * sizeof(struct exportLine));
+    }
+    scene->lines[scene->linesLen++] = l;
+}
+
+static void projectPagedObject(struct handle h, struct object obj,
+  void * ctx) {
+    projectObject(ctx, obj);
+}
+
+static void projectPagedConnection(struct connection con, int srcY,
+  int srcX, int destY, int destX, void * ctx) {
+    projectConnection(ctx, con.width, con.color, srcY, srcX, destY, destX);
+}
+
+/**
+ * Projects the objects and connections that show inside rect into pixels
+ * of a width x height image, paged out ones included.
+ */
+static void projectScene(struct exportScene * scene, struct objectStore * objs,
+  struct connectionStore * cons, struct pager * pager,
+  const struct exportRect * rect) {
+    static const struct pagerVisitor visitor = {
+        .object     = projectPagedObject,
+        .connection = projectPagedConnection
+    };
+
+    scene->discs    = NULL;
+    scene->discsLen = scene->discsCap = 0;
+    scene->lines    = NULL;
+    scene->linesLen = scene->linesCap = 0;
+    scene->rect     = rect;
+    scene->scale    = scene->width / rect->w;
+
+    for (uint32_t i = 0; i < objs->len; i++)
+        projectObject(scene, (struct object) {
+            .type   = OBJECT_FIELD(objs, type, i),
+            .radius = OBJECT_FIELD(objs, radius, i),
+            .color  = OBJECT_FIELD(objs, color, i),
+            .y      = OBJECT_FIELD(objs, y, i),
+            .x      = OBJECT_FIELD(objs, x, i)
+        });
+
+    for (uint32_t i = 0; i < cons->len; i++) {
+        uint32_t src  = objectStoreDense(objs, CONNECTION_FIELD(cons, src, i));
+        uint32_t dest = objectStoreDense(objs, CONNECTION_FIELD(cons, dest, i));
+        if (src == STORE_NONE || dest == STORE_NONE)
+            continue;
+        projectConnection(scene, CONNECTION_FIELD(cons, width, i),
+          CONNECTION_FIELD(cons, color, i),
+          OBJECT_FIELD(objs, y, src), OBJECT_FIELD(objs, x, src),
+          OBJECT_FIELD(objs, y, dest), OBJECT_FIELD(objs, x, dest));
+    }
+
+    if (pager != NULL)
+        pagerWalk(pager, objs, &visitor, scene);
+} /* projectScene */
+
+/*****************************************************************************
+* Rasterizing
+*****************************************************************************/
+
+/**
+ * Blends color into the RGB pixel at p with the given coverage.
+ */
+static void blend(uint8_t * p, Color color, float coverage) {
+    float a = coverage * color.a / 255.0f;
+
+    p[0] += lroundf((color.r - p[0]) * a);
+    p[1] += lroundf((color.g - p[1]) * a);
+    p[2] += lroundf((color.b - p[2]) * a);
+}
+
+/**
+ * Draws a disc of radius r around (x, y), band coordinates, clipped to
+ * the columns [x0, x1).
+ */
+static void rasterDisc(struct exportBand * band, uint32_t x0, uint32_t x1,
+  float x, float y, float r, Color color) {
+    int left   = fmaxf(floorf(x - r - 1), x0);
+    int right  = fminf(ceilf(x + r + 1), x1);
+    int top    = fmaxf(floorf(y - r - 1), 0);
+    int bottom = fminf(ceilf(y + r + 1), band->rows);
+
+    for (int py = top; py < bottom; py++) {
+        uint8_t * row = band->pixels + (size_t) py * band->scene->width * 3;
+        for (int px = left; px < right; px++) {
+            float d        = hypotf(px + 0.5f - x, py + 0.5f - y);
+            float coverage = fminf(r + 0.5f - d, 1);
+            if (coverage > 0)
+                blend(row + px * 3, color, coverage);
+        }
+    }
+}
+
+static void linePixel(struct exportBand * band, const struct exportLine * l,
+  float y0, float y1, int px, int py) {
+    float dx = l->x1 - l->x0;
+    float dy = y1 - y0;
+    float cx = px + 0.5f;
+    float cy = py + 0.5f;
+    float t  = ((cx - l->x0) * dx + (cy - y0) * dy) / (dx * dx + dy * dy);
+
+    t = fminf(fmaxf(t, 0), 1);
+    float d        = hypotf(cx - (l->x0 + t * dx), cy - (y0 + t * dy));
+    float coverage = fminf(l->halfWidth + 0.5f - d, 1);
+    if (coverage > 0)
+        blend(band->pixels + ((size_t) py * band->scene->width + px) * 3,
+          l->color, coverage);
+}
+
+/**
+ * Draws a line with round ends, clipped to the columns [x0, x1) of the
+ * band. Walks along the line's major axis and only visits the pixels
+ * within reach of it across, so long lines cost their length, not their
+ * bounding box.
+ */
+static void rasterLine(struct exportBand * band, uint32_t x0, uint32_t x1,
+  const struct exportLine * l) {
+    // In band coordinates
+    float ly0   = l->y0 - band->top;
+    float ly1   = l->y1 - band->top;
+    float dx    = l->x1 - l->x0;
+    float dy    = ly1 - ly0;
+    float len   = hypotf(dx, dy);
+    float reach = l->halfWidth + 1;
+
+    if (len < 0.01f) {
+        rasterDisc(band, x0, x1, l->x0, ly0, l->halfWidth, l->color);
+        return;
+    }
+
+    if (fabsf(dx) >= fabsf(dy)) {
+        int   left   = fmaxf(floorf(fminf(l->x0, l->x1) - reach), x0);
+        int   right  = fminf(ceilf(fmaxf(l->x0, l->x1) + reach), x1);
+        float across = reach * len / fabsf(dx) + l->halfWidth;
+        for (int px = left; px < right; px++) {
+            float yc     = ly0 + (px + 0.5f - l->x0) * dy / dx;
+            int   top    = fmaxf(floorf(yc - across), 0);
+            int   bottom = fminf(ceilf(yc + across), band->rows);
+            for (int py = top; py < bottom; py++)
+                linePixel(band, l, ly0, ly1, px, py);
+        }
+    } else {
+        int   top    = fmaxf(floorf(fminf(ly0, ly1) - reach), 0);
+        int   bottom = fminf(ceilf(fmaxf(ly0, ly1) + reach), band->rows);
+        float across = reach * len / fabsf(dy) + l->halfWidth;
+        for (int py = top; py < bottom; py++) {
+            float xc    = l->x0 + (py + 0.5f - ly0) * dx / dy;
+            int   left  = fmaxf(floorf(xc - across), x0);
+            int   right = fminf(ceilf(xc + across), x1);
+            for (int px = left; px < right; px++)
+                linePixel(band, l, ly0, ly1, px, py);
+        }
+    }
+} /* rasterLine */
+
+/**
+ * Draws one tile of the band: connections first, then the objects over
+ * them, like the window does.
+ */
+static void renderTile(struct exportBand * band, uint32_t tile) {
+    struct exportScene * scene = band->scene;
+    uint32_t             x0    = tile * EXPORT_TILE_SIZE;
+    uint32_t             x1    = x0 + EXPORT_TILE_SIZE;
+
+    if (x1 > scene->width)
+        x1 = scene->width;
+
+    for (uint32_t y = 0; y < band->rows; y++)
+        memset(band->pixels + ((size_t) y * scene->width + x0) * 3, 255,
+          (x1 - x0) * 3);
+
+    for (uint32_t i = 0; i < band->lines.len; i++) {
+        const struct exportLine * l = &scene->lines[band->lines.items[i]];
+        float reach = l->halfWidth + 1;
+        if (fmaxf(l->x0, l->x1) + reach < x0
+          || fminf(l->x0, l->x1) - reach > x1)
+            continue;
+        rasterLine(band, x0, x1, l);
+    }
+
+    for (uint32_t i = 0; i < band->discs.len; i++) {
+        const struct exportDisc * d = &scene->discs[band->discs.items[i]];
+        if (d->x + d->r + 1 < x0 || d->x - d->r - 1 > x1)
+            continue;
+        rasterDisc(band, x0, x1, d->x, d->y - band->top, d->r, d->color);
+    }
+}
+
+/*****************************************************************************
+* Bands
+*****************************************************************************/
+
+static void * bandWorker(void * arg) {
+    struct exportBand * band = arg;
+
+    for (;;) {
+        LOCK(band);
+        uint32_t tile = band->nextTile++;
+        UNLOCK(band);
+        if (tile >= band->tiles)
+            return NULL;
+        renderTile(band, tile);
+    }
+}
+
+/**
+ * Rows a disc or line reaches, top inclusive and bottom exclusive, which
+ * may lie outside the image.
+ */
+typedef void (*exportExtent)(const struct exportScene * scene, uint32_t i,
+  float * top, float * bottom);
+
+static void discExtent(const struct exportScene * scene, uint32_t i,
+  float * top, float * bottom) {
+    const struct exportDisc * d = &scene->discs[i];
+
+    *top    = d->y - d->r - 1;
+    *bottom = d->y + d->r + 1;
+}
+
+static void lineExtent(const struct exportScene * scene, uint32_t i,
+  float * top, float * bottom) {
+    const struct exportLine * l     = &scene->lines[i];
+    float                     reach = l->halfWidth + 1;
+
+    *top    = fminf(l->y0, l->y1) - reach;
+    *bottom = fmaxf(l->y0, l->y1) + reach;
+}
+
+static uint32_t firstBand(const struct exportScene * scene, float top) {
+    return top <= 0 ? 0 : fminf(floorf(top / EXPORT_TILE_SIZE),
+             scene->bands - 1);
+}
+
+/**
+ * Groups count discs or lines by the first band they reach into.
+ */
+static void bucketByBand(const struct exportScene * scene, uint32_t count,
+  exportExtent extent, struct exportBuckets * buckets) {
+    uint32_t   bands  = scene->bands;
+    uint32_t * cursor = malloc((bands + 1) * sizeof(uint32_t));
+    float      top, bottom;
+
+    buckets->start = calloc(bands + 2, sizeof(uint32_t));
+    buckets->order = malloc((count + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        extent(scene, i, &top, &bottom);
+        buckets->start[firstBand(scene, top) + 1]++;
+    }
+    for (uint32_t b = 0; b < bands; b++)
+        buckets->start[b + 1] += buckets->start[b];
+
+    memcpy(cursor, buckets->start, (bands + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        extent(scene, i, &top, &bottom);
+        buckets->order[cursor[firstBand(scene, top)]++] = i;
+    }
+    free(cursor);
+}
+
+/**
+ * Fills list with the discs or lines that reach into rows [top, bottom) of
+ * band b, in index order so they are drawn in the same order as ever. They
+ * are those in the band above that reach down this far, and those that
+ * start in this band, so every disc and line is only looked at in the
+ * bands it reaches into.
+ */
+static void gatherBand(const struct exportScene * scene,
+  const struct exportBuckets * buckets, exportExtent extent, uint32_t b,
+  float top, float bottom, const struct exportList * above,
+  struct exportList * list) {
+    uint32_t a   = 0;
+    uint32_t n   = buckets->start[b];
+    uint32_t end = buckets->start[b + 1];
+
+    list->len = 0;
+    while (a < above->len || n < end) {
+        uint32_t i;
+        if (n == end || (a < above->len && above->items[a] < buckets->order[n]))
+            i = above->items[a++];
+        else
+            i = buckets->order[n++];
+
+        float from, to;
+        extent(scene, i, &from, &to);
+        if (to >= top && from < bottom)
+            pushIndex(list, i);
+    }
+}
+
+/**
+ * Collects what reaches into band b from the band above, then starts the
+ * workers drawing it.
+ */
+static void startBand(struct exportBand * band,
+  const struct exportBand * above, uint32_t b) {
+    struct exportScene * scene  = band->scene;
+    uint32_t             top    = b * EXPORT_TILE_SIZE;
+    float                bottom = top + EXPORT_TILE_SIZE;
+
+    band->top      = top;
+    band->rows     = scene->height - top < EXPORT_TILE_SIZE ?
+      scene->height - top : EXPORT_TILE_SIZE;
+    band->nextTile = 0;
+
+    gatherBand(scene, &scene->discBuckets, discExtent, b, top, bottom,
+      &above->discs, &band->discs);
+    gatherBand(scene, &scene->lineBuckets, lineExtent, b, top, bottom,
+      &above->lines, &band->lines);
+
+    #ifdef EXPORT_THREADS
+        band->started = 0;
+        while (band->started < band->workers
+          && pthread_create(&band->threads[band->started], NULL, bandWorker,
+          band) == 0)
+            band->started++;
+
+        // Without a thread to draw it, draw the band right here
+        if (band->started == 0)
+            bandWorker(band);
+    #else
+        bandWorker(band);
+    #endif
+} /* startBand */
+
+static void finishBand(struct exportBand * band) {
+    #ifdef EXPORT_THREADS
+        for (int w = 0; w < band->started; w++)
+            pthread_join(band->threads[w], NULL);
+    #endif
+}
+
+static void initBand(struct exportBand * band, struct exportScene * scene) {
+    memset(band, 0, sizeof(*band));
+    band->scene   = scene;
+    band->pixels  = malloc((size_t) scene->width * EXPORT_TILE_SIZE * 3);
+    band->tiles   = (scene->width + EXPORT_TILE_SIZE - 1) / EXPORT_TILE_SIZE;
+    band->workers = 1;
+    #ifdef EXPORT_THREADS
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        band->workers = cores > 1 ? cores : 1;
+        if (band->workers > EXPORT_MAX_WORKERS)
+            band->workers = EXPORT_MAX_WORKERS;
+        if ((uint32_t) band->workers > band->tiles)
+            band->workers = band->tiles;
+        pthread_mutex_init(&band->lock, NULL);
+    #endif
+}
+
+static void freeBand(struct exportBand * band) {
+    free(band->pixels);
+    free(band->discs.items);
+    free(band->lines.items);
+    #ifdef EXPORT_THREADS
+        pthread_mutex_destroy(&band->lock);
+    #endif
+}
+
+/*****************************************************************************
+* SVG
+*****************************************************************************/
+
+static void writeColor(FILE * f, const char * attribute, Color color) {
+    fprintf(f, " %s=\"#%02x%02x%02x\"", attribute, color.r, color.g,
+      color.b);
+    if (color.a < 255)
+        fprintf(f, " %s-opacity=\"%.3f\"", attribute, color.a / 255.0f);
+}
+
+static void writeEscaped(FILE * f, const char * text) {
+    for (const char * c = text; *c != '\0'; c++) {
+        switch (*c) {
+            case '&':
+                fputs("&amp;", f);
+                break;
+            case '<':
+                fputs("&lt;", f);
+                break;
+            case '>':
+                fputs("&gt;", f);
+                break;
+            case '"':
+                fputs("&quot;", f);
+                break;
+            default:
+                fputc(*c, f);
+        }
+    }
+}
+
+/*****************************************************************************
+* Bounds and SVG
+*****************************************************************************/
+
+/**
+ * Bounds of the objects seen so far, world units.
+ */
+struct exportBounds {
+    float minY, minX;
+    float maxY, maxX;
+    int   any;
+};
+
+static void growBounds(struct exportBounds * b, float y, float x, float r) {
+    if (!b->any || y - r < b->minY)
+        b->minY = y - r;
+    if (!b->any || x - r < b->minX)
+        b->minX = x - r;
+    if (!b->any || y + r > b->maxY)
+        b->maxY = y + r;
+    if (!b->any || x + r > b->maxX)
+        b->maxX = x + r;
+    b->any = 1;
+}
+
+static void boundPagedObject(struct handle h, struct object obj, void * ctx) {
+    growBounds(ctx, obj.y, obj.x, objectRadius(obj.type, obj.radius));
+}
+
+static void svgLine(struct exportSvgFile * svg, int lineWidth, Color color,
+  float y0, float x0, float y1, float x1) {
+    const struct exportRect * rect = svg->rect;
+
+    if (fmaxf(x0, x1) < rect->x || fminf(x0, x1) > rect->x + rect->w
+      || fmaxf(y0, y1) < rect->y || fminf(y0, y1) > rect->y + rect->h)
+        return;
+    fprintf(svg->file, "<line x1=\"%g\" y1=\"%g\" x2=\"%g\" y2=\"%g\""
+      " stroke-width=\"%g\"", x0, y0, x1, y1,
+      (lineWidth > 1 ? lineWidth : 1) / svg->scale);
+    writeColor(svg->file, "stroke", color);
+    fputs("/>\n", svg->file);
+    svg->stats->connections++;
+}
+
+static int svgShows(struct exportSvgFile * svg, struct object obj) {
+    const struct exportRect * rect = svg->rect;
+    float                     r    = objectRadius(obj.type, obj.radius);
+
+    return !(obj.x + r < rect->x || obj.x - r > rect->x + rect->w
+           || obj.y + r < rect->y || obj.y - r > rect->y + rect->h);
+}
+
+static void svgCircle(struct exportSvgFile * svg, struct object obj) {
+    if (!svgShows(svg, obj))
+        return;
+    fprintf(svg->file, "<circle cx=\"%g\" cy=\"%g\" r=\"%g\"", (float) obj.x,
+      (float) obj.y, objectRadius(obj.type, obj.radius));
+    writeColor(svg->file, "fill", obj.color);
+    fputs("/>\n", svg->file);
+    svg->stats->objects++;
+}
+
+static void svgLabel(struct exportSvgFile * svg, struct object obj) {
+    float r = objectRadius(obj.type, obj.radius);
+
+    if (obj.label == NULL || obj.label[0] == '\0' || !svgShows(svg, obj))
+        return;
+    fprintf(svg->file, "<text x=\"%g\" y=\"%g\">", obj.x + r + 2 / svg->scale,
+      obj.y + EXPORT_LABEL_SIZE / (2 * svg->scale));
+    writeEscaped(svg->file, obj.label);
+    fputs("</text>\n", svg->file);
+}
+
+static void svgPagedLine(struct connection con, int srcY, int srcX,
+  int destY, int destX, void * ctx) {
+    svgLine(ctx, con.width, con.color, srcY, srcX, destY, destX);
+}
+
+static void svgPagedCircle(struct handle h, struct object obj, void * ctx) {
+    svgCircle(ctx, obj);
+}
+
+static void svgPagedLabel(struct handle h, struct object obj, void * ctx) {
+    svgLabel(ctx, obj);
+}
+
+static struct object storedObject(struct objectStore * objs, uint32_t i) {
+    return (struct object) {
+        .type   = OBJECT_FIELD(objs, type, i),
+        .label  = OBJECT_FIELD(objs, label, i),
+        .radius = OBJECT_FIELD(objs, radius, i),
+        .color  = OBJECT_FIELD(objs, color, i),
+        .y      = OBJECT_FIELD(objs, y, i),
+        .x      = OBJECT_FIELD(objs, x, i)
+    };
+}
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void exportSceneBounds(struct objectStore * objs, struct pager * pager,
+  struct exportRect * rect) {
+    static const struct pagerVisitor visitor = { .object = boundPagedObject };
+    struct exportBounds              b       = { 0, 0, 0, 0, 0 };
+
+    for (uint32_t i = 0; i < objs->len; i++)
+        growBounds(&b, OBJECT_FIELD(objs, y, i), OBJECT_FIELD(objs, x, i),
+          objectRadius(OBJECT_FIELD(objs, type, i),
+          OBJECT_FIELD(objs, radius, i)));
+    if (pager != NULL)
+        pagerWalk(pager, objs, &visitor, &b);
+
+    rect->y = b.minY - EXPORT_MARGIN;
+    rect->x = b.minX - EXPORT_MARGIN;
+    rect->h = b.maxY - b.minY + 2 * EXPORT_MARGIN;
+    rect->w = b.maxX - b.minX + 2 * EXPORT_MARGIN;
+}
+
+int exportPng(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, struct pager * pager,
+  const struct exportRect * rect, uint32_t width, struct exportStats * stats) {
+    struct exportScene scene;
+    struct pngWriter   png;
+
+    memset(stats, 0, sizeof(*stats));
+    if (width == 0 || width > EXPORT_MAX_SIDE || rect->w <= 0 || rect->h <= 0)
+        return -1;
+    imageSize(rect, &width, &scene.height);
+    scene.width = width;
+    if (pngWriterOpen(&png, path, scene.width, scene.height) != 0)
+        return -1;
+    projectScene(&scene, objs, cons, pager, rect);
+    scene.bands = (scene.height + EXPORT_TILE_SIZE - 1) / EXPORT_TILE_SIZE;
+    bucketByBand(&scene, scene.discsLen, discExtent, &scene.discBuckets);
+    bucketByBand(&scene, scene.linesLen, lineExtent, &scene.lineBuckets);
+
+    // Two bands, one being drawn while the other is encoded, and each
+    // collected from the one above
+    struct exportBand bands[2];
+    initBand(&bands[0], &scene);
+    initBand(&bands[1], &scene);
+
+    startBand(&bands[0], &bands[1], 0);
+    for (uint32_t b = 0; b < scene.bands; b++) {
+        struct exportBand * band = &bands[b % 2];
+        finishBand(band);
+        if (b + 1 < scene.bands)
+            startBand(&bands[(b + 1) % 2], band, b + 1);
+        for (uint32_t y = 0; y < band->rows; y++)
+            pngWriterRow(&png, band->pixels + (size_t) y * scene.width * 3);
+    }
+
+    stats->width       = scene.width;
+    stats->height      = scene.height;
+    stats->tiles       = bands[0].tiles * scene.bands;
+    stats->workers     = bands[0].workers;
+    stats->objects     = scene.discsLen;
+    stats->connections = scene.linesLen;
+
+    freeBand(&bands[0]);
+    freeBand(&bands[1]);
+    free(scene.discBuckets.start);
+    free(scene.discBuckets.order);
+    free(scene.lineBuckets.start);
+    free(scene.lineBuckets.order);
+    free(scene.discs);
+    free(scene.lines);
+    return pngWriterClose(&png);
+} /* exportPng */
+
+int exportSvg(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, struct pager * pager,
+  const struct exportRect * rect, uint32_t width, struct exportStats * stats) {
+    static const struct pagerVisitor lines   = { .connection = svgPagedLine };
+    static const struct pagerVisitor circles = { .object = svgPagedCircle };
+    static const struct pagerVisitor labels  = { .object = svgPagedLabel };
+
+    memset(stats, 0, sizeof(*stats));
+    if (width == 0 || width > EXPORT_MAX_SIDE || rect->w <= 0 || rect->h <= 0)
+        return -1;
+
+    FILE * f = fopen(path, "w");
+    if (f == NULL)
+        return -1;
+
+    // Everything is in world units, scaled to the image by the viewBox
+    imageSize(rect, &width, &stats->height);
+    struct exportSvgFile svg = { f, rect, width / rect->w, stats };
+    stats->width   = width;
+    stats->workers = 1;
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%u\" height=\"%u\""
+      " viewBox=\"%g %g %g %g\">\n"
+      "<rect x=\"%g\" y=\"%g\" width=\"%g\" height=\"%g\" fill=\"white\"/>\n",
+      stats->width, stats->height, rect->x, rect->y, rect->w, rect->h,
+      rect->x, rect->y, rect->w, rect->h);
+
+    // Lines under circles under labels, each layer one pass over the pages
+    fputs("<g stroke-linecap=\"round\">\n", f);
+    for (uint32_t i = 0; i < cons->len; i++) {
+        uint32_t src  = objectStoreDense(objs, CONNECTION_FIELD(cons, src, i));
+        uint32_t dest = objectStoreDense(objs, CONNECTION_FIELD(cons, dest, i));
+        if (src == STORE_NONE || dest == STORE_NONE)
+            continue;
+        svgLine(&svg, CONNECTION_FIELD(cons, width, i),
+          CONNECTION_FIELD(cons, color, i),
+          OBJECT_FIELD(objs, y, src), OBJECT_FIELD(objs, x, src),
+          OBJECT_FIELD(objs, y, dest), OBJECT_FIELD(objs, x, dest));
+    }
+    if (pager != NULL)
+        pagerWalk(pager, objs, &lines, &svg);
+    fputs("</g>\n<g>\n", f);
+
+    for (uint32_t i = 0; i < objs->len; i++)
+        svgCircle(&svg, storedObject(objs, i));
+    if (pager != NULL)
+        pagerWalk(pager, objs, &circles, &svg);
+    fprintf(f, "</g>\n<g font-family=\"sans-serif\" font-size=\"%g\">\n",
+      EXPORT_LABEL_SIZE / svg.scale);
+
+    for (uint32_t i = 0; i < objs->len; i++)
+        svgLabel(&svg, storedObject(objs, i));
+    if (pager != NULL)
+        pagerWalk(pager, objs, &labels, &svg);
+    fputs("</g>\n</svg>\n", f);
+
+    int err = ferror(f);
+    if (fclose(f) != 0)
+        err = 1;
+    return err ? -1 : 0;
+} /* exportSvg */
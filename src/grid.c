@@ -0,0 +1,93 @@
+#include <math.h>
+
+#include "grid.h"
+
+// Closest that gridlines are allowed to get on screen, in pixels
+#define GRID_MIN_STEP 16
+
+/**
+ * Remainder which is never negative, for positions left of or above the
+ * origin.
+ */
+static int positiveMod(int a, int b) {
+    int m = a % b;
+
+    return m < 0 ? m + b : m;
+}
+
+/**
+ * Rasterizes dotted lines every `step` pixels along both axes into a sheet
+ * one step bigger than the viewport, so any pan offset can be cut out of it.
+ */
+static void buildSheet(struct gridRenderer * grid, struct viewport * vp,
+  int step) {
+    int w = vp->w + step;
+    int h = vp->h + step;
+    Image img = GenImageColor(w, h, BLANK);
+    Color * px = img.data;
+    int seg = grid->segLength > 0 ? grid->segLength : 1;
+
+    // Vertical lines, dashed along y
+    for (int x = 0; x < w; x += step)
+        for (int y = 0; y < h; y++)
+            if ((y / seg) % 2 == 0)
+                px[y * w + x] = grid->color;
+
+    // Horizontal lines, dashed along x
+    for (int y = 0; y < h; y += step)
+        for (int x = 0; x < w; x++)
+            if ((x / seg) % 2 == 0)
+                px[y * w + x] = grid->color;
+
+    if (grid->sheet.id != 0)
+        UnloadTexture(grid->sheet);
+    grid->sheet  = LoadTextureFromImage(img);
+    grid->sheetW = vp->w;
+    grid->sheetH = vp->h;
+    grid->step   = step;
+    UnloadImage(img);
+}
+
+void gridRendererInit(struct gridRenderer * grid, int spacing, int segLength,
+  Color color) {
+    grid->spacing   = spacing;
+    grid->segLength = segLength;
+    grid->color     = color;
+    grid->sheet     = (Texture2D) { 0 };
+    grid->sheetW    = 0;
+    grid->sheetH    = 0;
+    grid->step      = 0;
+}
+
+void gridRendererDraw(struct gridRenderer * grid, struct viewport * vp) {
+    int spacing = grid->spacing;
+
+    // When zoomed out, skip to every fifth line until they're spread out
+    // enough to not turn into a grey wash
+    while (spacing * vp->scale < GRID_MIN_STEP)
+        spacing *= 5;
+
+    int step = roundf(spacing * vp->scale);
+    if (grid->sheet.id == 0 || step != grid->step || vp->w != grid->sheetW
+      || vp->h != grid->sheetH)
+        buildSheet(grid, vp, step);
+
+    // A gridline sits wherever a multiple of the spacing projects to, and
+    // the sheet has one on every multiple of step, so shifting the source
+    // by minus the projected origin lines the two up on both axes. Going
+    // through the projection keeps the flipped y axis consistent with
+    // everything else drawn into the render texture.
+    Rectangle src = {
+        positiveMod(-projectX(vp, 0), step),
+        positiveMod(-projectY(vp, 0), step),
+        vp->w,
+        vp->h
+    };
+    DrawTextureRec(grid->sheet, src, CLITERAL(Vector2) { 0, 0 }, WHITE);
+}
+
+void gridRendererUnload(struct gridRenderer * grid) {
+    if (grid->sheet.id != 0)
+        UnloadTexture(grid->sheet);
+    grid->sheet = (Texture2D) { 0 };
+}
@@ -0,0 +1,929 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#ifndef __EMSCRIPTEN__
+# define IMPORT_THREADS
+# include <pthread.h>
+# include <unistd.h>
+#endif
+
+#include "importer.h"
+
+#ifdef IMPORT_THREADS
+# define LOCK(mutex)   pthread_mutex_lock(mutex)
+# define UNLOCK(mutex) pthread_mutex_unlock(mutex)
+#else
+# define LOCK(mutex)
+# define UNLOCK(mutex)
+#endif
+
+// Node names are copied into blocks of this size, owned by the worker that
+// first saw them
+#define NAME_BLOCK_SIZE (1024 * 1024)
+
+/*****************************************************************************
+* Structs and Typedefs
+*****************************************************************************/
+
+struct nameBlock {
+    struct nameBlock * next;
+    size_t             used;
+    size_t             size;
+    char               data[];
+};
+
+struct importEntry {
+    // NULL for an empty slot
+    const char * name;
+    uint32_t     len;
+    uint32_t     hash;
+    uint32_t     local;
+};
+
+/**
+ * One shard of the name map: an open addressing table of the names whose
+ * hash falls in it, and the names in the order they were added, which is
+ * their number within the shard, with where each was first seen in the
+ * file: the chunk's number in the high half and the name's place in the
+ * chunk in the low half.
+ */
+struct importShard {
+    struct importEntry * entries;
+    uint32_t             cap;
+    uint32_t             len;
+    const char **        names;
+    uint64_t *           firstSeen;
+    uint32_t             namesCap;
+    #ifdef IMPORT_THREADS
+        pthread_mutex_t  lock;
+    #endif
+};
+
+/**
+ * A run of whole lines, and the edges found in them as pairs of node
+ * references: a node's number within its shard times IMPORT_SHARDS plus
+ * the shard. Chunks are numbered in file order, and count the names
+ * resolved in them so far.
+ */
+struct importChunk {
+    char *               data;
+    size_t               len;
+    int                  first;
+    uint32_t             seq;
+    uint32_t             names;
+    uint32_t *           edges;
+    uint32_t             edgesLen;
+    uint32_t             edgesCap;
+    uint32_t             skipped;
+    struct importChunk * next;
+};
+
+struct importer;
+
+struct importWorker {
+    struct importer *  importer;
+    struct nameBlock * names;
+
+    // Unescaped quoted names
+    char *             scratch;
+    size_t             scratchCap;
+    #ifdef IMPORT_THREADS
+        pthread_t      thread;
+    #endif
+};
+
+struct importer {
+    enum importFormat    format;
+    struct importShard   shards[IMPORT_SHARDS];
+
+    // Chunks waiting for a worker, oldest first, and chunks parsed
+    struct importChunk * queueHead;
+    struct importChunk * queueTail;
+    int                  queued;
+    int                  queueMax;
+    struct importChunk * done;
+    uint32_t             chunks;
+    int                  eof;
+
+    struct importWorker  workers[IMPORT_MAX_WORKERS];
+    int                  workerCount;
+
+    #ifdef IMPORT_THREADS
+        // Whether the workers run on threads of their own, or the first
+        // one parses each chunk as it is submitted
+        int              threaded;
+        pthread_mutex_t  lock;
+
+        // Signalled when a chunk is queued or the file is done, and when
+        // a worker takes a chunk off the queue
+        pthread_cond_t   ready;
+        pthread_cond_t   space;
+    #endif
+};
+
+/*****************************************************************************
+* Name map
+*****************************************************************************/
+
+static uint32_t hashName(const char * name, uint32_t len) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+
+    for (uint32_t i = 0; i < len; i++)
+        h = (h ^ (uint8_t) name[i]) * 16777619u;
+    return h;
+}
+
+/**
+ * Copies a name into the worker's blocks, NUL terminated.
+ */
+static const char * storeName(struct importWorker * w, const char * name,
+  uint32_t len) {
+    struct nameBlock * b = w->names;
+
+    if (b == NULL || b->used + len + 1 > b->size) {
+        size_t size = len + 1 > NAME_BLOCK_SIZE ? len + 1 : NAME_BLOCK_SIZE;
+        b        = malloc(sizeof(struct nameBlock) + size);
+        b->next  = w->names;
+        b->used  = 0;
+        b->size  = size;
+        w->names = b;
+    }
+
+    char * copy = b->data + b->used;
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    b->used  += len + 1;
+    return copy;
+}
+
+/**
+ * Doubles a shard's table. Slots are picked by the hash bits above the
+ * ones that chose the shard.
+ */
+static void growShard(struct importShard * s) {
+    uint32_t             cap     = s->cap ? s->cap * 2 : 1024;
+    struct importEntry * entries = calloc(cap, sizeof(struct importEntry));
+
+    for (uint32_t i = 0; i < s->cap; i++) {
+        if (s->entries[i].name == NULL)
+            continue;
+        uint32_t j = (s->entries[i].hash / IMPORT_SHARDS) & (cap - 1);
+        while (entries[j].name != NULL)
+            j = (j + 1) & (cap - 1);
+        entries[j] = s->entries[i];
+    }
+    free(s->entries);
+    s->entries = entries;
+    s->cap     = cap;
+}
+
+/**
+ * Returns the reference of the node with the given name, adding it if it
+ * hasn't been seen yet. Which worker adds a name first is down to timing,
+ * so where in the file it was first seen is kept as well.
+ */
+static uint32_t resolveName(struct importWorker * w,
+  struct importChunk * chunk, const char * name, uint32_t len) {
+    uint32_t             h     = hashName(name, len);
+    uint32_t             shard = h % IMPORT_SHARDS;
+    struct importShard * s     = &w->importer->shards[shard];
+    uint64_t             seen  = (uint64_t) chunk->seq << 32 | chunk->names++;
+    uint32_t             local;
+
+    LOCK(&s->lock);
+    if ((s->len + 1) * 2 > s->cap)
+        growShard(s);
+
+    uint32_t mask = s->cap - 1;
+    for (uint32_t i = (h / IMPORT_SHARDS) & mask;; i = (i + 1) & mask) {
+        struct importEntry * e = &s->entries[i];
+        if (e->name == NULL) {
+            if (s->len == s->namesCap) {
+                s->namesCap = s->namesCap ? s->namesCap * 2 : 1024;
+                s->names    = realloc(s->names,
+                  s->namesCap * sizeof(const char *));
+                s->firstSeen = realloc(s->firstSeen,
+                  s->namesCap * sizeof(uint64_t));
+            }
+            local               = s->len++;
+            e->name             = storeName(w, name, len);
+            e->len              = len;
+            e->hash             = h;
+            e->local            = local;
+            s->names[local]     = e->name;
+            s->firstSeen[local] = seen;
+            break;
+        }
+        if (e->hash == h && e->len == len && memcmp(e->name, name, len) == 0) {
+            local = e->local;
+            if (seen < s->firstSeen[local])
+                s->firstSeen[local] = seen;
+            break;
+        }
+    }
+    UNLOCK(&s->lock);
+    return local * IMPORT_SHARDS + shard;
+} /* resolveName */
+
+static void addEdge(struct importChunk * chunk, uint32_t a, uint32_t b) {
+    // Self loops would only draw as a dot under the object
+    if (a == b)
+        return;
+    if (chunk->edgesLen + 2 > chunk->edgesCap) {
+        chunk->edgesCap = chunk->edgesCap ? chunk->edgesCap * 2 : 4096;
+        chunk->edges    = realloc(chunk->edges,
+          chunk->edgesCap * sizeof(uint32_t));
+    }
+    chunk->edges[chunk->edgesLen++] = a;
+    chunk->edges[chunk->edgesLen++] = b;
+}
+
+/*****************************************************************************
+* Parsing
+*****************************************************************************/
+
+static int isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char * skipBlanks(const char * p, const char * end) {
+    while (p < end && isBlank(*p))
+        p++;
+    return p;
+}
+
+/**
+ * Reads a double quoted string starting at p, with backslash or doubled
+ * quote escapes, into the worker's scratch buffer. Returns where it ends.
+ */
+static const char * readQuoted(struct importWorker * w, const char * p,
+  const char * end, int doubled, uint32_t * len) {
+    if (w->scratchCap < (size_t) (end - p)) {
+        w->scratchCap = end - p;
+        w->scratch    = realloc(w->scratch, w->scratchCap);
+    }
+
+    *len = 0;
+    for (p++; p < end; p++) {
+        if (*p == '"' && doubled && p + 1 < end && p[1] == '"')
+            p++;
+        else if (*p == '\\' && !doubled && p + 1 < end)
+            p++;
+        else if (*p == '"')
+            return p + 1;
+        w->scratch[(*len)++] = *p;
+    }
+    return end;
+}
+
+/**
+ * Returns the position after the double quoted string starting at p.
+ */
+static const char * skipQuoted(const char * p, const char * end) {
+    for (p++; p < end; p++) {
+        if (*p == '\\' && p + 1 < end)
+            p++;
+        else if (*p == '"')
+            return p + 1;
+    }
+    return end;
+}
+
+/**
+ * "a b [anything]": an edge, or a node if there is only one name.
+ */
+static void parseEdgeListLine(struct importWorker * w,
+  struct importChunk * chunk, const char * p, const char * end) {
+    p = skipBlanks(p, end);
+    if (p == end || *p == '#' || *p == '%')
+        return;
+
+    const char * a = p;
+    while (p < end && !isBlank(*p))
+        p++;
+    uint32_t src = resolveName(w, chunk, a, p - a);
+
+    p = skipBlanks(p, end);
+    if (p == end)
+        return;
+
+    const char * b = p;
+    while (p < end && !isBlank(*p))
+        p++;
+    addEdge(chunk, src, resolveName(w, chunk, b, p - b));
+}
+
+/**
+ * Reads one CSV field into name and len, which point into the line or the
+ * worker's scratch buffer. Returns the position after the field's comma.
+ */
+static const char * readField(struct importWorker * w, const char * p,
+  const char * end, const char ** name, uint32_t * len) {
+    p = skipBlanks(p, end);
+    if (p < end && *p == '"') {
+        p     = readQuoted(w, p, end, 1, len);
+        *name = w->scratch;
+        while (p < end && *p != ',')
+            p++;
+    } else {
+        *name = p;
+        while (p < end && *p != ',')
+            p++;
+        const char * last = p;
+        while (last > *name && isBlank(last[-1]))
+            last--;
+        *len = last - *name;
+    }
+    return p < end ? p + 1 : end;
+}
+
+static int isColumnName(const char * name, uint32_t len) {
+    static const char * columns[] = {
+        "source", "target", "src", "dst", "dest", "from", "to", "node",
+        "node1", "node2", "id", "name"
+    };
+
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++)
+        if (strlen(columns[i]) == len && strncasecmp(columns[i], name,
+          len) == 0)
+            return 1;
+    return 0;
+}
+
+/**
+ * "a,b[,anything]": an edge, or a node if the second field is empty.
+ */
+static void parseCsvLine(struct importWorker * w, struct importChunk * chunk,
+  const char * p, const char * end, int header) {
+    const char * name;
+    uint32_t     len;
+
+    p = skipBlanks(p, end);
+    if (p == end)
+        return;
+
+    p = readField(w, p, end, &name, &len);
+    if (header && isColumnName(name, len))
+        return;
+    if (len == 0) {
+        chunk->skipped++;
+        return;
+    }
+    uint32_t src = resolveName(w, chunk, name, len);
+
+    // The scratch buffer gets reused by the second field
+    readField(w, p, end, &name, &len);
+    if (len > 0)
+        addEdge(chunk, src, resolveName(w, chunk, name, len));
+}
+
+static int isDotIdChar(char c) {
+    return isalnum((unsigned char) c) || c == '_' || c == '.'
+           || (unsigned char) c >= 0x80;
+}
+
+static int isDotKeyword(const char * name, uint32_t len) {
+    static const char * keywords[] = {
+        "graph", "digraph", "subgraph", "strict", "node", "edge"
+    };
+
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+        if (strlen(keywords[i]) == len && strncasecmp(keywords[i], name,
+          len) == 0)
+            return 1;
+    return 0;
+}
+
+/**
+ * Reads a DOT ID: a name, a number or a quoted string. Returns where it
+ * ends, or p itself if there is no ID there.
+ */
+static const char * readDotId(struct importWorker * w, const char * p,
+  const char * end, const char ** name, uint32_t * len) {
+    if (*p == '"') {
+        p     = readQuoted(w, p, end, 0, len);
+        *name = w->scratch;
+        return p;
+    }
+
+    const char * start = p;
+    if (*p == '-' && p + 1 < end && (isdigit((unsigned char) p[1])
+      || p[1] == '.'))
+        p++;
+    while (p < end && isDotIdChar(*p))
+        p++;
+    *name = start;
+    *len  = p - start;
+    return p;
+}
+
+/**
+ * Node statements and edge chains, several to a line. Everything else is
+ * skipped up to the end of its statement.
+ */
+static void parseDotLine(struct importWorker * w, struct importChunk * chunk,
+  const char * p, const char * end) {
+    uint32_t prev      = STORE_NONE;
+    int      edgeOp    = 0;
+    int      skipping  = 0;
+    int      statement = 1;
+
+    p = skipBlanks(p, end);
+    if (p < end && *p == '#')
+        return;
+
+    while (p < end) {
+        char c = *p;
+        if (isBlank(c)) {
+            p++;
+        } else if (c == '/' && p + 1 < end && p[1] == '/') {
+            return;
+        } else if (c == '/' && p + 1 < end && p[1] == '*') {
+            // Comments that run on past the line are cut short
+            const char * close = NULL;
+            for (const char * q = p + 2; q + 1 < end; q++) {
+                if (q[0] == '*' && q[1] == '/') {
+                    close = q;
+                    break;
+                }
+            }
+            if (close == NULL)
+                return;
+            p = close + 2;
+        } else if (c == '-' && p + 1 < end && (p[1] == '>' || p[1] == '-')) {
+            edgeOp = 1;
+            p     += 2;
+        } else if (c == '[') {
+            // Attributes, which may have quoted ]s in them
+            for (p++; p < end && *p != ']';)
+                p = *p == '"' ? skipQuoted(p, end) : p + 1;
+            p++;
+        } else if (c == ';' || c == ',' || c == '{' || c == '}') {
+            prev      = STORE_NONE;
+            edgeOp    = 0;
+            skipping  = 0;
+            statement = 1;
+            p++;
+        } else if (c == '"' || c == '-' || isDotIdChar(c)) {
+            const char * name;
+            uint32_t     len;
+            const char * after = readDotId(w, p, end, &name, &len);
+            if (after == p) {
+                p++;
+                continue;
+            }
+            p = after;
+
+            // Ports, as in a:p:n, don't make a node of their own
+            while (p < end && *p == ':') {
+                p++;
+                if (p < end && *p == '"')
+                    p = skipQuoted(p, end);
+                while (p < end && isDotIdChar(*p))
+                    p++;
+            }
+
+            // An assignment like rankdir=LR
+            const char * q = skipBlanks(p, end);
+            if (q < end && *q == '=') {
+                skipping = 1;
+                continue;
+            }
+            if (statement && c != '"' && isDotKeyword(name, len))
+                skipping = 1;
+            statement = 0;
+            if (skipping)
+                continue;
+
+            uint32_t node = resolveName(w, chunk, name, len);
+            if (edgeOp && prev != STORE_NONE)
+                addEdge(chunk, prev, node);
+            prev   = node;
+            edgeOp = 0;
+        } else {
+            // = and anything this subset doesn't know
+            p++;
+        }
+    }
+} /* parseDotLine */
+
+static void parseChunk(struct importWorker * w, struct importChunk * chunk) {
+    const char * p      = chunk->data;
+    const char * end    = p + chunk->len;
+    int          header = chunk->first;
+
+    while (p < end) {
+        const char * nl      = memchr(p, '\n', end - p);
+        const char * lineEnd = nl ? nl : end;
+        switch (w->importer->format) {
+            case IMPORT_EDGE_LIST:
+                parseEdgeListLine(w, chunk, p, lineEnd);
+                break;
+            case IMPORT_CSV:
+                parseCsvLine(w, chunk, p, lineEnd, header);
+                break;
+            case IMPORT_DOT:
+                parseDotLine(w, chunk, p, lineEnd);
+                break;
+        }
+        header = 0;
+        p      = nl ? nl + 1 : end;
+    }
+    free(chunk->data);
+    chunk->data = NULL;
+}
+
+/*****************************************************************************
+* Workers
+*****************************************************************************/
+
+#ifdef IMPORT_THREADS
+static void * workerMain(void * arg) {
+    struct importWorker * w   = arg;
+    struct importer *     imp = w->importer;
+
+    for (;;) {
+        LOCK(&imp->lock);
+        while (imp->queueHead == NULL && !imp->eof)
+            pthread_cond_wait(&imp->ready, &imp->lock);
+
+        struct importChunk * chunk = imp->queueHead;
+        if (chunk == NULL) {
+            UNLOCK(&imp->lock);
+            return NULL;
+        }
+        imp->queueHead = chunk->next;
+        if (imp->queueHead == NULL)
+            imp->queueTail = NULL;
+        imp->queued--;
+        pthread_cond_signal(&imp->space);
+        UNLOCK(&imp->lock);
+
+        parseChunk(w, chunk);
+
+        LOCK(&imp->lock);
+        chunk->next = imp->done;
+        imp->done   = chunk;
+        UNLOCK(&imp->lock);
+    }
+}
+#endif /* ifdef IMPORT_THREADS */
+
+/**
+ * Numbers a chunk and hands it to the workers, waiting while too many are
+ * queued up. Without threads the chunk is parsed right away.
+ */
+static void submitChunk(struct importer * imp, struct importChunk * chunk) {
+    chunk->seq = imp->chunks++;
+    #ifdef IMPORT_THREADS
+        if (imp->threaded) {
+            LOCK(&imp->lock);
+            while (imp->queued >= imp->queueMax)
+                pthread_cond_wait(&imp->space, &imp->lock);
+            chunk->next = NULL;
+            if (imp->queueTail != NULL)
+                imp->queueTail->next = chunk;
+            else
+                imp->queueHead = chunk;
+            imp->queueTail = chunk;
+            imp->queued++;
+            pthread_cond_signal(&imp->ready);
+            UNLOCK(&imp->lock);
+            return;
+        }
+    #endif
+    parseChunk(&imp->workers[0], chunk);
+    chunk->next = imp->done;
+    imp->done   = chunk;
+}
+
+static void startWorkers(struct importer * imp) {
+    for (int s = 0; s < IMPORT_SHARDS; s++) {
+        #ifdef IMPORT_THREADS
+            pthread_mutex_init(&imp->shards[s].lock, NULL);
+        #endif
+    }
+
+    imp->workerCount = 1;
+    #ifdef IMPORT_THREADS
+        // The calling thread mostly waits for room in the queue, so it
+        // doesn't get a core of its own
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        imp->workerCount = cores > 1 ? cores : 1;
+        if (imp->workerCount > IMPORT_MAX_WORKERS)
+            imp->workerCount = IMPORT_MAX_WORKERS;
+
+        pthread_mutex_init(&imp->lock, NULL);
+        pthread_cond_init(&imp->ready, NULL);
+        pthread_cond_init(&imp->space, NULL);
+    #endif
+
+    for (int i = 0; i < IMPORT_MAX_WORKERS; i++)
+        imp->workers[i].importer = imp;
+
+    #ifdef IMPORT_THREADS
+        // Only the workers whose threads started count. With none, the
+        // chunks are parsed as they are read, as without threads
+        int started = 0;
+        while (started < imp->workerCount
+          && pthread_create(&imp->workers[started].thread, NULL, workerMain,
+          &imp->workers[started]) == 0)
+            started++;
+        imp->threaded    = started > 0;
+        imp->workerCount = started > 0 ? started : 1;
+        imp->queueMax    = imp->workerCount * IMPORT_QUEUE_DEPTH;
+    #endif
+}
+
+/**
+ * Tells the workers the file is done and waits for them to parse what is
+ * left.
+ */
+static void finishWorkers(struct importer * imp) {
+    #ifdef IMPORT_THREADS
+        if (!imp->threaded)
+            return;
+        LOCK(&imp->lock);
+        imp->eof = 1;
+        pthread_cond_broadcast(&imp->ready);
+        UNLOCK(&imp->lock);
+
+        for (int i = 0; i < imp->workerCount; i++)
+            pthread_join(imp->workers[i].thread, NULL);
+    #endif
+}
+
+static void freeImporter(struct importer * imp) {
+    while (imp->done != NULL) {
+        struct importChunk * next = imp->done->next;
+        free(imp->done->data);
+        free(imp->done->edges);
+        free(imp->done);
+        imp->done = next;
+    }
+
+    for (int s = 0; s < IMPORT_SHARDS; s++) {
+        free(imp->shards[s].entries);
+        free(imp->shards[s].names);
+        free(imp->shards[s].firstSeen);
+        #ifdef IMPORT_THREADS
+            pthread_mutex_destroy(&imp->shards[s].lock);
+        #endif
+    }
+
+    for (int i = 0; i < imp->workerCount; i++) {
+        struct nameBlock * b = imp->workers[i].names;
+        while (b != NULL) {
+            struct nameBlock * next = b->next;
+            free(b);
+            b = next;
+        }
+        free(imp->workers[i].scratch);
+    }
+
+    #ifdef IMPORT_THREADS
+        pthread_mutex_destroy(&imp->lock);
+        pthread_cond_destroy(&imp->ready);
+        pthread_cond_destroy(&imp->space);
+    #endif
+    free(imp);
+} /* freeImporter */
+
+/*****************************************************************************
+* Reading
+*****************************************************************************/
+
+/**
+ * Returns the last line end in buf, or NULL if there is none.
+ */
+static char * lastLineEnd(char * buf, size_t len) {
+    for (size_t i = len; i > 0; i--)
+        if (buf[i - 1] == '\n')
+            return &buf[i - 1];
+    return NULL;
+}
+
+/**
+ * Reads the file in chunks cut after the last whole line, carrying the
+ * partial line over to the next chunk. Returns 0 on success.
+ */
+static int readChunks(struct importer * imp, FILE * f,
+  struct importStats * stats) {
+    size_t cap   = IMPORT_CHUNK_SIZE;
+    size_t len   = 0;
+    char * buf   = malloc(cap);
+    int    first = 1;
+
+    for (;;) {
+        size_t n = fread(buf + len, 1, cap - len, f);
+        len          += n;
+        stats->bytes += n;
+
+        // Short reads only happen at the end of the file or on errors
+        if (len < cap) {
+            if (ferror(f)) {
+                free(buf);
+                return -1;
+            }
+            struct importChunk * chunk = calloc(1,
+                sizeof(struct importChunk));
+            chunk->data  = buf;
+            chunk->len   = len;
+            chunk->first = first;
+            submitChunk(imp, chunk);
+            return 0;
+        }
+
+        char * cut = lastLineEnd(buf, len);
+        if (cut == NULL) {
+            // A line longer than the chunk so far
+            cap *= 2;
+            buf  = realloc(buf, cap);
+            continue;
+        }
+
+        size_t used    = cut - buf + 1;
+        size_t carry   = len - used;
+        size_t nextCap = carry * 2 > IMPORT_CHUNK_SIZE ?
+          carry * 2 : IMPORT_CHUNK_SIZE;
+        char * next = malloc(nextCap);
+        memcpy(next, buf + used, carry);
+
+        struct importChunk * chunk = calloc(1, sizeof(struct importChunk));
+        chunk->data  = buf;
+        chunk->len   = used;
+        chunk->first = first;
+        submitChunk(imp, chunk);
+
+        first = 0;
+        buf   = next;
+        len   = carry;
+        cap   = nextCap;
+    }
+} /* readChunks */
+
+/*****************************************************************************
+* Numbering
+*****************************************************************************/
+
+struct importSeen {
+    uint64_t seen;
+    uint32_t node;
+};
+
+static int compareSeen(const void * a, const void * b) {
+    uint64_t x = ((const struct importSeen *) a)->seen;
+    uint64_t y = ((const struct importSeen *) b)->seen;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Returns the final number of every node, by its number shard by shard,
+ * which is the order the nodes first appear in the file. The nodes are
+ * bucketed by the chunk they first appear in and each bucket sorted.
+ */
+static uint32_t * numberNodes(struct importer * imp, const uint32_t * base,
+  uint32_t total) {
+    uint32_t *          end   = calloc(imp->chunks + 1, sizeof(uint32_t));
+    struct importSeen * order = malloc((total + 1) *
+        sizeof(struct importSeen));
+    uint32_t *          ids   = malloc((total + 1) * sizeof(uint32_t));
+
+    for (int s = 0; s < IMPORT_SHARDS; s++)
+        for (uint32_t local = 0; local < imp->shards[s].len; local++)
+            end[(imp->shards[s].firstSeen[local] >> 32) + 1]++;
+    for (uint32_t c = 0; c < imp->chunks; c++)
+        end[c + 1] += end[c];
+
+    // end[c] is where chunk c's bucket starts until it is filled, and then
+    // where it ends
+    for (int s = 0; s < IMPORT_SHARDS; s++) {
+        for (uint32_t local = 0; local < imp->shards[s].len; local++) {
+            uint64_t seen = imp->shards[s].firstSeen[local];
+            order[end[seen >> 32]++] = (struct importSeen) {
+                seen, base[s] + local
+            };
+        }
+    }
+    for (uint32_t c = 0; c < imp->chunks; c++) {
+        uint32_t start = c > 0 ? end[c - 1] : 0;
+        qsort(&order[start], end[c] - start, sizeof(struct importSeen),
+          compareSeen);
+    }
+
+    for (uint32_t i = 0; i < total; i++)
+        ids[order[i].node] = i;
+    free(order);
+    free(end);
+    return ids;
+} /* numberNodes */
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+enum importFormat importFormatFromPath(const char * path) {
+    const char * dot = strrchr(path, '.');
+
+    if (dot != NULL && strcasecmp(dot, ".csv") == 0)
+        return IMPORT_CSV;
+    if (dot != NULL && (strcasecmp(dot, ".dot") == 0
+      || strcasecmp(dot, ".gv") == 0))
+        return IMPORT_DOT;
+    return IMPORT_EDGE_LIST;
+}
+
+int importGraph(const char * path, enum importFormat format,
+  struct objectStore * objs, struct connectionStore * cons,
+  struct stringArena * labels, struct importStats * stats) {
+    FILE * f = fopen(path, "rb");
+
+    memset(stats, 0, sizeof(*stats));
+    if (f == NULL)
+        return -1;
+
+    struct importer * imp = calloc(1, sizeof(struct importer));
+    imp->format = format;
+    startWorkers(imp);
+    int err = readChunks(imp, f, stats);
+    finishWorkers(imp);
+    fclose(f);
+    stats->workers = imp->workerCount;
+    if (err != 0) {
+        freeImporter(imp);
+        return -1;
+    }
+
+    // Workers number nodes shard by shard in whatever order they get to
+    // them; the final numbers go by where they first appear in the file
+    uint32_t base[IMPORT_SHARDS];
+    uint32_t total = 0;
+    for (int s = 0; s < IMPORT_SHARDS; s++) {
+        base[s] = total;
+        total  += imp->shards[s].len;
+    }
+    uint32_t *    ids   = numberNodes(imp, base, total);
+    const char ** names = malloc((total + 1) * sizeof(const char *));
+    for (int s = 0; s < IMPORT_SHARDS; s++)
+        for (uint32_t local = 0; local < imp->shards[s].len; local++)
+            names[ids[base[s] + local]] = imp->shards[s].names[local];
+
+    struct handle * handles = malloc((total + 1) * sizeof(struct handle));
+    uint32_t        cols    = ceilf(sqrtf(total));
+    for (uint32_t id = 0; id < total; id++) {
+        // Jittered a little so that grid rows don't line up exactly
+        uint32_t h = id * 2654435761u;
+        handles[id] = objectStoreAdd(objs, (struct object) {
+            .type   = DOT,
+            .sticky = 0,
+            .label  = stringArenaIntern(labels, names[id]),
+            .radius = 10,
+            .color  = (Color) {
+                10 + (h >> 8) % 245, 10 + (h >> 16) % 245,
+                10 + (h >> 24) % 245, 255
+            },
+            .y = (id / cols) * IMPORT_SPACING + h % (IMPORT_SPACING / 2),
+            .x = (id % cols) * IMPORT_SPACING
+                 + (h >> 12) % (IMPORT_SPACING / 2)
+        });
+    }
+
+    // Connections in file order, whichever order the chunks were parsed in
+    struct importChunk ** chunks = malloc((imp->chunks + 1)
+        * sizeof(struct importChunk *));
+    for (struct importChunk * c = imp->done; c != NULL; c = c->next)
+        chunks[c->seq] = c;
+
+    for (uint32_t i = 0; i < imp->chunks; i++) {
+        struct importChunk * c = chunks[i];
+        for (uint32_t e = 0; e < c->edgesLen; e += 2) {
+            uint32_t a = c->edges[e];
+            uint32_t b = c->edges[e + 1];
+            connectionStoreAdd(cons, (struct connection) {
+                .label = NULL,
+                .width = 1,
+                .color = BLACK,
+                .src   = handles[ids[base[a % IMPORT_SHARDS]
+                                     + a / IMPORT_SHARDS]],
+                .dest  = handles[ids[base[b % IMPORT_SHARDS]
+                                     + b / IMPORT_SHARDS]]
+            });
+        }
+        stats->edges   += c->edgesLen / 2;
+        stats->skipped += c->skipped;
+    }
+    stats->nodes = total;
+
+    free(chunks);
+    free(handles);
+    free(names);
+    free(ids);
+    freeImporter(imp);
+    return 0;
+} /* importGraph */
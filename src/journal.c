@@ -0,0 +1,475 @@
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __unix__
+# include <unistd.h>
+#endif
+
+#include "journal.h"
+#include "scenefile.h"
+#include "storage.h"
+
+// Longer labels are cut short in the journal
+#define JOURNAL_MAX_LABEL 1024
+
+_Static_assert(sizeof(struct journalHeader) == 16, "journal header size");
+_Static_assert(sizeof(struct journalRecord) == 8, "journal record size");
+
+static uint32_t checksum(const uint8_t * data, size_t n, uint32_t h) {
+    // FNV-1a
+    for (size_t i = 0; i < n; i++)
+        h = (h ^ data[i]) * 16777619u;
+    return h;
+}
+
+static uint32_t recordChecksum(struct journalRecord r,
+  const uint8_t * payload) {
+    r.checksum = 0;
+    return checksum(payload, r.length,
+             checksum((const uint8_t *) &r, sizeof(r), 2166136261u));
+}
+
+/**
+ * Flushes stdio's buffer and, where there is such a thing, makes the kernel
+ * put the file on disk. On the web that is the storage layer's job.
+ */
+static int syncFile(FILE * f) {
+    if (fflush(f) != 0)
+        return -1;
+    storageTouch();
+    #ifdef __unix__
+        return fsync(fileno(f));
+    #else
+        return 0;
+    #endif
+}
+
+/*****************************************************************************
+* Encoding
+*****************************************************************************/
+
+static void put(struct journal * j, const void * data, size_t n) {
+    if (j->pendingLen + n > j->pendingCap) {
+        while (j->pendingLen + n > j->pendingCap)
+            j->pendingCap = j->pendingCap ? j->pendingCap * 2 : 4096;
+        j->pending = realloc(j->pending, j->pendingCap);
+    }
+    memcpy(j->pending + j->pendingLen, data, n);
+    j->pendingLen += n;
+}
+
+static void put32(struct journal * j, uint32_t v) {
+    put(j, &v, sizeof(v));
+}
+
+static void putHandle(struct journal * j, struct handle h) {
+    put32(j, h.index);
+    put32(j, h.generation);
+}
+
+static void putLabel(struct journal * j, const char * label) {
+    uint16_t n = JOURNAL_NO_LABEL;
+
+    if (label != NULL) {
+        size_t len = strlen(label);
+        n = len > JOURNAL_MAX_LABEL ? JOURNAL_MAX_LABEL : len;
+    }
+    put(j, &n, sizeof(n));
+    if (label != NULL)
+        put(j, label, n);
+}
+
+/**
+ * Starts a record, returning where its header goes. Returns SIZE_MAX when
+ * nothing should be journaled.
+ */
+static size_t beginRecord(struct journal * j) {
+    if (j->file == NULL || j->replaying)
+        return SIZE_MAX;
+
+    size_t at = j->pendingLen;
+    struct journalRecord r = { 0 };
+    put(j, &r, sizeof(r));
+    return at;
+}
+
+static void endRecord(struct journal * j, size_t at, enum journalOp op) {
+    struct journalRecord r = {
+        .op     = op,
+        .length = j->pendingLen - at - sizeof(r)
+    };
+
+    r.checksum = recordChecksum(r, j->pending + at + sizeof(r));
+    memcpy(j->pending + at, &r, sizeof(r));
+}
+
+void journalAdd(struct journal * j, struct handle h, struct object obj) {
+    size_t at = beginRecord(j);
+
+    if (at == SIZE_MAX)
+        return;
+
+    uint32_t color;
+    memcpy(&color, &obj.color, sizeof(color));
+    putHandle(j, h);
+    put32(j, obj.y);
+    put32(j, obj.x);
+    put32(j, obj.radius);
+    put32(j, color);
+    put32(j, obj.type | (obj.sticky != 0) << 8);
+    putLabel(j, obj.label);
+    endRecord(j, at, JOURNAL_ADD);
+}
+
+void journalMove(struct journal * j, struct handle h, int y, int x) {
+    size_t at = beginRecord(j);
+
+    if (at == SIZE_MAX)
+        return;
+
+    putHandle(j, h);
+    put32(j, y);
+    put32(j, x);
+    endRecord(j, at, JOURNAL_MOVE);
+}
+
+void journalConnect(struct journal * j, struct connection con) {
+    size_t at = beginRecord(j);
+
+    if (at == SIZE_MAX)
+        return;
+
+    uint32_t color;
+    memcpy(&color, &con.color, sizeof(color));
+    putHandle(j, con.src);
+    putHandle(j, con.dest);
+    put32(j, con.width);
+    put32(j, color);
+    putLabel(j, con.label);
+    endRecord(j, at, JOURNAL_CONNECT);
+}
+
+void journalRelabel(struct journal * j, struct handle h, const char * label) {
+    size_t at = beginRecord(j);
+
+    if (at == SIZE_MAX)
+        return;
+
+    putHandle(j, h);
+    putLabel(j, label);
+    endRecord(j, at, JOURNAL_RELABEL);
+}
+
+void journalDelete(struct journal * j, struct handle h) {
+    size_t at = beginRecord(j);
+
+    if (at == SIZE_MAX)
+        return;
+
+    putHandle(j, h);
+    endRecord(j, at, JOURNAL_DELETE);
+}
+
+/*****************************************************************************
+* Decoding
+*****************************************************************************/
+
+/**
+ * Reads fields out of one record's payload. Reading past the end sets bad
+ * and yields zeroes.
+ */
+struct reader {
+    const uint8_t * data;
+    size_t          len;
+    size_t          pos;
+    int             bad;
+};
+
+static void get(struct reader * r, void * out, size_t n) {
+    if (r->pos + n > r->len) {
+        r->bad = 1;
+        memset(out, 0, n);
+        return;
+    }
+    memcpy(out, r->data + r->pos, n);
+    r->pos += n;
+}
+
+static uint32_t get32(struct reader * r) {
+    uint32_t v;
+
+    get(r, &v, sizeof(v));
+    return v;
+}
+
+static struct handle getHandle(struct reader * r) {
+    struct handle h;
+
+    h.index      = get32(r);
+    h.generation = get32(r);
+    return h;
+}
+
+/**
+ * Copies a label into buf, which holds JOURNAL_MAX_LABEL + 1 bytes. Returns
+ * buf, or NULL for no label.
+ */
+static const char * getLabel(struct reader * r, char * buf) {
+    uint16_t n;
+
+    get(r, &n, sizeof(n));
+    if (n == JOURNAL_NO_LABEL || r->bad)
+        return NULL;
+    if (n > JOURNAL_MAX_LABEL) {
+        r->bad = 1;
+        return NULL;
+    }
+    get(r, buf, n);
+    buf[n] = '\0';
+    return buf;
+}
+
+static Color getColor(struct reader * r) {
+    uint32_t packed = get32(r);
+    Color    c;
+
+    memcpy(&c, &packed, sizeof(c));
+    return c;
+}
+
+/**
+ * Applies one record. Returns 0 if its payload was malformed.
+ */
+static int replayRecord(struct journalRecord rec, const uint8_t * payload,
+  const struct journalHandler * handler, void * ctx) {
+    struct reader r = { payload, rec.length, 0, 0 };
+    char   label[JOURNAL_MAX_LABEL + 1];
+
+    switch (rec.op) {
+        case JOURNAL_ADD: {
+            struct handle h   = getHandle(&r);
+            struct object obj = { .type = DOT };
+            obj.y      = get32(&r);
+            obj.x      = get32(&r);
+            obj.radius = get32(&r);
+            obj.color  = getColor(&r);
+            uint32_t flags = get32(&r);
+            obj.type   = flags & 0xff;
+            obj.sticky = (flags >> 8) & 1;
+            obj.label  = getLabel(&r, label);
+            if (!r.bad)
+                handler->add(h, obj, ctx);
+            break;
+        }
+        case JOURNAL_MOVE: {
+            struct handle h = getHandle(&r);
+            int y = get32(&r);
+            int x = get32(&r);
+            if (!r.bad)
+                handler->move(h, y, x, ctx);
+            break;
+        }
+        case JOURNAL_CONNECT: {
+            struct connection con;
+            con.src   = getHandle(&r);
+            con.dest  = getHandle(&r);
+            con.width = get32(&r);
+            con.color = getColor(&r);
+            con.label = getLabel(&r, label);
+            if (!r.bad)
+                handler->connect(con, ctx);
+            break;
+        }
+        case JOURNAL_RELABEL: {
+            struct handle h = getHandle(&r);
+            const char *  l = getLabel(&r, label);
+            if (!r.bad)
+                handler->relabel(h, l, ctx);
+            break;
+        }
+        case JOURNAL_DELETE: {
+            struct handle h = getHandle(&r);
+            if (!r.bad)
+                handler->remove(h, ctx);
+            break;
+        }
+        default:
+            return 0;
+    } /* switch */
+
+    return !r.bad;
+} /* replayRecord */
+
+/*****************************************************************************
+* Files
+*****************************************************************************/
+
+void journalInit(struct journal * j, const char * scenePath) {
+    size_t n = strlen(scenePath);
+
+    memset(j, 0, sizeof(*j));
+    j->scenePath   = strdup(scenePath);
+    j->journalPath = malloc(n + sizeof(".journal"));
+    memcpy(j->journalPath, scenePath, n);
+    memcpy(j->journalPath + n, ".journal", sizeof(".journal"));
+}
+
+void journalClose(struct journal * j) {
+    if (j->file != NULL) {
+        if (j->pendingLen > 0)
+            fwrite(j->pending, 1, j->pendingLen, j->file);
+        syncFile(j->file);
+        fclose(j->file);
+    }
+    free(j->pending);
+    free(j->scenePath);
+    free(j->journalPath);
+    memset(j, 0, sizeof(*j));
+}
+
+/**
+ * Rough size of the checkpoint of a scene, to decide when the journal has
+ * grown big enough that a new checkpoint is cheaper to load.
+ */
+static size_t checkpointSize(struct objectStore * objs,
+  struct connectionStore * cons) {
+    return sizeof(struct sceneHeader)
+           + objs->len * sizeof(struct sceneObjectRecord)
+           + cons->len * sizeof(struct sceneConnectionRecord);
+}
+
+/**
+ * Replaces the journal file with one holding the first len bytes of data,
+ * or just a header if data is NULL, and leaves it open for appending.
+ */
+static int rewriteJournal(struct journal * j, const uint8_t * data,
+  size_t len) {
+    struct journalHeader header = {
+        .version    = JOURNAL_VERSION,
+        .checkpoint = j->checkpoint
+    };
+
+    memcpy(header.magic, JOURNAL_MAGIC, 4);
+    if (data == NULL) {
+        data = (const uint8_t *) &header;
+        len  = sizeof(header);
+    }
+
+    if (j->file != NULL)
+        fclose(j->file);
+    j->file = fopen(j->journalPath, "wb");
+    if (j->file == NULL)
+        return -1;
+    if (fwrite(data, 1, len, j->file) != len || syncFile(j->file) != 0) {
+        fclose(j->file);
+        j->file = NULL;
+        return -1;
+    }
+
+    j->bytes    = len;
+    j->unsynced = 0;
+    return 0;
+}
+
+int journalCheckpoint(struct journal * j, struct objectStore * objs,
+  struct connectionStore * cons) {
+    // Whatever was pending is part of the checkpoint
+    j->pendingLen = 0;
+
+    if (sceneSave(j->scenePath, objs, cons, j->checkpoint + 1) != 0)
+        return -1;
+
+    // From here a crash leaves the new checkpoint and an old journal, which
+    // recovery ignores because the numbers don't match
+    j->checkpoint++;
+    j->checkpointBytes = checkpointSize(objs, cons);
+    return rewriteJournal(j, NULL, 0);
+}
+
+int journalRecover(struct journal * j, struct objectStore * objs,
+  struct connectionStore * cons, struct stringArena * labels,
+  const struct journalHandler * handler, void * ctx) {
+    uint32_t checkpoint;
+
+    if (sceneLoad(j->scenePath, objs, cons, labels, &checkpoint) != 0)
+        return -1;
+    j->checkpoint      = checkpoint;
+    j->checkpointBytes = checkpointSize(objs, cons);
+    handler->loaded(ctx);
+
+    // Read the whole journal; it never grows much past the checkpoint
+    uint8_t * data = NULL;
+    long      size = 0;
+    FILE *    f    = fopen(j->journalPath, "rb");
+    if (f != NULL) {
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        data = size > 0 ? malloc(size) : NULL;
+        if (data == NULL || fread(data, 1, size, f) != (size_t) size)
+            size = 0;
+        fclose(f);
+    }
+
+    struct journalHeader header;
+    size_t good = 0;
+    if ((size_t) size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, JOURNAL_MAGIC, 4) == 0
+          && header.version == JOURNAL_VERSION
+          && header.checkpoint == checkpoint)
+            good = sizeof(header);
+    }
+
+    // Replay up to the first torn or damaged record
+    j->replaying = 1;
+    while (good > 0 && good + sizeof(struct journalRecord) <= (size_t) size) {
+        struct journalRecord rec;
+        memcpy(&rec, data + good, sizeof(rec));
+
+        const uint8_t * payload = data + good + sizeof(rec);
+        if (good + sizeof(rec) + rec.length > (size_t) size
+          || recordChecksum(rec, payload) != rec.checksum
+          || !replayRecord(rec, payload, handler, ctx))
+            break;
+        good += sizeof(rec) + rec.length;
+    }
+    j->replaying = 0;
+
+    // Cut any damaged tail off so new records follow the last good one
+    rewriteJournal(j, good > 0 ? data : NULL, good);
+    free(data);
+    return 0;
+} /* journalRecover */
+
+void journalTick(struct journal * j, struct objectStore * objs,
+  struct connectionStore * cons, double now) {
+    if (j->file == NULL)
+        return;
+
+    int wrote = j->pendingLen > 0;
+    if (wrote) {
+        fwrite(j->pending, 1, j->pendingLen, j->file);
+        fflush(j->file);
+        j->bytes     += j->pendingLen;
+        j->pendingLen = 0;
+        j->unsynced   = 1;
+    }
+
+    // A tick with nothing new means the edits have stopped, for now
+    if (j->unsynced
+      && (!wrote || (now - j->lastSync) * 1000 >= JOURNAL_SYNC_MS)) {
+        syncFile(j->file);
+        j->unsynced = 0;
+        j->lastSync = now;
+    }
+
+    size_t limit = j->checkpointBytes > JOURNAL_MIN_CHECKPOINT ?
+      j->checkpointBytes : JOURNAL_MIN_CHECKPOINT;
+    if (j->bytes > limit)
+        journalCheckpoint(j, objs, cons);
+}
+
+int journalUnsynced(struct journal * j) {
+    return j->file != NULL && (j->unsynced || j->pendingLen > 0);
+}
@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "labelcache.h"
+
+// Gap left around each label in the atlas so filtering can't bleed
+#define ATLAS_PADDING 1
+
+static uint32_t hashText(const char * text) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+
+    for (; *text; text++)
+        h = (h ^ (uint8_t) *text) * 16777619u;
+    return h;
+}
+
+/**
+ * Returns the slot holding text, or the empty slot where it would go.
+ */
+static uint32_t findSlot(struct labelCache * cache, const char * text,
+  uint32_t hash) {
+    uint32_t mask = cache->entriesCap - 1;
+    uint32_t i    = hash & mask;
+
+    while (cache->entries[i].text != NULL) {
+        if (cache->entries[i].hash == hash
+          && strcmp(cache->entries[i].text, text) == 0)
+            return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void growTable(struct labelCache * cache) {
+    struct labelEntry * old = cache->entries;
+    uint32_t oldCap = cache->entriesCap;
+
+    cache->entriesCap = oldCap ? oldCap * 2 : 256;
+    cache->entries    = calloc(cache->entriesCap, sizeof(struct labelEntry));
+    for (uint32_t i = 0; i < oldCap; i++)
+        if (old[i].text != NULL)
+            cache->entries[findSlot(cache, old[i].text, old[i].hash)] = old[i];
+    free(old);
+}
+
+/**
+ * Forgets every rasterized label. The atlas pixels are simply overwritten
+ * as labels get rasterized again.
+ */
+static void resetAtlas(struct labelCache * cache) {
+    for (uint32_t i = 0; i < cache->entriesCap; i++) {
+        free(cache->entries[i].text);
+        cache->entries[i].text = NULL;
+    }
+    cache->entriesLen = 0;
+    cache->shelfX     = 0;
+    cache->shelfY     = 0;
+    cache->shelfH     = 0;
+}
+
+/**
+ * Finds the atlas rectangle for a label, rasterizing it on a miss.
+ * Returns 0 if the atlas has no room left.
+ */
+static int getLabel(struct labelCache * cache, const char * text,
+  Rectangle * rec) {
+    uint32_t hash = hashText(text);
+    uint32_t slot = findSlot(cache, text, hash);
+
+    if (cache->entries[slot].text != NULL) {
+        *rec = cache->entries[slot].rec;
+        return 1;
+    }
+
+    Image img = ImageText(text, cache->fontSize, WHITE);
+    int   w   = img.width + ATLAS_PADDING;
+    int   h   = img.height + ATLAS_PADDING;
+
+    // Shelf packing: fill rows left to right, start a new row when full
+    if (cache->shelfX + w > cache->atlasSize) {
+        cache->shelfY += cache->shelfH;
+        cache->shelfX  = 0;
+        cache->shelfH  = 0;
+    }
+    if (cache->shelfY + h > cache->atlasSize || w > cache->atlasSize) {
+        UnloadImage(img);
+        return 0;
+    }
+
+    *rec = (Rectangle) {
+        cache->shelfX, cache->shelfY, img.width, img.height
+    };
+    UpdateTextureRec(cache->atlas, *rec, img.data);
+    UnloadImage(img);
+
+    cache->shelfX += w;
+    if (h > cache->shelfH)
+        cache->shelfH = h;
+
+    if ((cache->entriesLen + 1) * 10 > cache->entriesCap * 7) {
+        growTable(cache);
+        slot = findSlot(cache, text, hash);
+    }
+    cache->entries[slot] = (struct labelEntry) {
+        strdup(text), hash, *rec
+    };
+    cache->entriesLen++;
+    return 1;
+} /* getLabel */
+
+void labelCacheInit(struct labelCache * cache, int atlasSize, int fontSize) {
+    Image blank = GenImageColor(atlasSize, atlasSize, BLANK);
+
+    cache->atlas     = LoadTextureFromImage(blank);
+    cache->atlasSize = atlasSize;
+    cache->fontSize  = fontSize;
+    UnloadImage(blank);
+
+    cache->entries    = NULL;
+    cache->entriesCap = 0;
+    cache->entriesLen = 0;
+    growTable(cache);
+    resetAtlas(cache);
+
+    cache->occupied   = NULL;
+    cache->gridW      = 0;
+    cache->gridH      = 0;
+    cache->placed     = NULL;
+    cache->placedLen  = 0;
+    cache->placedCap  = 0;
+    cache->suppressed = 0;
+}
+
+void labelCacheUnload(struct labelCache * cache) {
+    resetAtlas(cache);
+    free(cache->entries);
+    free(cache->occupied);
+    free(cache->placed);
+    UnloadTexture(cache->atlas);
+    cache->entries  = NULL;
+    cache->occupied = NULL;
+    cache->placed   = NULL;
+}
+
+void labelCacheBeginLayout(struct labelCache * cache, int screenW,
+  int screenH) {
+    int gridW = (screenW + LABEL_OCCUPANCY_CELL - 1) / LABEL_OCCUPANCY_CELL;
+    int gridH = (screenH + LABEL_OCCUPANCY_CELL - 1) / LABEL_OCCUPANCY_CELL;
+
+    if (gridW != cache->gridW || gridH != cache->gridH) {
+        free(cache->occupied);
+        cache->occupied = malloc(gridW * gridH);
+        cache->gridW    = gridW;
+        cache->gridH    = gridH;
+    }
+    memset(cache->occupied, 0, gridW * gridH);
+    cache->placedLen  = 0;
+    cache->suppressed = 0;
+}
+
+int labelCachePlace(struct labelCache * cache, const char * text, float x,
+  float y, float fontSize) {
+    Rectangle src;
+
+    if (text == NULL || text[0] == '\0')
+        return 0;
+    if (fontSize < LABEL_MIN_FONT_SIZE) {
+        cache->suppressed++;
+        return 0;
+    }
+
+    if (!getLabel(cache, text, &src)) {
+        // Atlas is full. Start it over, then bring back the labels already
+        // placed in this layout since their rectangles are now stale.
+        resetAtlas(cache);
+        for (uint32_t i = 0; i < cache->placedLen; i++) {
+            if (!getLabel(cache, cache->placed[i].text, &cache->placed[i].src)) {
+                cache->placedLen = i;
+                break;
+            }
+        }
+        if (!getLabel(cache, text, &src)) {
+            cache->suppressed++;
+            return 0;
+        }
+    }
+
+    float k = fontSize / cache->fontSize;
+    Rectangle dest = { x, y, src.width * k, src.height * k };
+
+    // Occupancy cells covered by the label, clipped to the screen
+    int cx0 = x / LABEL_OCCUPANCY_CELL;
+    int cy0 = y / LABEL_OCCUPANCY_CELL;
+    int cx1 = (x + dest.width) / LABEL_OCCUPANCY_CELL;
+    int cy1 = (y + dest.height) / LABEL_OCCUPANCY_CELL;
+    if (x + dest.width < 0 || y + dest.height < 0 || cx0 >= cache->gridW
+      || cy0 >= cache->gridH)
+        return 0;
+    if (cx0 < 0)
+        cx0 = 0;
+    if (cy0 < 0)
+        cy0 = 0;
+    if (cx1 >= cache->gridW)
+        cx1 = cache->gridW - 1;
+    if (cy1 >= cache->gridH)
+        cy1 = cache->gridH - 1;
+
+    for (int cy = cy0; cy <= cy1; cy++)
+        for (int cx = cx0; cx <= cx1; cx++)
+            if (cache->occupied[cy * cache->gridW + cx]) {
+                cache->suppressed++;
+                return 0;
+            }
+
+    for (int cy = cy0; cy <= cy1; cy++)
+        memset(&cache->occupied[cy * cache->gridW + cx0], 1, cx1 - cx0 + 1);
+
+    if (cache->placedLen == cache->placedCap) {
+        cache->placedCap = cache->placedCap ? cache->placedCap * 2 : 256;
+        cache->placed    = realloc(cache->placed,
+            cache->placedCap * sizeof(struct placedLabel));
+    }
+    cache->placed[cache->placedLen++] = (struct placedLabel) {
+        text, src, dest
+    };
+    return 1;
+} /* labelCachePlace */
+
+void labelCacheDraw(struct labelCache * cache, Color tint) {
+    // Every quad samples the same texture, so raylib batches them together
+    for (uint32_t i = 0; i < cache->placedLen; i++)
+        DrawTexturePro(cache->atlas, cache->placed[i].src,
+          cache->placed[i].dest, CLITERAL(Vector2) { 0, 0 }, 0, tint);
+}
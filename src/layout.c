@@ -0,0 +1,675 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef __EMSCRIPTEN__
+# include <unistd.h>
+#endif
+
+#include "layout.h"
+
+// Temperature a hand-moved object warms the layout back up to
+#define REHEAT_TEMPERATURE (LAYOUT_EDGE_LENGTH / 2)
+
+// Cells left to visit in a force query: at most three siblings wait on the
+// stack per level
+#define QUERY_STACK        (3 * LAYOUT_MAX_DEPTH + 4)
+
+#ifdef LAYOUT_THREADS
+# define LOCK(layout)   pthread_mutex_lock(&(layout)->lock)
+# define UNLOCK(layout) pthread_mutex_unlock(&(layout)->lock)
+#else
+# define LOCK(layout)
+# define UNLOCK(layout)
+#endif
+
+/*****************************************************************************
+* Quadtree
+*****************************************************************************/
+
+static int32_t newCell(struct layoutEngine * layout, float cy, float cx,
+  float half) {
+    if (layout->cellsLen == layout->cellsCap) {
+        layout->cellsCap = layout->cellsCap ? layout->cellsCap * 2 : 1024;
+        layout->cells    = realloc(layout->cells,
+            layout->cellsCap * sizeof(struct layoutCell));
+    }
+
+    layout->cells[layout->cellsLen] = (struct layoutCell) {
+        .cy    = cy,
+        .cx    = cx,
+        .half  = half,
+        .body  = STORE_NONE,
+        .child = { -1, -1, -1, -1 }
+    };
+    return layout->cellsLen++;
+}
+
+static int quadrantOf(struct layoutCell * cell, float y, float x) {
+    return (y >= cell->cy) << 1 | (x >= cell->cx);
+}
+
+/**
+ * Returns the child of cell c in quadrant q, creating it if needed.
+ */
+static int32_t childOf(struct layoutEngine * layout, int32_t c, int q) {
+    if (layout->cells[c].child[q] < 0) {
+        struct layoutCell parent = layout->cells[c];
+        float half = parent.half / 2;
+        int32_t child = newCell(layout,
+            parent.cy + (q & 2 ? half : -half),
+            parent.cx + (q & 1 ? half : -half), half);
+        layout->cells[c].child[q] = child;
+    }
+    return layout->cells[c].child[q];
+}
+
+static void insertBody(struct layoutEngine * layout, uint32_t body) {
+    float   y     = layout->front[2 * body];
+    float   x     = layout->front[2 * body + 1];
+    int32_t c     = 0;
+    int     depth = 0;
+
+    for (;;) {
+        struct layoutCell * cell = &layout->cells[c];
+
+        if (cell->count == 0) {
+            cell->body  = body;
+            cell->count = 1;
+            cell->sumY  = y;
+            cell->sumX  = x;
+            return;
+        }
+
+        if (cell->body != STORE_NONE) {
+            if (depth >= LAYOUT_MAX_DEPTH) {
+                // Too close to tell apart, let them share the leaf
+                cell->count++;
+                cell->sumY += y;
+                cell->sumX += x;
+                return;
+            }
+
+            // Split the leaf, moving the body living here down a level
+            uint32_t old = cell->body;
+            float    oldY = cell->sumY;
+            float    oldX = cell->sumX;
+            cell->body = STORE_NONE;
+
+            int32_t child = childOf(layout, c,
+                quadrantOf(&layout->cells[c], oldY, oldX));
+            layout->cells[child].body  = old;
+            layout->cells[child].count = 1;
+            layout->cells[child].sumY  = oldY;
+            layout->cells[child].sumX  = oldX;
+            cell = &layout->cells[c];
+        }
+
+        cell->count++;
+        cell->sumY += y;
+        cell->sumX += x;
+        c = childOf(layout, c, quadrantOf(cell, y, x));
+        depth++;
+    }
+} /* insertBody */
+
+static void buildTree(struct layoutEngine * layout) {
+    float minY = INFINITY, minX = INFINITY;
+    float maxY = -INFINITY, maxX = -INFINITY;
+
+    for (uint32_t i = 0; i < layout->nodeCount; i++) {
+        minY = fminf(minY, layout->front[2 * i]);
+        maxY = fmaxf(maxY, layout->front[2 * i]);
+        minX = fminf(minX, layout->front[2 * i + 1]);
+        maxX = fmaxf(maxX, layout->front[2 * i + 1]);
+    }
+
+    layout->cellsLen = 0;
+    newCell(layout, (minY + maxY) / 2, (minX + maxX) / 2,
+      fmaxf(maxY - minY, maxX - minX) / 2 + 1);
+    for (uint32_t i = 0; i < layout->nodeCount; i++)
+        insertBody(layout, i);
+}
+
+/*****************************************************************************
+* Simulation Step
+*****************************************************************************/
+
+/**
+ * Net force on node i: repulsion from every other body through the tree,
+ * attraction along its connections and a little gravity.
+ */
+static void forceOn(struct layoutEngine * layout, uint32_t i, float * fy,
+  float * fx) {
+    const float k2 = LAYOUT_EDGE_LENGTH * LAYOUT_EDGE_LENGTH;
+    float py = layout->front[2 * i];
+    float px = layout->front[2 * i + 1];
+    float y  = 0, x = 0;
+
+    int32_t stack[QUERY_STACK];
+    int     top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        struct layoutCell * cell = &layout->cells[stack[--top]];
+        if (cell->count == 0 || (cell->body == i && cell->count == 1))
+            continue;
+
+        float dy = py - cell->sumY / cell->count;
+        float dx = px - cell->sumX / cell->count;
+        float d2 = dy * dy + dx * dx;
+        float size = 2 * cell->half;
+
+        if (cell->body == STORE_NONE
+          && size * size >= LAYOUT_THETA * LAYOUT_THETA * d2) {
+            // Too close to approximate, open the cell up
+            for (int q = 0; q < 4; q++)
+                if (cell->child[q] >= 0 && top < QUERY_STACK)
+                    stack[top++] = cell->child[q];
+            continue;
+        }
+
+        if (d2 < 0.01f) {
+            // Sitting on top of each other: push apart in a direction that
+            // differs per node so they can't stay stuck together
+            dy = sinf(i * 2.39996f);
+            dx = cosf(i * 2.39996f);
+            d2 = 1;
+        }
+
+        // k^2 / d along the unit vector, once per body in the cell
+        float f = k2 * cell->count / d2;
+        y += dy * f;
+        x += dx * f;
+    }
+
+    // d^2 / k towards each neighbour
+    for (uint32_t n = layout->neighborOffsets[i];
+      n < layout->neighborOffsets[i + 1]; n++) {
+        uint32_t j  = layout->neighbors[n];
+        float    dy = layout->front[2 * j] - py;
+        float    dx = layout->front[2 * j + 1] - px;
+        float    d  = sqrtf(dy * dy + dx * dx);
+        y += dy * d / LAYOUT_EDGE_LENGTH;
+        x += dx * d / LAYOUT_EDGE_LENGTH;
+    }
+
+    struct layoutCell * root = &layout->cells[0];
+    y -= (py - root->sumY / root->count) * LAYOUT_GRAVITY;
+    x -= (px - root->sumX / root->count) * LAYOUT_GRAVITY;
+
+    *fy = y;
+    *fx = x;
+} /* forceOn */
+
+/**
+ * Moves nodes [from, to) along their net force, at most temperature far,
+ * reading the front buffer and writing the back one.
+ */
+static void stepRange(struct layoutEngine * layout, uint32_t from,
+  uint32_t to) {
+    for (uint32_t i = from; i < to; i++) {
+        float y = layout->front[2 * i];
+        float x = layout->front[2 * i + 1];
+
+        if (!layout->pinned[i]) {
+            float fy, fx;
+            forceOn(layout, i, &fy, &fx);
+            float len = sqrtf(fy * fy + fx * fx);
+            if (len > 0) {
+                float step = fminf(len, layout->temperature) / len;
+                y += fy * step;
+                x += fx * step;
+            }
+        }
+
+        layout->back[2 * i]     = y;
+        layout->back[2 * i + 1] = x;
+    }
+}
+
+/**
+ * Nodes handled by worker w, with the simulation thread itself taking the
+ * last share.
+ */
+static void stepShare(struct layoutEngine * layout, int w) {
+    uint64_t n      = layout->nodeCount;
+    int      shares = layout->workerCount + 1;
+
+    stepRange(layout, n * w / shares, n * (w + 1) / shares);
+}
+
+/**
+ * Applies the game loop's commands. Called with the lock held, while no
+ * step is in progress, so it may write the front buffer.
+ */
+static void applyCommands(struct layoutEngine * layout) {
+    for (uint32_t c = 0; c < layout->commandsLen; c++) {
+        struct layoutCommand cmd = layout->commands[c];
+
+        if (cmd.pin >= 0)
+            layout->pinned[cmd.node] = cmd.pin;
+        if (cmd.move) {
+            layout->front[2 * cmd.node]     = cmd.y;
+            layout->front[2 * cmd.node + 1] = cmd.x;
+        }
+        if (cmd.move || cmd.reheat) {
+            layout->temperature = fmaxf(layout->temperature,
+                REHEAT_TEMPERATURE);
+            layout->converged = layout->nodeCount < 2;
+        }
+    }
+    layout->commandsLen = 0;
+}
+
+/**
+ * Publishes the step just computed and cools down. Called with the lock
+ * held.
+ */
+static void finishStep(struct layoutEngine * layout) {
+    float * t = layout->front;
+
+    layout->front = layout->back;
+    layout->back  = t;
+    layout->version++;
+
+    layout->temperature *= LAYOUT_COOLING;
+    if (layout->temperature < LAYOUT_MIN_TEMPERATURE)
+        layout->converged = 1;
+}
+
+/*****************************************************************************
+* Threads
+*****************************************************************************/
+
+#ifdef LAYOUT_THREADS
+static void * workerMain(void * arg) {
+    struct layoutWorker * worker = arg;
+    struct layoutEngine * layout = worker->engine;
+    uint32_t seen = 0;
+
+    LOCK(layout);
+    for (;;) {
+        while (layout->jobGeneration == seen && !layout->quit)
+            pthread_cond_wait(&layout->workReady, &layout->lock);
+        // A job posted before quitting still has to be finished, or the
+        // simulation thread would wait for it forever
+        if (layout->jobGeneration == seen)
+            break;
+        seen = layout->jobGeneration;
+        UNLOCK(layout);
+
+        stepShare(layout, worker->index);
+
+        LOCK(layout);
+        if (--layout->jobsPending == 0)
+            pthread_cond_signal(&layout->workDone);
+    }
+    UNLOCK(layout);
+    return NULL;
+}
+
+static void * simulationMain(void * arg) {
+    struct layoutEngine * layout = arg;
+
+    LOCK(layout);
+    while (!layout->quit) {
+        // Sleep until there is something to do
+        if (layout->paused
+          || (layout->converged && layout->commandsLen == 0)) {
+            pthread_cond_wait(&layout->wake, &layout->lock);
+            continue;
+        }
+
+        applyCommands(layout);
+        UNLOCK(layout);
+
+        buildTree(layout);
+
+        // The workers may have quit while the tree was being built
+        LOCK(layout);
+        if (layout->quit)
+            break;
+        layout->jobGeneration++;
+        layout->jobsPending = layout->workerCount;
+        pthread_cond_broadcast(&layout->workReady);
+        UNLOCK(layout);
+
+        stepShare(layout, layout->workerCount);
+
+        LOCK(layout);
+        while (layout->jobsPending > 0)
+            pthread_cond_wait(&layout->workDone, &layout->lock);
+        finishStep(layout);
+    }
+    UNLOCK(layout);
+    return NULL;
+}
+
+/**
+ * Tells the simulation and its workers to quit and waits for the workers.
+ */
+static void stopWorkers(struct layoutEngine * layout) {
+    LOCK(layout);
+    layout->quit = 1;
+    pthread_cond_broadcast(&layout->wake);
+    pthread_cond_broadcast(&layout->workReady);
+    UNLOCK(layout);
+
+    for (int w = 0; w < layout->workerCount; w++)
+        pthread_join(layout->workers[w].thread, NULL);
+}
+
+#endif /* ifdef LAYOUT_THREADS */
+
+/**
+ * Whether layoutSync() runs the steps: without threads, or when the
+ * simulation thread couldn't be started.
+ */
+static int stepsInSync(struct layoutEngine * layout) {
+    #ifdef LAYOUT_THREADS
+        return !layout->threaded;
+    #else
+        (void) layout;
+        return 1;
+    #endif
+}
+
+/*****************************************************************************
+* Game Loop Side
+*****************************************************************************/
+
+void layoutInit(struct layoutEngine * layout) {
+    memset(layout, 0, sizeof(*layout));
+    #ifdef LAYOUT_THREADS
+        pthread_mutex_init(&layout->lock, NULL);
+        pthread_cond_init(&layout->wake, NULL);
+        pthread_cond_init(&layout->workReady, NULL);
+        pthread_cond_init(&layout->workDone, NULL);
+    #endif
+}
+
+static void freeSnapshot(struct layoutEngine * layout) {
+    free(layout->handles);
+    free(layout->nodeOfSlot);
+    free(layout->neighborOffsets);
+    free(layout->neighbors);
+    free(layout->pinned);
+    free(layout->uiPinned);
+    free(layout->front);
+    free(layout->back);
+    free(layout->shown);
+    free(layout->commands);
+    free(layout->cells);
+    layout->handles         = NULL;
+    layout->nodeOfSlot      = NULL;
+    layout->neighborOffsets = NULL;
+    layout->neighbors       = NULL;
+    layout->pinned          = NULL;
+    layout->uiPinned        = NULL;
+    layout->front           = NULL;
+    layout->back            = NULL;
+    layout->shown           = NULL;
+    layout->commands        = NULL;
+    layout->cells           = NULL;
+    layout->nodeCount       = 0;
+    layout->slotCount       = 0;
+    layout->commandsLen     = 0;
+    layout->commandsCap     = 0;
+    layout->cellsLen        = 0;
+    layout->cellsCap        = 0;
+}
+
+/**
+ * Returns the snapshot node of an object, or STORE_NONE if it isn't in the
+ * snapshot.
+ */
+static uint32_t nodeOf(struct layoutEngine * layout, struct handle obj) {
+    if (obj.index >= layout->slotCount)
+        return STORE_NONE;
+
+    uint32_t node = layout->nodeOfSlot[obj.index];
+    if (node == STORE_NONE || !handleEqual(layout->handles[node], obj))
+        return STORE_NONE;
+    return node;
+}
+
+static void takeSnapshot(struct layoutEngine * layout,
+  struct objectStore * objs, struct connectionStore * cons) {
+    uint32_t n = objs->len;
+
+    layout->nodeCount  = n;
+    layout->slotCount  = objs->slots.len;
+    layout->handles    = malloc((n + 1) * sizeof(struct handle));
+    layout->nodeOfSlot = malloc((layout->slotCount + 1) * sizeof(uint32_t));
+    layout->pinned     = calloc(n + 1, 1);
+    layout->uiPinned   = calloc(n + 1, 1);
+    layout->front      = malloc((2 * n + 1) * sizeof(float));
+    layout->back       = malloc((2 * n + 1) * sizeof(float));
+    layout->shown      = malloc((2 * n + 1) * sizeof(float));
+
+    memset(layout->nodeOfSlot, 0xff, layout->slotCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        layout->handles[i] = objectStoreHandle(objs, i);
+        layout->nodeOfSlot[layout->handles[i].index] = i;
+        layout->front[2 * i]     = OBJECT_FIELD(objs, y, i);
+        layout->front[2 * i + 1] = OBJECT_FIELD(objs, x, i);
+    }
+
+    // Neighbours of every node, both directions, as CSR
+    layout->neighborOffsets = calloc(n + 2, sizeof(uint32_t));
+    for (uint32_t c = 0; c < cons->len; c++) {
+        uint32_t s = nodeOf(layout, CONNECTION_FIELD(cons, src, c));
+        uint32_t d = nodeOf(layout, CONNECTION_FIELD(cons, dest, c));
+        if (s == STORE_NONE || d == STORE_NONE || s == d)
+            continue;
+        layout->neighborOffsets[s + 1]++;
+        layout->neighborOffsets[d + 1]++;
+    }
+    for (uint32_t i = 0; i < n; i++)
+        layout->neighborOffsets[i + 1] += layout->neighborOffsets[i];
+
+    uint32_t * cursor = malloc((n + 1) * sizeof(uint32_t));
+    memcpy(cursor, layout->neighborOffsets, (n + 1) * sizeof(uint32_t));
+    layout->neighbors = malloc((layout->neighborOffsets[n] + 1) *
+        sizeof(uint32_t));
+    for (uint32_t c = 0; c < cons->len; c++) {
+        uint32_t s = nodeOf(layout, CONNECTION_FIELD(cons, src, c));
+        uint32_t d = nodeOf(layout, CONNECTION_FIELD(cons, dest, c));
+        if (s == STORE_NONE || d == STORE_NONE || s == d)
+            continue;
+        layout->neighbors[cursor[s]++] = d;
+        layout->neighbors[cursor[d]++] = s;
+    }
+    free(cursor);
+} /* takeSnapshot */
+
+void layoutStart(struct layoutEngine * layout, struct objectStore * objs,
+  struct connectionStore * cons) {
+    // Remember what was pinned, by handle, across the restart
+    struct handle * pins = malloc((layout->nodeCount + 1) *
+        sizeof(struct handle));
+    uint32_t pinsLen = 0;
+    for (uint32_t i = 0; i < layout->nodeCount; i++)
+        if (layout->uiPinned[i])
+            pins[pinsLen++] = layout->handles[i];
+
+    int paused     = layout->paused;
+    int restarting = layout->running;
+    layoutStop(layout);
+
+    // The threads are gone, so these can be read without the lock
+    int   converged   = layout->converged;
+    float temperature = layout->temperature;
+    takeSnapshot(layout, objs, cons);
+    for (uint32_t p = 0; p < pinsLen; p++) {
+        uint32_t node = nodeOf(layout, pins[p]);
+        if (node != STORE_NONE) {
+            layout->pinned[node]   = 1;
+            layout->uiPinned[node] = 1;
+        }
+    }
+    free(pins);
+
+    layout->running       = 1;
+    layout->paused        = paused;
+    layout->converged     = layout->nodeCount < 2;
+    layout->temperature   = LAYOUT_EDGE_LENGTH * 2;
+    if (restarting) {
+        layout->converged   = converged || layout->nodeCount < 2;
+        layout->temperature = temperature;
+    }
+    layout->version       = 0;
+    layout->syncedVersion = 0;
+
+    layout->workerCount = 0;
+    #ifdef LAYOUT_THREADS
+        // One core for the game loop and one for the simulation thread
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        layout->workerCount = cores > 2 ? cores - 2 : 0;
+        if (layout->workerCount > LAYOUT_MAX_WORKERS)
+            layout->workerCount = LAYOUT_MAX_WORKERS;
+
+        layout->quit          = 0;
+        layout->jobGeneration = 0;
+        int started = 0;
+        for (; started < layout->workerCount; started++) {
+            layout->workers[started].engine = layout;
+            layout->workers[started].index  = started;
+            if (pthread_create(&layout->workers[started].thread, NULL,
+              workerMain, &layout->workers[started]) != 0)
+                break;
+        }
+        layout->workerCount = started;
+
+        layout->threaded = pthread_create(&layout->thread, NULL,
+            simulationMain, layout) == 0;
+        if (!layout->threaded) {
+            // layoutSync() steps once per frame instead, all on its own
+            stopWorkers(layout);
+            layout->workerCount = 0;
+        }
+    #endif
+} /* layoutStart */
+
+void layoutStop(struct layoutEngine * layout) {
+    if (!layout->running)
+        return;
+
+    #ifdef LAYOUT_THREADS
+        if (layout->threaded) {
+            stopWorkers(layout);
+            pthread_join(layout->thread, NULL);
+            layout->threaded = 0;
+        }
+    #endif
+
+    freeSnapshot(layout);
+    layout->running = 0;
+    layout->paused  = 0;
+}
+
+void layoutSetPaused(struct layoutEngine * layout, int paused) {
+    LOCK(layout);
+    layout->paused = paused;
+    #ifdef LAYOUT_THREADS
+        pthread_cond_signal(&layout->wake);
+    #endif
+    UNLOCK(layout);
+}
+
+int layoutActive(struct layoutEngine * layout) {
+    if (!layout->running)
+        return 0;
+
+    LOCK(layout);
+    int active = !layout->paused
+      && (!layout->converged || layout->commandsLen > 0
+      || layout->version != layout->syncedVersion);
+    UNLOCK(layout);
+    return active;
+}
+
+static void pushCommand(struct layoutEngine * layout,
+  struct layoutCommand cmd) {
+    LOCK(layout);
+    if (layout->commandsLen == layout->commandsCap) {
+        layout->commandsCap = layout->commandsCap ? layout->commandsCap * 2 :
+          16;
+        layout->commands = realloc(layout->commands,
+            layout->commandsCap * sizeof(struct layoutCommand));
+    }
+    layout->commands[layout->commandsLen++] = cmd;
+    #ifdef LAYOUT_THREADS
+        pthread_cond_signal(&layout->wake);
+    #endif
+    UNLOCK(layout);
+}
+
+void layoutPin(struct layoutEngine * layout, struct handle obj, int pinned) {
+    uint32_t node = nodeOf(layout, obj);
+
+    if (node == STORE_NONE)
+        return;
+    layout->uiPinned[node] = pinned != 0;
+    pushCommand(layout, (struct layoutCommand) { node, pinned != 0, 0, 0, 0 });
+}
+
+int layoutIsPinned(struct layoutEngine * layout, struct handle obj) {
+    uint32_t node = nodeOf(layout, obj);
+
+    return node != STORE_NONE && layout->uiPinned[node];
+}
+
+void layoutMove(struct layoutEngine * layout, struct handle obj, int y,
+  int x) {
+    uint32_t node = nodeOf(layout, obj);
+
+    if (node == STORE_NONE)
+        return;
+    pushCommand(layout, (struct layoutCommand) { node, -1, 1, y, x });
+}
+
+void layoutReheat(struct layoutEngine * layout) {
+    if (!layout->running)
+        return;
+
+    // A step in progress reads the temperature, so it is only raised
+    // between steps
+    pushCommand(layout, (struct layoutCommand) {
+        .node   = STORE_NONE,
+        .pin    = -1,
+        .reheat = 1
+    });
+}
+
+int layoutSync(struct layoutEngine * layout, layoutVisitor visit,
+  void * ctx) {
+    if (!layout->running)
+        return 0;
+
+    // No simulation thread: step right here, once per frame
+    if (stepsInSync(layout) && !layout->paused
+      && (!layout->converged || layout->commandsLen > 0)) {
+        applyCommands(layout);
+        buildTree(layout);
+        stepShare(layout, 0);
+        finishStep(layout);
+    }
+
+    LOCK(layout);
+    if (layout->version == layout->syncedVersion) {
+        UNLOCK(layout);
+        return 0;
+    }
+    memcpy(layout->shown, layout->front,
+      2 * layout->nodeCount * sizeof(float));
+    layout->syncedVersion = layout->version;
+    UNLOCK(layout);
+
+    // Pinned objects are placed by the game loop, which may be ahead of the
+    // simulation
+    for (uint32_t i = 0; i < layout->nodeCount; i++)
+        if (!layout->uiPinned[i])
+            visit(layout->handles[i], lroundf(layout->shown[2 * i]),
+              lroundf(layout->shown[2 * i + 1]), ctx);
+    return 1;
+} /* layoutSync */
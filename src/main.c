@@ -30,75 +30,104 @@
 // Project header includes ----------------------------------------------------
 #include "viewport.h"
 #include "util.h"
+#include "spatial.h"
+#include "store.h"
+#include "cull.h"
+#include "grid.h"
+#include "redraw.h"
+#include "labelcache.h"
+#include "cluster.h"
+#include "scenefile.h"
+#include "pick.h"
+#include "synth.h"
+#include "arena.h"
+#include "adjacency.h"
+#include "layout.h"
+#include "profiler.h"
+#include "journal.h"
+#include "timing.h"
+#include "storage.h"
+#include "selection.h"
+#include "spritebatch.h"
+#include "edgedensity.h"
+#include "pager.h"
+#include "pathfind.h"
+#include "pacer.h"
+#include "importer.h"
+#include "export.h"
+#include "minimap.h"
 
 /*****************************************************************************
 * Macros and Constants
 *****************************************************************************/
 #define LOG(X) printf("%s: %d", __FILE__, __LINE__, X)
-#define MOUSE_ACTIVE_CLOCK_TICKS 15
-#define MAX_OBJECTS              256
+#define MOUSE_ACTIVE_MS          50
 #define MINOR_GRIDLINE_DISTANCE  100
 #define MINOR_GRID_SEG_LENGTH    2
 #define COLLISION_MARGIN_PX      2
 #define TRUE                     1
 #define FALSE                    0
-#define DOUBLE_CLICK_PERIOD      100
+#define DOUBLE_CLICK_MS          300
 #define MAX_LABEL_LENGTH         16
+#define GRID_BUCKETS             1024
+#define LABEL_FONT_SIZE          20
+#define LABEL_ATLAS_SIZE         2048
+#define ZOOM_STEP                1.1f
+#define CLUSTER_ZOOM             0.3f
+#define CLUSTER_MIN_PX           48
+#define SCENE_PATH               "scene.cvs"
+#define AUTOSAVE_NAME            "autosave.cvs"
+#define PROFILE_BAR_WIDTH        120
+#define PROFILE_BUDGET_MS        (1000.0f / 60)
+#define EDGE_DENSITY_LIMIT       20000
+#define EDGE_DENSITY_SHIFT       1
+#define PAGE_DIR                 "pages"
+#define PAGE_TILE_SIZE           (MINOR_GRIDLINE_DISTANCE * 32)
+#define MAX_FPS                  144
+#define EXPORT_PNG_PATH          "scene.png"
+#define EXPORT_SVG_PATH          "scene.svg"
+#define EXPORT_WIDTH             4096
+#define MINIMAP_SIZE             MINIMAP_CELLS
+#define MINIMAP_MARGIN           10
 
 /*****************************************************************************
 * Structs and Typedefs
 *****************************************************************************/
 
 
-enum objectType {
-    DOT,
-    SPRITE
-};
-
 enum dragState {
     VIEWPORT,
-    OBJECT
-};
-
-struct object {
-    enum objectType type;
-
-    // sticky = 1: Should be drawn at edge when offscreen.
-    // sticky = 0: Hidden when offscreen.
-    int    sticky: 1;
-
-    // A label that can be drawn next to this object
-    char * label;
+    OBJECT,
 
-    // Circle radius.
-    int    radius;
+    // Moving every selected object
+    GROUP,
 
-    Color  color;
+    // Drawing a selection box or lasso
+    SELECTING,
 
-    // Object world position with origin at top left
-    int    y, x;
+    // Panning to wherever the mouse points on the minimap
+    MINIMAP
 };
 
 /**
- * A connection is an edge between two `struct object` nodes.
+ * A cluster of objects drawn in their place when zoomed far out.
  */
-struct connection {
-    // A label that can be drawn next to this object
-    char *          label;
+struct clusterMarker {
+    // Centroid in render texture coordinates
+    float    x, y;
+    uint32_t count;
 
-    int             width;
-
-    Color           color;
-
-    struct object * src;
-    struct object * dest;
+    // The count as text, kept here so the label cache can point at it
+    char     text[12];
 };
 
 /*****************************************************************************
 * Global Variables
 *****************************************************************************/
 RenderTexture rt;
-Texture2D skull;
+
+// Dots, sprites and highlight rings, drawn as quads from one atlas
+struct spriteBatch sprites;
 struct viewport vp;
 
 // Objects can be dragged and so can the viewport itself.
@@ -107,31 +136,124 @@ Vector2 mouseDragPoint;
 Vector2 dragViewportFrom;
 Vector2 dragObjectFrom;
 
-// We will infer double click from time passed between last 2 clicks
-clock_t prevMouseActivity;
-clock_t lastMouseActivity;
-clock_t currentTime;
+// We will infer double click from time passed between last 2 clicks.
+// Wall clock seconds, so that a loaded machine doesn't stretch them.
+double prevMouseActivity;
+double lastMouseActivity;
+double currentTime;
 int mouseMoving = 0;
+
+// Picks the target frame rate and measures drag latency
+struct framePacer pacer;
 enum dragState ds;
 
 // Objects can be connected by right clicking one object and then the other.
 // Right clicking where there is not an object will clear both places.
-struct object * connectionSource;
-struct object * connectionDestination;
+struct handle connectionSource;
+struct handle connectionDestination;
 
 // 0 if selecting Source; 1 if selecting Destination.
 int connectionSelected = 0;
 
-// Objects and connections arrays
-struct object objs[MAX_OBJECTS];
-int objsLen = 0;
-struct connection cons[MAX_OBJECTS];
-int consLen = 0;
-
-struct object * recentlyGrabbedObject;
+// Alt+right-click picks two objects to find a route between, searched for
+// in the background and drawn highlighted
+struct pathFinder paths;
+struct handle pathSource;
+int pathSelected = 0;
+
+// Objects and connections stores
+struct objectStore objs;
+struct connectionStore cons;
+
+// Storage for every object and connection label, released with the scene
+struct stringArena labelStrings;
+
+// Connections touching each object, and which objects are connected
+struct adjacencyIndex adjacency;
+
+// Force-directed auto-layout. layoutStale is set when objects or
+// connections are added or removed, so the layout restarts on the new graph,
+// and layoutEdited when that was an edit rather than paging, so the layout
+// warms up again to fit it in.
+struct layoutEngine layout;
+int layoutStale  = FALSE;
+int layoutEdited = FALSE;
+
+// Whether event waiting is off so that frames keep coming while the layout
+// moves things around or a route search runs
+int animating = FALSE;
+
+// The scene to start with, from the command line. Starting waits for the
+// storage layer, which is only ready some frames in on the web.
+const char * startLoadPath = NULL;
+const char * startImportPath = NULL;
+uint32_t startSynthObjects = 0;
+int sceneStarted = FALSE;
+
+// Every edit is appended here, and the scene is recovered from it on the
+// next start
+struct journal autosave;
+
+// With --paged, objects far from the viewport are paged out to PAGE_DIR.
+// The autosave journal is off then, since it can't see paged out objects.
+struct pager pager;
+int paging = FALSE;
+
+// Whether the layout moved objects since the last checkpoint. Its moves
+// aren't journaled one by one; the scene is checkpointed once it settles.
+int layoutUnsaved = FALSE;
+
+struct handle recentlyGrabbedObject;
+
+// Objects picked with Shift+drag (box) or Ctrl+drag (lasso), which move
+// together when one of them is dragged
+struct selection selection;
+
+// Where the box or lasso being drawn started, and the lasso so far, in
+// world coordinates
+struct selectionPoint selectFrom;
+struct selectionPoint * lasso;
+uint32_t lassoLen = 0;
+uint32_t lassoCap = 0;
+int lassoing      = FALSE;
+
+// Whether the object being dragged has actually moved, so that a click
+// doesn't journal a move
+int dragMoved = FALSE;
+
+// Objects indexed by world position, for hit-testing under the cursor.
+// Cells line up with the minor gridlines and ids are handle indices.
+struct spatialGrid objGrid;
+int maxObjectRadius = 0;
+
+// Dotted background grid, cached in a texture
+struct gridRenderer gridlines;
+
+// What can be seen this frame; rebuilt after input is handled
+struct visibleSet visible;
+
+// Past EDGE_DENSITY_LIMIT visible connections, they are drawn as one
+// density image at half resolution instead of line by line
+struct edgeDensity density;
+Texture2D densityTexture;
+
+// Rasterized labels, and which of them are placed on screen
+struct labelCache labels;
+
+// Object positions aggregated at several cell sizes, and the clusters
+// visible this frame when zoomed out past CLUSTER_ZOOM
+struct clusterIndex clusters;
+
+// Object counts over the whole world, shown in the bottom right corner
+struct minimap minimap;
+Texture2D minimapTexture;
+struct clusterMarker * markers;
+uint32_t markersLen = 0;
+uint32_t markersCap = 0;
 
 // UI state
 int overlayState = FALSE;
+struct handle overlayObject;
 char overlayTextInput[MAX_LABEL_LENGTH + 1];
 int overlayTextIndex  = 0;
 const int panelHeight = 28;
@@ -139,115 +261,604 @@ const int panelWidth  = 200;
 int panelX;
 int panelY;
 
-
-#ifdef __EMSCRIPTEN__
-    EM_JS(void, idbfs_put, (const char * filename, const char * str), {
-    FS.writeFile(UTF8ToString(filename), UTF8ToString(str));
-    FS.syncfs(false, function(err) {
-        assert(!err);
-    });
-});
-    EM_JS(char *, idbfs_get, (const char * filename), {
-    var arr         = FS.readFile(UTF8ToString(filename));
-    var jsString    = new TextDecoder().decode(arr);
-    var lengthBytes = lengthBytesUTF8(jsString) + 1;
-    // console.log(jsString);
-    var stringOnWasmHeap = _malloc(lengthBytes);
-    stringToUTF8(jsString, stringOnWasmHeap, lengthBytes);
-    return stringOnWasmHeap;
-});
-#endif /* ifdef __EMSCRIPTEN__ */
-
 /*****************************************************************************
 * Functions
 *****************************************************************************/
 
 /**
- * Adds an object to the object array and returns its index.
+ * Puts an object just added to the store into the indexes.
  */
-int addObject(struct object newObj) {
-    objs[objsLen] = newObj;
-    objsLen++;
-    return objsLen - 1;
+void indexObject(struct handle h, struct object obj) {
+    spatialGridInsert(&objGrid, h.index, obj.y, obj.x);
+    clusterAdd(&clusters, obj.y, obj.x);
+    minimapAdd(&minimap, obj.y, obj.x);
+    if (obj.radius > maxObjectRadius)
+        maxObjectRadius = obj.radius;
+    layoutStale  = TRUE;
+    layoutEdited = TRUE;
+    markDirty(REDRAW_SCENE);
 }
 
 /**
- * Adds a connection to the connections array and returns its index.
+ * Adds an object to the object store and returns its handle.
  */
-int addConnection(struct connection newCon) {
-    cons[consLen] = newCon;
-    consLen++;
-    return consLen - 1;
+struct handle addObject(struct object newObj) {
+    struct handle h = objectStoreAdd(&objs, newObj);
+
+    indexObject(h, newObj);
+    journalAdd(&autosave, h, newObj);
+    return h;
 }
 
 /**
- * Creates an edge between two nodes and returns its index.
+ * Adds a connection to the connection store and returns its handle.
  */
-int createConnection(struct object * src, struct object * dest) {
+struct handle addConnection(struct connection newCon) {
+    struct handle h = connectionStoreAdd(&cons, newCon);
+
+    adjacencyAdd(&adjacency, &cons, h);
+    journalConnect(&autosave, newCon);
+    layoutStale  = TRUE;
+    layoutEdited = TRUE;
+    markDirty(REDRAW_SCENE);
+    return h;
+}
+
+/**
+ * Returns the label of the object behind a handle, or "null" if it is gone.
+ */
+const char * objectLabel(struct handle h) {
+    uint32_t i = objectStoreDense(&objs, h);
+
+    return i == STORE_NONE ? "null" : OBJECT_FIELD(&objs, label, i);
+}
+
+/**
+ * Gives an object a new label.
+ */
+void relabelObject(struct handle h, const char * label) {
+    uint32_t i = objectStoreDense(&objs, h);
+
+    if (i == STORE_NONE)
+        return;
+
+    OBJECT_FIELD(&objs, label, i) = stringArenaIntern(&labelStrings, label);
+    journalRelabel(&autosave, h, label);
+    markDirty(REDRAW_SCENE);
+}
+
+/**
+ * Creates an edge between two nodes and returns its handle.
+ */
+struct handle createConnection(struct handle src, struct handle dest) {
+    uint32_t s = objectStoreDense(&objs, src);
+    uint32_t d = objectStoreDense(&objs, dest);
+
+    if (s == STORE_NONE || d == STORE_NONE)
+        return NULL_HANDLE;
+
     fprintf(
         stderr,
         "Creating a connection between %s at (%d,%d) and %s at (%d,%d)\n",
-        connectionSource->label, connectionSource->y, connectionSource->y,
-        connectionDestination->label, connectionDestination->y,
-        connectionDestination->y
+        OBJECT_FIELD(&objs, label, s), OBJECT_FIELD(&objs, y, s),
+        OBJECT_FIELD(&objs, x, s),
+        OBJECT_FIELD(&objs, label, d), OBJECT_FIELD(&objs, y, d),
+        OBJECT_FIELD(&objs, x, d)
     );
     struct connection con = {
-        .label = strdup("meep"),
+        .label = stringArenaIntern(&labelStrings, "meep"),
         .width = 1,
         .color = BLACK,
         .src   = src,
         .dest  = dest
     };
-    addConnection(con);
-    return -1;
+    return addConnection(con);
+}
+
+static void removeConnection(struct handle con, void * ctx) {
+    connectionStoreRemove(&cons, con);
+    adjacencyRemove(&adjacency);
+}
+
+/**
+ * Removes a node along with every connection touching it.
+ */
+void deleteNode(struct handle h) {
+    uint32_t i = objectStoreDense(&objs, h);
+
+    if (i == STORE_NONE)
+        return;
+
+    journalDelete(&autosave, h);
+    selectionRemove(&selection, h.index);
+    adjacencyQuery(&adjacency, &cons, h, removeConnection, NULL);
+
+    spatialGridRemove(&objGrid, h.index, OBJECT_FIELD(&objs, y, i),
+      OBJECT_FIELD(&objs, x, i));
+    clusterRemove(&clusters, OBJECT_FIELD(&objs, y, i),
+      OBJECT_FIELD(&objs, x, i));
+    minimapRemove(&minimap, OBJECT_FIELD(&objs, y, i),
+      OBJECT_FIELD(&objs, x, i));
+    objectStoreRemove(&objs, h);
+    layoutStale  = TRUE;
+    layoutEdited = TRUE;
+    markDirty(REDRAW_SCENE);
+}
+
+/**
+ * Returns 1 if zoomed out far enough that clusters are drawn instead of
+ * individual objects.
+ */
+int showingClusters() {
+    return vp.scale < CLUSTER_ZOOM;
+}
+
+/**
+ * Removes every object and connection, leaving an empty plane.
+ */
+void clearScene() {
+    if (paging)
+        pagerClear(&pager);
+    objectStoreFree(&objs);
+    connectionStoreFree(&cons);
+    stringArenaClear(&labelStrings);
+    adjacencyRebuild(&adjacency, &cons);
+    spatialGridClear(&objGrid);
+    clusterIndexClear(&clusters);
+    minimapClear(&minimap);
+    selectionClear(&selection);
+    maxObjectRadius = 0;
+
+    recentlyGrabbedObject = NULL_HANDLE;
+    connectionSource      = NULL_HANDLE;
+    connectionDestination = NULL_HANDLE;
+    connectionSelected    = 0;
+    pathSource            = NULL_HANDLE;
+    pathSelected          = 0;
+    pathFinderClear(&paths);
+    layoutStale           = TRUE;
+    layoutEdited          = TRUE;
+    markDirty(REDRAW_SCENE);
+}
+
+/**
+ * Rebuilds the spatial grid and clusters from the object store, after
+ * objects were added to it in bulk.
+ */
+void rebuildIndexes() {
+    spatialGridClear(&objGrid);
+    clusterIndexClear(&clusters);
+    maxObjectRadius = 0;
+
+    for (uint32_t i = 0; i < objs.len; i++) {
+        int y = OBJECT_FIELD(&objs, y, i);
+        int x = OBJECT_FIELD(&objs, x, i);
+        spatialGridInsert(&objGrid, OBJECT_FIELD(&objs, slot, i), y, x);
+        clusterAdd(&clusters, y, x);
+        if (OBJECT_FIELD(&objs, radius, i) > maxObjectRadius)
+            maxObjectRadius = OBJECT_FIELD(&objs, radius, i);
+    }
+    minimapRebuild(&minimap, &objs);
+    adjacencyRebuild(&adjacency, &cons);
+    layoutStale  = TRUE;
+    layoutEdited = TRUE;
+    markDirty(REDRAW_SCENE);
+}
+
+/**
+ * Checkpoints the autosave, unless paging.
+ */
+void checkpointScene() {
+    if (!paging)
+        journalCheckpoint(&autosave, &objs, &cons);
+}
+
+/**
+ * Keeps the spatial grid and selection to the objects in memory. Clusters
+ * and the minimap keep counting paged out objects, so zoomed out views
+ * show everything.
+ */
+static void pageEvicting(struct handle h, int y, int x, void * ctx) {
+    spatialGridRemove(&objGrid, h.index, y, x);
+    selectionRemove(&selection, h.index);
+    layoutStale = TRUE;
+    markDirty(REDRAW_SCENE);
+}
+
+static void pageRestored(struct handle h, struct object obj, void * ctx) {
+    spatialGridInsert(&objGrid, h.index, obj.y, obj.x);
+    if (obj.radius > maxObjectRadius)
+        maxObjectRadius = obj.radius;
+    layoutStale = TRUE;
+    markDirty(REDRAW_SCENE);
+}
+
+static void pageLoaded(struct handle h, int y, int x, void * ctx) {
+    clusterAdd(&clusters, y, x);
+    minimapAdd(&minimap, y, x);
+}
+
+static const struct pagerHandler pageHandler = {
+    .evicting = pageEvicting,
+    .restored = pageRestored,
+    .paged    = pageLoaded
+};
+
+/**
+ * Pages tiles in and out around the viewport.
+ */
+void updatePaging() {
+    if (!paging)
+        return;
+    pagerUpdate(&pager, &objs, &cons, &adjacency, &labelStrings,
+      &pageHandler, NULL, vp.y, vp.x, worldHeight(&vp), worldWidth(&vp),
+      monotonicSeconds());
+}
+
+void saveScene(const char * path) {
+    // Paged out tiles are written from their pages, without coming back
+    if (paging) {
+        if (pagerSaveScene(&pager, path, &objs, &cons, 0) != 0)
+            fprintf(stderr, "Could not save scene to %s\n", path);
+        else
+            fprintf(stderr, "Saved %u objects, %u of them paged out, to %s\n",
+              objs.len + pager.evicted - pager.restored,
+              pager.evicted - pager.restored, path);
+        return;
+    }
+    if (sceneSave(path, &objs, &cons, 0) != 0)
+        fprintf(stderr, "Could not save scene to %s\n", path);
+    else
+        fprintf(stderr, "Saved %u objects and %u connections to %s\n",
+          objs.len, cons.len, path);
+}
+
+/**
+ * Clears the current scene and takes over the given stores and arena in its
+ * place, leaving them empty.
+ */
+void replaceScene(struct objectStore * newObjs,
+  struct connectionStore * newCons, struct stringArena * newLabels) {
+    clearScene();
+    objectStoreFree(&objs);
+    connectionStoreFree(&cons);
+    stringArenaFree(&labelStrings);
+    objs         = *newObjs;
+    cons         = *newCons;
+    labelStrings = *newLabels;
+    objectStoreInit(newObjs);
+    connectionStoreInit(newCons);
+    stringArenaInit(newLabels);
+    rebuildIndexes();
+}
+
+/**
+ * Indexes the objects in memory after a scene was loaded into pages, which
+ * counted the paged out ones in the clusters and minimap as it went.
+ */
+static void indexResident() {
+    for (uint32_t i = 0; i < objs.len; i++) {
+        int y = OBJECT_FIELD(&objs, y, i);
+        int x = OBJECT_FIELD(&objs, x, i);
+        spatialGridInsert(&objGrid, OBJECT_FIELD(&objs, slot, i), y, x);
+        clusterAdd(&clusters, y, x);
+        minimapAdd(&minimap, y, x);
+        if (OBJECT_FIELD(&objs, radius, i) > maxObjectRadius)
+            maxObjectRadius = OBJECT_FIELD(&objs, radius, i);
+    }
+    adjacencyRebuild(&adjacency, &cons);
+    layoutStale  = TRUE;
+    layoutEdited = TRUE;
+    markDirty(REDRAW_SCENE);
+}
+
+/**
+ * Replaces the current scene with the one loaded straight into pages, so
+ * that only the tiles around the viewport are ever in memory. The file is
+ * checked before the current scene is dropped. Returns 0 on success.
+ */
+static int loadPagedScene(const char * path) {
+    double start = monotonicSeconds();
+
+    if (sceneCheck(path) != 0) {
+        fprintf(stderr, "Could not load scene from %s\n", path);
+        return -1;
+    }
+    clearScene();
+    if (pagerLoadScene(&pager, path, &objs, &cons, &labelStrings,
+      &pageHandler, NULL, vp.y, vp.x, worldHeight(&vp),
+      worldWidth(&vp)) != 0) {
+        fprintf(stderr, "Could not load scene from %s\n", path);
+        clearScene();
+        return -1;
+    }
+    indexResident();
+    fprintf(stderr, "Loaded %u objects, %u of them paged out, from %s in "
+      "%ld ms\n", objs.len + pager.evicted, pager.evicted, path,
+      (long) ((monotonicSeconds() - start) * 1000));
+    return 0;
+}
+
+/**
+ * Replaces the current scene with the one in the file at path. The file is
+ * loaded beside the current scene, which is only dropped once it loaded.
+ * Returns 0 on success.
+ */
+int loadScene(const char * path) {
+    struct objectStore     newObjs;
+    struct connectionStore newCons;
+    struct stringArena     newLabels;
+    double                 start = monotonicSeconds();
+
+    if (paging)
+        return loadPagedScene(path);
+
+    objectStoreInit(&newObjs);
+    connectionStoreInit(&newCons);
+    stringArenaInit(&newLabels);
+    if (sceneLoad(path, &newObjs, &newCons, &newLabels, NULL) != 0) {
+        fprintf(stderr, "Could not load scene from %s\n", path);
+        objectStoreFree(&newObjs);
+        connectionStoreFree(&newCons);
+        stringArenaFree(&newLabels);
+        return -1;
+    }
+    replaceScene(&newObjs, &newCons, &newLabels);
+    checkpointScene();
+    fprintf(stderr, "Loaded %u objects and %u connections from %s in %ld ms\n",
+      objs.len, cons.len, path,
+      (long) ((monotonicSeconds() - start) * 1000));
+    return 0;
 }
 
+/**
+ * Replaces the current scene with the graph in the edge list, CSV or DOT
+ * file at path. Like loadScene(), the graph is read beside the current
+ * scene, which is only dropped once it was read. Returns 0 on success.
+ */
+int importScene(const char * path) {
+    struct objectStore     newObjs;
+    struct connectionStore newCons;
+    struct stringArena     newLabels;
+    struct importStats     stats;
+    double                 start = monotonicSeconds();
+
+    objectStoreInit(&newObjs);
+    connectionStoreInit(&newCons);
+    stringArenaInit(&newLabels);
+    if (importGraph(path, importFormatFromPath(path), &newObjs, &newCons,
+      &newLabels, &stats) != 0) {
+        fprintf(stderr, "Could not import a graph from %s\n", path);
+        objectStoreFree(&newObjs);
+        connectionStoreFree(&newCons);
+        stringArenaFree(&newLabels);
+        return -1;
+    }
+    replaceScene(&newObjs, &newCons, &newLabels);
+    checkpointScene();
+    fprintf(stderr, "Imported %u nodes and %u edges from %s in %ld ms "
+      "with %d workers, %u lines skipped\n", stats.nodes, stats.edges, path,
+      (long) ((monotonicSeconds() - start) * 1000), stats.workers,
+      stats.skipped);
+    return 0;
+}
+
+/**
+ * Opens the first file dropped on the window: saved scenes are loaded and
+ * edge lists, CSV and DOT files imported as graphs. Anything else is left
+ * alone, so that dropping a stray file doesn't replace the scene with
+ * whatever the importer makes of it.
+ */
+void openDroppedFile() {
+    FilePathList files = LoadDroppedFiles();
+
+    if (files.count > 0) {
+        const char * path = files.paths[0];
+        if (IsFileExtension(path, ".cvs"))
+            loadScene(path);
+        else if (IsFileExtension(path, ".txt;.edges;.csv;.dot;.gv"))
+            importScene(path);
+        else
+            fprintf(stderr, "Not opening %s: not a scene or a graph\n", path);
+    }
+    UnloadDroppedFiles(files);
+}
+
+/**
+ * Adds a generated scene of count objects, with twice as many connections.
+ */
+void generateScene(uint32_t count) {
+    struct synthParams params = {
+        .shape       = SYNTH_UNIFORM,
+        .objects     = count,
+        .connections = count * 2,
+        .worldSize   = 200 * sqrtf(count) + 1000,
+        .seed        = time(NULL),
+        .labels      = 1
+    };
+
+    synthGenerate(&params, &objs, &cons, &labelStrings);
+}
+
+/**
+ * Writes rect of the scene to path, width pixels wide, as an SVG if path
+ * ends in .svg and a PNG otherwise. Returns 0 on success.
+ */
+int exportScene(const char * path, const struct exportRect * rect,
+  uint32_t width) {
+    struct exportStats stats;
+    double             start = monotonicSeconds();
+    int                err;
+
+    if (IsFileExtension(path, ".svg"))
+        err = exportSvg(path, &objs, &cons, paging ? &pager : NULL, rect,
+            width, &stats);
+    else
+        err = exportPng(path, &objs, &cons, paging ? &pager : NULL, rect,
+            width, &stats);
+
+    if (err != 0)
+        fprintf(stderr, "Could not export to %s\n", path);
+    else
+        fprintf(stderr, "Exported %u objects and %u connections to %s, "
+          "%ux%u in %u tiles with %d workers, in %ld ms\n", stats.objects,
+          stats.connections, path, stats.width, stats.height, stats.tiles,
+          stats.workers, (long) ((monotonicSeconds() - start) * 1000));
+    return err;
+}
+
+/**
+ * Exports the selected objects with a margin around them, or the whole
+ * scene if nothing is selected, to EXPORT_PNG_PATH and EXPORT_SVG_PATH.
+ */
+void exportSelection() {
+    struct exportRect rect;
+
+    // Paged out tiles are read from their pages, without coming back
+    exportSceneBounds(&objs, paging ? &pager : NULL, &rect);
+    if (selection.len > 0) {
+        float minY = INFINITY, minX = INFINITY;
+        float maxY = -INFINITY, maxX = -INFINITY;
+        for (uint32_t s = 0; s < selection.len; s++) {
+            uint32_t i = objs.slots.dense[selection.slots[s]];
+            float    r = OBJECT_FIELD(&objs, radius, i);
+            minY = fminf(minY, OBJECT_FIELD(&objs, y, i) - r);
+            minX = fminf(minX, OBJECT_FIELD(&objs, x, i) - r);
+            maxY = fmaxf(maxY, OBJECT_FIELD(&objs, y, i) + r);
+            maxX = fmaxf(maxX, OBJECT_FIELD(&objs, x, i) + r);
+        }
+        rect.y = minY - EXPORT_MARGIN;
+        rect.x = minX - EXPORT_MARGIN;
+        rect.h = maxY - minY + 2 * EXPORT_MARGIN;
+        rect.w = maxX - minX + 2 * EXPORT_MARGIN;
+    }
+
+    exportScene(EXPORT_PNG_PATH, &rect, EXPORT_WIDTH);
+    exportScene(EXPORT_SVG_PATH, &rect, EXPORT_WIDTH);
+}
+
+/**
+ * Batch mode for machines without a GPU: writes the scene given with
+ * --load, --import or --synthetic to path without ever opening a window.
+ * region is "Y,X,H,W" in world units, or NULL for the whole scene. Returns
+ * the exit status.
+ */
+int exportHeadless(const char * path, uint32_t width, const char * region) {
+    struct exportRect  rect;
+    struct importStats stats;
+    int                err = 0;
+
+    objectStoreInit(&objs);
+    connectionStoreInit(&cons);
+    stringArenaInit(&labelStrings);
+    if (startLoadPath != NULL)
+        err = sceneLoad(startLoadPath, &objs, &cons, &labelStrings, NULL);
+    else if (startImportPath != NULL)
+        err = importGraph(startImportPath,
+            importFormatFromPath(startImportPath), &objs, &cons,
+            &labelStrings, &stats);
+    else if (startSynthObjects > 0)
+        generateScene(startSynthObjects);
+    if (err != 0) {
+        fprintf(stderr, "Could not read the scene to export\n");
+        return 1;
+    }
+
+    exportSceneBounds(&objs, NULL, &rect);
+    if (region != NULL && sscanf(region, "%f,%f,%f,%f", &rect.y, &rect.x,
+      &rect.h, &rect.w) != 4) {
+        fprintf(stderr, "--export-region takes Y,X,H,W\n");
+        return 1;
+    }
+    err = exportScene(path, &rect, width);
+
+    objectStoreFree(&objs);
+    connectionStoreFree(&cons);
+    stringArenaFree(&labelStrings);
+    return err != 0;
+} /* exportHeadless */
+
 /**
  * Determines if the mouse is colliding with an object.
  * Sets the recentlyGrabbedObject as a side effect if it is.
  */
 int collidingWithPoint() {
-    int my = GetMouseY();
-    int mx = GetMouseX();
-
-    // Object y, x
-    int oy;
-    int ox;
-
-    // y and x distance
-    int yDelta;
-    int xDelta;
-    int distance;
-
-    for (int i = 0; i < objsLen; i++) {
-        // Adjust object coordinates for viewport
-        oy     = vp.h - clampProjectY(&vp, objs[i].y, 0);
-        ox     = clampProjectX(&vp, objs[i].x, 0);
-        yDelta = abs(oy - my);
-        xDelta = abs(ox - mx);
-
-        // Calculate straight line distance with pythagorean theorem:
-        // Is it less than the radius of the object?
-        distance = sqrt((yDelta * yDelta) + (xDelta * xDelta));
-
-        // Check if within that distance allowing a certain margin of error
-        if (distance < (objs[i].radius + COLLISION_MARGIN_PX)) {
-            recentlyGrabbedObject = &objs[i];
-            return TRUE;
-        }
+    // Individual objects aren't on screen to be grabbed
+    if (showingClusters())
+        return FALSE;
+
+    struct handle hit = pickObject(&objGrid, &objs,
+        unprojectY(&vp, GetMouseY()), unprojectX(&vp, GetMouseX()),
+        COLLISION_MARGIN_PX / vp.scale, maxObjectRadius);
+
+    if (hit.index != STORE_NONE) {
+        recentlyGrabbedObject = hit;
+        return TRUE;
     }
 
     return FALSE;
-} /* collidingWithPoint */
+}
 
 /******************************************************************************
  * Input Handling Functions
  *****************************************************************************/
+/**
+ * Returns 1 if the mouse is over the minimap, and sets v and u to where on
+ * it as fractions of its height and width.
+ */
+int mouseOnMinimap(float * v, float * u) {
+    int top  = vp.h - MINIMAP_SIZE - MINIMAP_MARGIN;
+    int left = vp.w - MINIMAP_SIZE - MINIMAP_MARGIN;
+
+    *v = (GetMouseY() - top) / (float) MINIMAP_SIZE;
+    *u = (GetMouseX() - left) / (float) MINIMAP_SIZE;
+    return *v >= 0 && *v < 1 && *u >= 0 && *u < 1;
+}
+
+/**
+ * Centres the viewport on the world position the mouse points at on the
+ * minimap, or the nearest one on it if the mouse has left it.
+ */
+void panToMinimap() {
+    float v, u;
+    int   y, x;
+
+    mouseOnMinimap(&v, &u);
+    minimapToWorld(&minimap, fminf(fmaxf(v, 0), 1), fminf(fmaxf(u, 0), 1),
+      &y, &x);
+    y -= worldHeight(&vp) / 2;
+    x -= worldWidth(&vp) / 2;
+    if (y != vp.y || x != vp.x) {
+        vp.y = y;
+        vp.x = x;
+        markDirty(REDRAW_SCENE);
+    }
+}
+
 void setDragPoint(int hittingPoint) {
-    if (hittingPoint)
+    int   shift = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
+    int   ctrl  = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+    float v, u;
+
+    if (mouseOnMinimap(&v, &u)) {
+        ds = MINIMAP;
+    } else if (hittingPoint && selectionContains(&selection,
+      recentlyGrabbedObject.index)) {
+        ds = GROUP;
+    } else if (hittingPoint) {
         ds = OBJECT;
-    else
+    } else if (shift || ctrl) {
+        // A new box or lasso replaces the selection
+        ds           = SELECTING;
+        lassoing     = ctrl;
+        lassoLen     = 0;
+        selectFrom.y = unprojectY(&vp, GetMouseY());
+        selectFrom.x = unprojectX(&vp, GetMouseX());
+        selectionClear(&selection);
+    } else {
         ds = VIEWPORT;
+    }
+    dragMoved      = FALSE;
     mouseDragPoint = GetMousePosition();
 }
 
@@ -259,37 +870,185 @@ void setDragFromPoint() {
             dragViewportFrom.y = vp.y;
             dragViewportFrom.x = vp.x;
             break;
-        case OBJECT:
-            dragObjectFrom.y = recentlyGrabbedObject->y;
-            dragObjectFrom.x = recentlyGrabbedObject->x;
+        case OBJECT: {
+            uint32_t i = objectStoreDense(&objs, recentlyGrabbedObject);
+            dragObjectFrom.y = OBJECT_FIELD(&objs, y, i);
+            dragObjectFrom.x = OBJECT_FIELD(&objs, x, i);
+            break;
+        }
+        case GROUP:
+            selectionBeginMove(&selection, &objs);
+            break;
+        case SELECTING:
+        case MINIMAP:
             break;
     }
 }
 
+/**
+ * Moves an object to world position (y, x), keeping the indexes in step.
+ * Also serves as the layoutSync() visitor.
+ */
+void moveObject(struct handle h, int y, int x, void * ctx) {
+    uint32_t i = objectStoreDense(&objs, h);
+
+    if (i == STORE_NONE)
+        return;
+
+    int oldY = OBJECT_FIELD(&objs, y, i);
+    int oldX = OBJECT_FIELD(&objs, x, i);
+    if (oldY == y && oldX == x)
+        return;
+
+    OBJECT_FIELD(&objs, y, i) = y;
+    OBJECT_FIELD(&objs, x, i) = x;
+    spatialGridMove(&objGrid, h.index, oldY, oldX, y, x);
+    clusterMove(&clusters, oldY, oldX, y, x);
+    minimapMove(&minimap, oldY, oldX, y, x);
+}
+
+static void replayLoaded(void * ctx) {
+    rebuildIndexes();
+}
+
+static void replayAdd(struct handle h, struct object obj, void * ctx) {
+    obj.label = stringArenaIntern(&labelStrings, obj.label);
+    if (!handleEqual(objectStoreAddAt(&objs, h, obj), NULL_HANDLE))
+        indexObject(h, obj);
+}
+
+static void replayConnect(struct connection con, void * ctx) {
+    con.label = stringArenaIntern(&labelStrings, con.label);
+    addConnection(con);
+}
+
+static void replayRelabel(struct handle h, const char * label, void * ctx) {
+    relabelObject(h, label);
+}
+
+static void replayRemove(struct handle h, void * ctx) {
+    deleteNode(h);
+}
+
+/**
+ * Loads the autosave checkpoint and replays the journal on top. Returns 0 if
+ * there was an autosave to recover.
+ */
+int recoverAutosave() {
+    struct journalHandler handler = {
+        .loaded  = replayLoaded,
+        .add     = replayAdd,
+        .move    = moveObject,
+        .connect = replayConnect,
+        .relabel = replayRelabel,
+        .remove  = replayRemove
+    };
+
+    return journalRecover(&autosave, &objs, &cons, &labelStrings, &handler,
+             NULL);
+}
+
+/**
+ * Moves an object the user is dragging. Objects the user drags stay where
+ * they are put, so the layout pins them.
+ */
+void moveDragged(struct handle h, int y, int x, int moved) {
+    moveObject(h, y, x, NULL);
+    if (layout.running && moved) {
+        if (!layoutIsPinned(&layout, h))
+            layoutPin(&layout, h, TRUE);
+        layoutMove(&layout, h, y, x);
+    }
+}
+
+void pushLassoPoint(int y, int x) {
+    if (lassoLen == lassoCap) {
+        lassoCap = lassoCap ? lassoCap * 2 : 256;
+        lasso    = realloc(lasso, lassoCap * sizeof(struct selectionPoint));
+    }
+    lasso[lassoLen++] = (struct selectionPoint) { y, x };
+}
+
+/**
+ * Selects what the box or lasso just drawn covers.
+ */
+void finishSelecting() {
+    int y = unprojectY(&vp, GetMouseY());
+    int x = unprojectX(&vp, GetMouseX());
+
+    if (lassoing) {
+        selectLasso(&selection, &objGrid, &objs, lasso, lassoLen);
+    } else {
+        selectBox(&selection, &objGrid, &objs,
+          y < selectFrom.y ? y : selectFrom.y,
+          x < selectFrom.x ? x : selectFrom.x,
+          y > selectFrom.y ? y : selectFrom.y,
+          x > selectFrom.x ? x : selectFrom.x);
+    }
+    lassoLen = 0;
+    markDirty(REDRAW_SCENE);
+}
+
 void dragObjects() {
-    lastMouseActivity = clock() / (1000);
+    lastMouseActivity = currentTime;
+
+    // Holding the button without moving changes nothing on screen
+    Vector2 delta = GetMouseDelta();
+    if (delta.x != 0 || delta.y != 0) {
+        markDirty(REDRAW_SCENE);
+        pacerMarkDrag(&pacer);
+    }
+
     switch (ds) {
         case VIEWPORT:
-            vp.x = (dragViewportFrom.x - GetMouseX() + mouseDragPoint.x);
-            vp.y = (dragViewportFrom.y - GetMouseY() + mouseDragPoint.y);
+            vp.x = dragViewportFrom.x -
+              (GetMouseX() - mouseDragPoint.x) / vp.scale;
+            vp.y = dragViewportFrom.y -
+              (GetMouseY() - mouseDragPoint.y) / vp.scale;
             break;
-        case OBJECT:
-            recentlyGrabbedObject->x =
-              (dragObjectFrom.x + GetMouseX() - mouseDragPoint.x);
-            recentlyGrabbedObject->y =
-              (dragObjectFrom.y + GetMouseY() - mouseDragPoint.y);
+        case OBJECT: {
+            int y = dragObjectFrom.y +
+              (GetMouseY() - mouseDragPoint.y) / vp.scale;
+            int x = dragObjectFrom.x +
+              (GetMouseX() - mouseDragPoint.x) / vp.scale;
+            int moved = delta.x != 0 || delta.y != 0;
+            moveDragged(recentlyGrabbedObject, y, x, moved);
+            dragMoved |= moved;
+            break;
+        }
+        case GROUP: {
+            // One offset pass for the whole group, then the indexes
+            int moved = delta.x != 0 || delta.y != 0;
+            if (!moved)
+                break;
+            selectionOffset(&selection,
+              (GetMouseY() - mouseDragPoint.y) / vp.scale,
+              (GetMouseX() - mouseDragPoint.x) / vp.scale);
+            for (uint32_t i = 0; i < selection.len; i++)
+                moveDragged(objectStoreSlotHandle(&objs, selection.slots[i]),
+                  selection.y[i], selection.x[i], moved);
+            dragMoved = TRUE;
+            break;
+        }
+        case SELECTING:
+            if (lassoing && (delta.x != 0 || delta.y != 0 || lassoLen == 0))
+                pushLassoPoint(unprojectY(&vp, GetMouseY()),
+                  unprojectX(&vp, GetMouseX()));
+            break;
+        case MINIMAP:
+            panToMinimap();
             break;
     }
 }
 
 void createNode() {
-    char * label = calloc(32, sizeof(char));
+    char label[32];
 
-    asprintf(&label, "Object %d", objsLen + 1);
+    snprintf(label, sizeof(label), "Object %u", objs.len + 1);
     struct object dot = {
         .type   = DOT,
         .sticky = 0,
-        .label  = label,
+        .label  = stringArenaIntern(&labelStrings, label),
         .radius = 10,
         .color  = CLITERAL(Color) {
             10 + rand() % 245,
@@ -297,38 +1056,118 @@ void createNode() {
             10 + rand() % 245,
             255
         },
-        .y = vp.y + GetMouseY(),
-        .x = vp.x + GetMouseX(),
+        .y = unprojectY(&vp, GetMouseY()),
+        .x = unprojectX(&vp, GetMouseX()),
     };
     addObject(dot);
 }
 
 void selectNodeForConnection(int hittingPoint) {
+    // The temporary line appears or disappears
+    markDirty(REDRAW_SCENE);
     if (hittingPoint) {
         if (connectionSelected == 0) {
             connectionSource   = recentlyGrabbedObject;
             connectionSelected = 1;
         } else {
             connectionDestination = recentlyGrabbedObject;
-            if (connectionSource != NULL)
+            // Connecting two objects twice would only stack identical lines
+            if (handleEqual(adjacencyFind(&adjacency, &cons, connectionSource,
+              connectionDestination), NULL_HANDLE))
                 createConnection(connectionSource, connectionDestination);
-            connectionSource      = NULL;
-            connectionDestination = NULL;
+            connectionSource      = NULL_HANDLE;
+            connectionDestination = NULL_HANDLE;
             connectionSelected    = 0;
         }
     } else {
         // User right-clicked on empty space
-        connectionSource      = NULL;
-        connectionDestination = NULL;
+        connectionSource      = NULL_HANDLE;
+        connectionDestination = NULL_HANDLE;
         connectionSelected    = 0;
     }
 }
 
+/**
+ * Picks the ends of a route like selectNodeForConnection() picks the ends
+ * of a connection. The search runs in the background, and a new one
+ * cancels the last. Clicking empty space clears the route.
+ */
+void selectNodeForPath(int hittingPoint) {
+    markDirty(REDRAW_SCENE);
+    if (!hittingPoint) {
+        pathSource   = NULL_HANDLE;
+        pathSelected = 0;
+        pathFinderClear(&paths);
+    } else if (pathSelected == 0) {
+        pathSource   = recentlyGrabbedObject;
+        pathSelected = 1;
+    } else {
+        pathFinderStart(&paths, &objs, &cons, pathSource,
+          recentlyGrabbedObject);
+        pathSource   = NULL_HANDLE;
+        pathSelected = 0;
+    }
+}
+
 /**
  * returns if the most recent click was a double click.
  */
 int isDoubleClick() {
-    return lastMouseActivity - prevMouseActivity <= DOUBLE_CLICK_PERIOD;
+    return (lastMouseActivity - prevMouseActivity) * 1000 <= DOUBLE_CLICK_MS;
+}
+
+/**
+ * Turns the auto-layout on or off.
+ */
+void toggleLayout() {
+    if (layout.running) {
+        layoutStop(&layout);
+    } else {
+        layoutStart(&layout, &objs, &cons);
+        layoutStale  = FALSE;
+        layoutEdited = FALSE;
+    }
+    markDirty(REDRAW_SCENE);
+}
+
+/**
+ * Restarts the layout if the graph changed under it, and moves the objects
+ * to the newest positions it has published.
+ */
+void updateLayout() {
+    if (layout.running && layoutStale) {
+        layoutStart(&layout, &objs, &cons);
+        if (layoutEdited)
+            layoutReheat(&layout);
+    }
+    layoutStale  = FALSE;
+    layoutEdited = FALSE;
+
+    if (layoutSync(&layout, moveObject, NULL)) {
+        layoutUnsaved = TRUE;
+        markDirty(REDRAW_SCENE);
+    }
+
+    // In on-demand mode, stop waiting for input while the layout moves
+    // things, a route is being searched for or the journal has edits to
+    // sync, and go back to it after
+    int active = layoutActive(&layout);
+    int busy   = active || paths.state == PATH_SEARCHING
+                 || journalUnsynced(&autosave);
+    if (getRedrawMode() == REDRAW_ON_DEMAND && busy != animating) {
+        if (busy)
+            DisableEventWaiting();
+        else
+            EnableEventWaiting();
+        animating = busy;
+    }
+
+    // One checkpoint once things stop moving, instead of a journal record
+    // for every object on every step
+    if (layoutUnsaved && !active) {
+        checkpointScene();
+        layoutUnsaved = FALSE;
+    }
 }
 
 /******************************************************************************
@@ -337,23 +1176,57 @@ int isDoubleClick() {
 
 void handleInput() {
     // save if we are colliding with a point
-    // so we don't check again in one input frame
-    int hittingPoint = collidingWithPoint();
+    // so we don't check again in one input frame, leaving out objects
+    // under the minimap
+    float v, u;
+    int   hittingPoint = !mouseOnMinimap(&v, &u) && collidingWithPoint();
 
     // Set drag point when LMB is pressed
     if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
         prevMouseActivity = lastMouseActivity;
         lastMouseActivity = currentTime;
         if (isDoubleClick())
-            if (hittingPoint)
+            if (hittingPoint) {
                 overlayState ^= 1;
+                overlayObject = recentlyGrabbedObject;
+                markDirty(REDRAW_OVERLAY);
+            }
         setDragPoint(hittingPoint);
     }
 
     if (IsMouseButtonPressed(MOUSE_BUTTON_MIDDLE))
         createNode();
-    if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT))
+    int alt = IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT);
+    if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT) && alt)
+        selectNodeForPath(hittingPoint);
+    else if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT))
         selectNodeForConnection(hittingPoint);
+    if (IsKeyPressed(KEY_DELETE) && hittingPoint && overlayState == 0)
+        deleteNode(recentlyGrabbedObject);
+
+    // Ctrl+S saves the scene, Ctrl+O loads it back and Ctrl+E exports the
+    // selection, or everything, as images
+    int ctrl = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
+    if (ctrl && IsKeyPressed(KEY_S) && overlayState == 0)
+        saveScene(SCENE_PATH);
+    if (ctrl && IsKeyPressed(KEY_O) && overlayState == 0)
+        loadScene(SCENE_PATH);
+    if (ctrl && IsKeyPressed(KEY_E) && overlayState == 0)
+        exportSelection();
+
+    // Files dropped on the window replace the scene
+    if (IsFileDropped())
+        openDroppedFile();
+
+    // Ctrl+L turns the auto-layout on and off, Ctrl+P pauses and resumes
+    // it and Ctrl+T pins or unpins the object under the cursor
+    if (ctrl && IsKeyPressed(KEY_L) && overlayState == 0)
+        toggleLayout();
+    if (ctrl && IsKeyPressed(KEY_P) && layout.running)
+        layoutSetPaused(&layout, !layout.paused);
+    if (ctrl && IsKeyPressed(KEY_T) && hittingPoint && layout.running)
+        layoutPin(&layout, recentlyGrabbedObject,
+          !layoutIsPinned(&layout, recentlyGrabbedObject));
 
     // Move viewport relative to drag point while LMB is down and moving
     if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
@@ -361,9 +1234,55 @@ void handleInput() {
     if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
         dragObjects();
 
+    // A whole drag goes in the journal as one move per object, where it was
+    // dropped
+    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && ds == OBJECT && dragMoved) {
+        uint32_t i = objectStoreDense(&objs, recentlyGrabbedObject);
+        if (i != STORE_NONE)
+            journalMove(&autosave, recentlyGrabbedObject,
+              OBJECT_FIELD(&objs, y, i), OBJECT_FIELD(&objs, x, i));
+        dragMoved = FALSE;
+    }
+    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && ds == GROUP && dragMoved) {
+        for (uint32_t i = 0; i < selection.len; i++)
+            journalMove(&autosave,
+              objectStoreSlotHandle(&objs, selection.slots[i]),
+              selection.y[i], selection.x[i]);
+        dragMoved = FALSE;
+    }
+    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && ds == SELECTING) {
+        finishSelecting();
+        ds = VIEWPORT;
+    }
+
+    // Zoom around the cursor with the wheel
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0) {
+        zoomAt(&vp, powf(ZOOM_STEP, wheel), GetMouseY(), GetMouseX());
+        // Restart any drag from here so it continues at the new zoom
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+            setDragFromPoint();
+        markDirty(REDRAW_SCENE);
+    }
+
+    // The temporary connection line follows the cursor
+    Vector2 delta = GetMouseDelta();
+    if (connectionSelected == 1 && (delta.x != 0 || delta.y != 0))
+        markDirty(REDRAW_SCENE);
+
+    // Enter gives the object the label typed in and closes the input field
+    if (overlayState == 1 && IsKeyPressed(KEY_ENTER)) {
+        relabelObject(overlayObject, overlayTextInput);
+        memset(&overlayTextInput[0], 0, sizeof(overlayTextInput));
+        overlayTextIndex = 0;
+        overlayState     = 0;
+        markDirty(REDRAW_OVERLAY);
+    }
+
     // Get keys if in input field
     char ch = GetKeyPressed();
     if (overlayState == 1 && ch != 0 && isascii(ch)) {
+        markDirty(REDRAW_OVERLAY);
         // Why is the keycode for backspace 3 for me and 259 in raylib.h...?
         if (ch == KEY_BACKSPACE || ch == 3) {
             memset(&overlayTextInput[0], 0, sizeof(overlayTextInput));
@@ -384,112 +1303,247 @@ void handleInput() {
  * connection.
  */
 void drawTempLine(void) {
-    if (connectionSource != NULL && connectionDestination == NULL)
+    uint32_t i = objectStoreDense(&objs, connectionSource);
+
+    if (i != STORE_NONE && connectionSelected == 1)
         DrawLine(
-            clampProjectX(&vp, connectionSource->x, 0),
-            clampProjectY(&vp, connectionSource->y, 0),
+            clampProjectX(&vp, OBJECT_FIELD(&objs, x, i), 0),
+            clampProjectY(&vp, OBJECT_FIELD(&objs, y, i), 0),
             GetMouseX(), vp.h - GetMouseY(),
             BLACK
         );
 }
 
-void drawObjects() {
-    struct object curr;
+/**
+ * Draws the box or lasso being dragged out.
+ */
+void drawSelectionRegion(void) {
+    if (ds != SELECTING || !IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+        return;
+
+    if (lassoing) {
+        for (uint32_t i = 1; i < lassoLen; i++) {
+            Vector2 from = { projectX(&vp, lasso[i - 1].x),
+                             projectY(&vp, lasso[i - 1].y) };
+            Vector2 to = { projectX(&vp, lasso[i].x),
+                           projectY(&vp, lasso[i].y) };
+            DrawLineV(from, to, BLUE);
+        }
+        return;
+    }
 
-    for (int i = 0; i < objsLen; i++) {
-        curr = objs[i];
-        switch (curr.type) {
+    float x0 = projectX(&vp, selectFrom.x);
+    float y0 = projectY(&vp, selectFrom.y);
+    float x1 = GetMouseX();
+    float y1 = vp.h - GetMouseY();
+    DrawRectangleLines(fminf(x0, x1), fminf(y0, y1), fabsf(x1 - x0),
+      fabsf(y1 - y0), BLUE);
+}
+
+void drawObjects() {
+    // Everything here comes from the sprite atlas, so it all goes out in
+    // as few draw calls as raylib's vertex buffer allows
+    spriteBatchBegin(&sprites);
+    for (uint32_t v = 0; v < visible.objectsLen; v++) {
+        struct visibleObject curr = visible.objects[v];
+        uint32_t i = curr.dense;
+
+        switch (OBJECT_FIELD(&objs, type, i)) {
             case DOT:
-                DrawCircle(
-                    clampProjectX(&vp, curr.x, curr.sticky),
-                    clampProjectY(&vp, curr.y, curr.sticky),
-                    curr.radius * vp.scale,
-                    curr.color
-                );
+                spriteBatchCircle(&sprites, SPRITE_DISC, curr.x, curr.y,
+                  OBJECT_FIELD(&objs, radius, i) * vp.scale,
+                  OBJECT_FIELD(&objs, color, i));
                 break;
             case SPRITE:
-                // void DrawTextureEx(Texture2D texture, Vector2 position,
-                //     float rotation, float scale, Color tint);
-                Vector2 pos;
-                pos.x = clampProjectX(&vp, curr.x, curr.sticky);
-                pos.y = clampProjectY(&vp, curr.y, curr.sticky);
-                DrawTextureEx(skull, pos, 180.0, vp.scale, curr.color);
+                spriteBatchImage(&sprites, curr.x, curr.y, vp.scale,
+                  OBJECT_FIELD(&objs, color, i));
                 break;
         }
+
+        // Looked up by slot, so the selection never reorders the store
+        if (selectionContains(&selection, OBJECT_FIELD(&objs, slot, i)))
+            spriteBatchCircle(&sprites, SPRITE_RING, curr.x, curr.y,
+              OBJECT_FIELD(&objs, radius, i) * vp.scale + 4, BLUE);
     }
+    spriteBatchEnd(&sprites);
 }
 
-void drawConnections() {
-    struct connection curr;
+void collectClusterMarker(int y, int x, uint32_t count, void * ctx) {
+    if (markersLen == markersCap) {
+        markersCap = markersCap ? markersCap * 2 : 256;
+        markers    = realloc(markers, markersCap * sizeof(struct clusterMarker));
+    }
 
-    for (int i = 0; i < consLen; i++) {
-        curr = cons[i];
-        int srcVisible  = positionVisible(&vp, curr.src->y, curr.src->x);
-        int destVisible = positionVisible(&vp, curr.dest->y, curr.dest->x);
-        // Draw normally if both visible.
-        if (srcVisible || destVisible)
-            DrawLine(
-                projectX(&vp, curr.src->x),
-                projectY(&vp, curr.src->y),
-                projectX(&vp, curr.dest->x),
-                projectY(&vp, curr.dest->y),
-                BLACK
-            );
-        // Otherwise, determine the angle between the two if it were on screen..?
+    struct clusterMarker * m = &markers[markersLen++];
+    m->x     = projectX(&vp, x);
+    m->y     = projectY(&vp, y);
+    m->count = count;
+    snprintf(m->text, sizeof(m->text), "%u", count);
+}
+
+/**
+ * Gathers the clusters overlapping the viewport from the level whose cells
+ * are about CLUSTER_MIN_PX wide on screen. The number of markers depends on
+ * the screen size, not on how many objects there are.
+ */
+void buildClusterMarkers() {
+    int level = clusterLevelFor(vp.scale, CLUSTER_MIN_PX);
+    int pad   = clusters.levels[level].cellSize;
+
+    markersLen = 0;
+    clusterQuery(&clusters, level, vp.y - pad, vp.x - pad,
+      vp.y + worldHeight(&vp) + pad, vp.x + worldWidth(&vp) + pad,
+      collectClusterMarker, NULL);
+}
+
+void drawClusters() {
+    spriteBatchBegin(&sprites);
+    for (uint32_t i = 0; i < markersLen; i++) {
+        // Grow slowly with the count so big clusters don't cover the screen
+        float radius = 6 + 3 * log2f(markers[i].count);
+        spriteBatchCircle(&sprites, SPRITE_DISC, markers[i].x, markers[i].y,
+          radius, CLITERAL(Color) { 60, 110, 200, 200 });
     }
+    spriteBatchEnd(&sprites);
 }
 
-void drawLabels() {
-    struct object curr;
+void drawConnections() {
+    if (visible.connectionsLen > EDGE_DENSITY_LIMIT) {
+        edgeDensityBuild(&density, visible.connections, visible.connectionsLen,
+          BLACK);
+        UpdateTexture(densityTexture, density.pixels);
+        DrawTexturePro(densityTexture,
+          CLITERAL(Rectangle) { 0, 0, density.w, density.h },
+          CLITERAL(Rectangle) { 0, 0, vp.w, vp.h },
+          CLITERAL(Vector2) { 0, 0 }, 0, WHITE);
+        return;
+    }
 
-    for (int i = 0; i < objsLen; i++) {
-        curr = objs[i];
-        DrawText(
-            curr.label,
-            clampProjectX(&vp, curr.x,
-            curr.sticky) + (vp.scale * curr.radius) + 5,
-            vp.h - (clampProjectY(&vp, curr.y,
-            curr.sticky) + (vp.scale * curr.radius) + 5),
-            20,
+    for (uint32_t v = 0; v < visible.connectionsLen; v++) {
+        struct visibleConnection curr = visible.connections[v];
+        // Already clipped to the viewport by the culling pass
+        DrawLineV(
+            CLITERAL(Vector2) { curr.x0, curr.y0 },
+            CLITERAL(Vector2) { curr.x1, curr.y1 },
             BLACK
         );
     }
 }
 
-void drawGridlines() {
-    int offsetX = vp.x % MINOR_GRIDLINE_DISTANCE - MINOR_GRID_SEG_LENGTH;
-    int offsetY = vp.y % MINOR_GRIDLINE_DISTANCE - MINOR_GRID_SEG_LENGTH;
-
-    const int shade = 190;
-    const int dist  = MINOR_GRIDLINE_DISTANCE * vp.scale;
-
-    // Vertical lines
-    for (int i = 0; i < vp.w / 10; i++)
-        drawDottedLine(
-            i * dist - offsetX,
-            0,
-            i * dist - offsetX,
-            vp.h,
-            CLITERAL(Color) {
-            shade, shade, shade, 255
-        },
-            MINOR_GRID_SEG_LENGTH
-        );
+/**
+ * Draws the minimap over the corner of the scene, with the viewport's
+ * outline on it. The texture is only uploaded when objects changed, so a
+ * frame without changes costs two rectangles and a quad.
+ */
+void drawMinimap() {
+    int top  = vp.h - MINIMAP_SIZE - MINIMAP_MARGIN;
+    int left = vp.w - MINIMAP_SIZE - MINIMAP_MARGIN;
+
+    if (minimapTakeDirty(&minimap))
+        UpdateTexture(minimapTexture, minimap.pixels);
+
+    DrawRectangle(left - 1, top - 1, MINIMAP_SIZE + 2, MINIMAP_SIZE + 2,
+      GRAY);
+    DrawRectangle(left, top, MINIMAP_SIZE, MINIMAP_SIZE, WHITE);
+    DrawTexture(minimapTexture, left, top, WHITE);
+
+    // Clamped to the minimap, and never less than a couple of pixels so
+    // that it can be found when zoomed in
+    float v0, u0, v1, u1;
+    minimapFromWorld(&minimap, vp.y, vp.x, &v0, &u0);
+    minimapFromWorld(&minimap, vp.y + worldHeight(&vp),
+      vp.x + worldWidth(&vp), &v1, &u1);
+    v0 = fminf(fmaxf(v0, 0), 1) * MINIMAP_SIZE;
+    u0 = fminf(fmaxf(u0, 0), 1) * MINIMAP_SIZE;
+    v1 = fminf(fmaxf(v1, 0), 1) * MINIMAP_SIZE;
+    u1 = fminf(fmaxf(u1, 0), 1) * MINIMAP_SIZE;
+    DrawRectangleLines(left + u0, top + v0, fmaxf(u1 - u0, 2),
+      fmaxf(v1 - v0, 2), RED);
+}
 
-    // FIXME: why do the horizontal lines appear to slide around
-    // Horizontal lines
-    for (int i = 0; i < vp.h / 10; i++)
-        drawDottedLine(
-            0,
-            i * dist + offsetY,
-            vp.w,
-            i * dist + offsetY,
-            CLITERAL(Color) {
-            shade, shade, shade, 255
-        },
-            MINOR_GRID_SEG_LENGTH
+/**
+ * Draws the last route found over the connections, along with a ring
+ * around the object picked as the start of the next one.
+ */
+void drawRoute() {
+    Vector2 prev;
+    int     hasPrev = FALSE;
+
+    for (uint32_t r = 0; r < paths.routeLen; r++) {
+        uint32_t i = objectStoreDense(&objs, paths.route[r]);
+        if (i == STORE_NONE) {
+            // Deleted or paged out since; the route has a gap there
+            hasPrev = FALSE;
+            continue;
+        }
+
+        Vector2 at = { projectX(&vp, OBJECT_FIELD(&objs, x, i)),
+                       projectY(&vp, OBJECT_FIELD(&objs, y, i)) };
+        if (hasPrev)
+            DrawLineEx(prev, at, 4, ORANGE);
+        prev    = at;
+        hasPrev = TRUE;
+    }
+
+    spriteBatchBegin(&sprites);
+    for (uint32_t r = 0; r < paths.routeLen; r++) {
+        uint32_t i = objectStoreDense(&objs, paths.route[r]);
+        if (i != STORE_NONE)
+            spriteBatchCircle(&sprites, SPRITE_RING,
+              projectX(&vp, OBJECT_FIELD(&objs, x, i)),
+              projectY(&vp, OBJECT_FIELD(&objs, y, i)),
+              OBJECT_FIELD(&objs, radius, i) * vp.scale + 4, ORANGE);
+    }
+
+    uint32_t i = objectStoreDense(&objs, pathSource);
+    if (pathSelected && i != STORE_NONE)
+        spriteBatchCircle(&sprites, SPRITE_RING,
+          projectX(&vp, OBJECT_FIELD(&objs, x, i)),
+          projectY(&vp, OBJECT_FIELD(&objs, y, i)),
+          OBJECT_FIELD(&objs, radius, i) * vp.scale + 4, ORANGE);
+    spriteBatchEnd(&sprites);
+}
+
+/**
+ * Decides which labels get drawn and where. Only needs redoing when the
+ * scene changes, since the placement is kept until then.
+ */
+void layoutLabels() {
+    // Labels shrink along with everything else when zoomed out, until
+    // they're too small to read and get dropped
+    float size = LABEL_FONT_SIZE * (vp.scale < 1 ? vp.scale : 1);
+
+    labelCacheBeginLayout(&labels, vp.w, vp.h);
+
+    // Zoomed out, the only labels are the cluster counts
+    if (showingClusters()) {
+        for (uint32_t i = 0; i < markersLen; i++)
+            labelCachePlace(&labels, markers[i].text, markers[i].x + 4,
+              vp.h - markers[i].y - LABEL_FONT_SIZE / 2, LABEL_FONT_SIZE);
+        return;
+    }
+
+    for (uint32_t v = 0; v < visible.objectsLen; v++) {
+        struct visibleObject curr = visible.objects[v];
+        int radius = OBJECT_FIELD(&objs, radius, curr.dense);
+
+        labelCachePlace(
+            &labels,
+            OBJECT_FIELD(&objs, label, curr.dense),
+            curr.x + (vp.scale * radius) + 5,
+            vp.h - (curr.y + (vp.scale * radius) + 5),
+            size
         );
-} /* drawGridlines */
+    }
+}
+
+void drawLabels() {
+    labelCacheDraw(&labels, BLACK);
+}
+
+void drawGridlines() {
+    gridRendererDraw(&gridlines, &vp);
+}
 
 void drawOverlay() {
     DrawRectangle(0, 0, vp.w, vp.h, CLITERAL(Color) {
@@ -505,7 +1559,8 @@ void drawOverlay() {
 
 void printDebugInfo() {
     DrawText(
-        TextFormat("vp: (%d, %d); %d objects", vp.y, vp.x, objsLen),
+        TextFormat("vp: (%d, %d) x%.2f; %u objects; %u labels, %u hidden",
+        vp.y, vp.x, vp.scale, objs.len, labels.placedLen, labels.suppressed),
         0, 20, 20, BLACK
     );
 
@@ -516,19 +1571,19 @@ void printDebugInfo() {
 
     DrawText(
         TextFormat(
-            "mouse prev moving: %d, last: %d, curr time: %d",
+            "mouse prev moving: %.3f, last: %.3f, curr time: %.3f",
             prevMouseActivity, lastMouseActivity, currentTime
         ),
         0, 60, 20, BLACK
     );
 
+    uint32_t grabbed = objectStoreDense(&objs, recentlyGrabbedObject);
     DrawText(
         TextFormat(
             "Object last touched: %s at y,x (%d,%d)",
-            recentlyGrabbedObject ==
-            NULL ? "null" : (*recentlyGrabbedObject).label,
-            recentlyGrabbedObject == NULL ? -1 : (*recentlyGrabbedObject).y,
-            recentlyGrabbedObject == NULL ? -1 : (*recentlyGrabbedObject).x
+            objectLabel(recentlyGrabbedObject),
+            grabbed == STORE_NONE ? -1 : OBJECT_FIELD(&objs, y, grabbed),
+            grabbed == STORE_NONE ? -1 : OBJECT_FIELD(&objs, x, grabbed)
         ),
         0, 80, 20, BLACK
     );
@@ -537,48 +1592,217 @@ void printDebugInfo() {
         TextFormat(
             "Picking: %d Src: %s Dest: %s",
             connectionSelected,
-            connectionSource == NULL ? "null" : connectionSource->label,
-            connectionDestination ==
-            NULL ? "null" : connectionDestination->label
+            objectLabel(connectionSource),
+            objectLabel(connectionDestination)
         ),
         0, 100, 20, BLACK
     );
+
+    DrawText(
+        TextFormat(
+            "Layout: %s; %u selected",
+            !layout.running ? "off" : layout.paused ? "paused" :
+            layoutActive(&layout) ? "running" : "settled",
+            selection.len
+        ),
+        0, 120, 20, BLACK
+    );
+
+    DrawText(
+        TextFormat(
+            "Edges: %u %s, %u under a pixel",
+            visible.connectionsLen,
+            visible.connectionsLen > EDGE_DENSITY_LIMIT ?
+            TextFormat("as density (1 in %u)", density.stride) : "drawn",
+            visible.connectionsElided
+        ),
+        0, 140, 20, BLACK
+    );
+
+    if (paging)
+        DrawText(
+            TextFormat("Pages: %u tiles out; %u objects out, %u in",
+              pager.pagedLen, pager.evicted, pager.restored),
+            0, 160, 20, BLACK
+        );
+
+    const char * route = "none";
+    if (paths.state == PATH_SEARCHING)
+        route = "searching";
+    else if (paths.state == PATH_FOUND)
+        route = TextFormat("%u objects, %.0f long", paths.routeLen,
+            paths.length);
+    else if (paths.state == PATH_NOT_FOUND)
+        route = "not connected";
+    if (paths.state == PATH_FOUND || paths.state == PATH_NOT_FOUND)
+        route = TextFormat("%s; %u expanded in %.1f ms", route,
+            paths.expanded, paths.seconds * 1000);
+    DrawText(TextFormat("Route: %s", route), 0, 180, 20, BLACK);
+
+    struct pacerLatency latency;
+    pacerLatencyStats(&pacer, &latency);
+    DrawText(
+        TextFormat(
+            "Pacing: %d FPS for %.1f ms frames; drag latency %.1f avg, "
+            "%.1f p99, %.1f max ms",
+            pacerRate(&pacer), pacerCost(&pacer), latency.avg, latency.p99,
+            latency.max
+        ),
+        0, 200, 20, BLACK
+    );
 } /* printDebugInfo */
 
+/**
+ * Bar graph of where the frame time goes, in the top right corner. Bars are
+ * the rolling average of each phase, with a tick at the 99th percentile, and
+ * the full width is a 60 FPS frame budget.
+ */
+void drawProfiler() {
+    int left = vp.w - PROFILE_BAR_WIDTH - 230;
+
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        struct phaseStats stats;
+        profilerStats(p, &stats);
+
+        int y    = 20 + p * 14;
+        int avgW = fminf(stats.avg / PROFILE_BUDGET_MS, 1) * PROFILE_BAR_WIDTH;
+        int p99X = fminf(stats.p99 / PROFILE_BUDGET_MS, 1) * PROFILE_BAR_WIDTH;
+
+        DrawText(profilerPhaseName(p), left, y, 10, BLACK);
+        DrawRectangleLines(left + 70, y, PROFILE_BAR_WIDTH, 10, LIGHTGRAY);
+        DrawRectangle(left + 70, y, avgW, 10,
+          stats.p99 > PROFILE_BUDGET_MS ? RED : DARKGREEN);
+        DrawLine(left + 70 + p99X, y - 1, left + 70 + p99X, y + 11, BLACK);
+        DrawText(TextFormat("%.2f/%.2f/%.2f", stats.min, stats.avg, stats.p99),
+          left + 80 + PROFILE_BAR_WIDTH, y, 10, BLACK);
+    }
+}
+
 /*****************************************************************************
 * Game Loop
 *****************************************************************************/
 
+/**
+ * Sets up the scene to start with: the one given with --load, --import or
+ * --synthetic, or else whatever was autosaved last time. A --load or
+ * --import file that can't be read falls back to the autosave.
+ */
+void startScene() {
+    char autosavePath[256];
+
+    storagePath(autosavePath, sizeof(autosavePath), AUTOSAVE_NAME);
+    journalInit(&autosave, autosavePath);
+
+    if (startLoadPath != NULL && loadScene(startLoadPath) == 0) {
+        // Loaded and checkpointed
+    } else if (startImportPath != NULL && importScene(startImportPath) == 0) {
+        // Imported and checkpointed
+    } else if (!paging && startSynthObjects == 0 && recoverAutosave() == 0) {
+        fprintf(stderr, "Recovered %u objects and %u connections from %s\n",
+          objs.len, cons.len, autosavePath);
+    } else {
+        struct object skullObj = {
+            .type   = SPRITE,
+            .sticky = 0,
+            .label  = stringArenaIntern(&labelStrings, "Evil skull"),
+            .color  = BLACK,
+            .y      = 200,
+            .x      = 300
+        };
+        addObject(skullObj);
+
+        // --synthetic N adds a generated scene of N objects to play around in
+        if (startSynthObjects > 0) {
+            generateScene(startSynthObjects);
+            rebuildIndexes();
+        }
+        checkpointScene();
+    }
+
+    #ifdef __EMSCRIPTEN__
+        const char * text = "Some dynamic file contents...\n";
+        storagePut("file.txt", text, strlen(text));
+    #endif
+    sceneStarted = TRUE;
+}
+
 void gameLoop() {
-    currentTime = clock() / (1000);
-    mouseMoving = currentTime - lastMouseActivity < MOUSE_ACTIVE_CLOCK_TICKS;
+    if (!sceneStarted) {
+        if (!storageReady()) {
+            BeginDrawing();
+            ClearBackground(WHITE);
+            DrawText("Loading...", 10, 10, 20, BLACK);
+            EndDrawing();
+            return;
+        }
+        startScene();
+    }
 
-    handleInput();
+    profilerBegin(PHASE_FRAME);
+    currentTime = monotonicSeconds();
+    pacerBeginFrame(&pacer, currentTime);
+    mouseMoving = (currentTime - lastMouseActivity) * 1000 < MOUSE_ACTIVE_MS;
+
+    PROFILE(PHASE_INPUT) {
+        handleInput();
+        updateLayout();
+        updatePaging();
+        if (pathFinderPoll(&paths))
+            markDirty(REDRAW_SCENE);
+        journalTick(&autosave, &objs, &cons, monotonicSeconds());
+        storageTick(monotonicSeconds());
+    }
 
-    // Drawing to render texture
+    // Drawing to render texture, only if something on it changed
     BeginDrawing();
-    BeginTextureMode(rt);
-    ClearBackground(CLITERAL(Color) {
-        255, 255, 255, 255
-    });
-    drawGridlines();
-    drawConnections();
-    drawObjects();
-    drawTempLine();
-    if (overlayState)
-        drawOverlay();
-    EndTextureMode();
-    DrawTexture(rt.texture, 0, 0, CLITERAL(Color) {
-        255, 255, 255, 255
-    });
+    if (isDirty(REDRAW_ALL)) {
+        PROFILE(PHASE_CULL) {
+            if (showingClusters()) {
+                // Skip the per-object passes entirely
+                visible.objectsLen     = 0;
+                visible.connectionsLen = 0;
+                buildClusterMarkers();
+            } else {
+                markersLen = 0;
+                buildVisibleSet(&visible, &vp, &objs, &cons,
+                  (sprites.imageWidth > sprites.imageHeight ?
+                  sprites.imageWidth : sprites.imageHeight) * vp.scale);
+            }
+        }
+        BeginTextureMode(rt);
+        ClearBackground(CLITERAL(Color) {
+            255, 255, 255, 255
+        });
+        PROFILE(PHASE_GRIDLINES) drawGridlines();
+        PROFILE(PHASE_CONNECTIONS) drawConnections();
+        PROFILE(PHASE_OBJECTS) {
+            drawObjects();
+            drawClusters();
+        }
+        drawRoute();
+        drawTempLine();
+        drawSelectionRegion();
+        if (overlayState)
+            drawOverlay();
+        EndTextureMode();
+        PROFILE(PHASE_LABELS) layoutLabels();
+        clearDirty();
+    }
+    PROFILE(PHASE_BLIT) {
+        DrawTexture(rt.texture, 0, 0, CLITERAL(Color) {
+            255, 255, 255, 255
+        });
+    }
+    drawMinimap();
     DrawFPS(0, 0);
     #ifdef __EMSCRIPTEN__
-        char * text = idbfs_get("file.txt");
-        DrawText(TextFormat("Dynamic file content: %s", text), 0, 30, 20,
-          WHITE);
+        // Served from the storage cache, not read from the file every frame
+        DrawText(TextFormat("Dynamic file content: %s",
+          storageGet("file.txt")), 0, 30, 20, WHITE);
     #endif
     printDebugInfo();
-    drawLabels();
+    drawProfiler();
+    PROFILE(PHASE_LABELS) drawLabels();
 
     if (overlayState)
         DrawText(
@@ -589,6 +1813,12 @@ void gameLoop() {
         );
     if (mouseMoving)
         DrawText("Mouse moving", 300, 20, 20, BLUE);
+
+    // Stop before EndDrawing(), which can block on vsync or for input
+    profilerEnd(PHASE_FRAME);
+    profilerEndFrame();
+    if (pacerEndFrame(&pacer, monotonicSeconds()))
+        SetTargetFPS(pacerRate(&pacer));
     EndDrawing();
 } /* gameLoop */
 
@@ -596,10 +1826,47 @@ void gameLoop() {
 * Main Function (Point of Entry)
 *****************************************************************************/
 
-int main() {
+int main(int argc, char ** argv) {
     int screenWidth  = 960;
     int screenHeight = 480;
 
+    // --always redraws every frame; the default only redraws on change
+    const char * profilePath  = NULL;
+    const char * exportPath   = NULL;
+    const char * exportRegion = NULL;
+    uint32_t     exportWidth  = EXPORT_WIDTH;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--always") == 0)
+            setRedrawMode(REDRAW_ALWAYS);
+        else if (strcmp(argv[i], "--on-demand") == 0)
+            setRedrawMode(REDRAW_ON_DEMAND);
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+            startLoadPath = argv[++i];
+        else if (strcmp(argv[i], "--import") == 0 && i + 1 < argc)
+            startImportPath = argv[++i];
+        else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc)
+            startSynthObjects = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc)
+            profilePath = argv[++i];
+        else if (strcmp(argv[i], "--paged") == 0)
+            paging = TRUE;
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc)
+            exportPath = argv[++i];
+        else if (strcmp(argv[i], "--export-width") == 0 && i + 1 < argc)
+            exportWidth = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--export-region") == 0 && i + 1 < argc)
+            exportRegion = argv[++i];
+    }
+
+    // --export PATH [--export-width N] [--export-region Y,X,H,W] writes the
+    // scene to PATH and exits
+    if (exportPath != NULL)
+        return exportHeadless(exportPath, exportWidth, exportRegion);
+
+    // --profile-csv PATH writes every frame's phase times to PATH
+    if (profilePath != NULL && profilerOpenCsv(profilePath) != 0)
+        fprintf(stderr, "Could not open %s for writing\n", profilePath);
+
     vp.y     = 500;
     vp.x     = 500;
     vp.w     = screenWidth;
@@ -612,34 +1879,55 @@ int main() {
     overlayTextInput[MAX_LABEL_LENGTH] = 0;
 
     InitWindow(screenWidth, screenHeight, "rtextures");
-    SetTargetFPS(144);
-    rt    = LoadRenderTexture(screenWidth, screenHeight);
-    skull = LoadTexture("resources/skull-wenrexa.png");
+    pacerInit(&pacer, MAX_FPS);
+    SetTargetFPS(pacerRate(&pacer));
+
+    // Block in EndDrawing() until there is input instead of spinning
+    if (getRedrawMode() == REDRAW_ON_DEMAND)
+        EnableEventWaiting();
+    rt = LoadRenderTexture(screenWidth, screenHeight);
+    spriteBatchInit(&sprites, "resources/skull-wenrexa.png");
+
+    edgeDensityInit(&density, screenWidth, screenHeight, EDGE_DENSITY_SHIFT);
+    Image blank = GenImageColor(density.w, density.h, BLANK);
+    densityTexture = LoadTextureFromImage(blank);
+    SetTextureFilter(densityTexture, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(blank);
+    blank          = GenImageColor(MINIMAP_CELLS, MINIMAP_CELLS, BLANK);
+    minimapTexture = LoadTextureFromImage(blank);
+    UnloadImage(blank);
+    labelCacheInit(&labels, LABEL_ATLAS_SIZE, LABEL_FONT_SIZE);
 
     srand(time(NULL));
+    objectStoreInit(&objs);
+    connectionStoreInit(&cons);
+    stringArenaInit(&labelStrings);
+    adjacencyInit(&adjacency);
+    layoutInit(&layout);
+    recentlyGrabbedObject = NULL_HANDLE;
+    overlayObject         = NULL_HANDLE;
+    pathSource            = NULL_HANDLE;
+    pathFinderInit(&paths);
+    connectionSource      = NULL_HANDLE;
+    connectionDestination = NULL_HANDLE;
+    spatialGridInit(&objGrid, MINOR_GRIDLINE_DISTANCE, GRID_BUCKETS);
+    visibleSetInit(&visible);
+    selectionInit(&selection);
+    clusterIndexInit(&clusters);
+    minimapInit(&minimap);
+    if (paging && pagerInit(&pager, PAGE_DIR, PAGE_TILE_SIZE) != 0) {
+        fprintf(stderr, "Could not create %s, not paging\n", PAGE_DIR);
+        paging = FALSE;
+    }
+    gridRendererInit(&gridlines, MINOR_GRIDLINE_DISTANCE,
+      MINOR_GRID_SEG_LENGTH, CLITERAL(Color) {
+        190, 190, 190, 255
+    });
 
-    struct object skullObj = {
-        .type   = SPRITE,
-        .sticky = 0,
-        .label  = strdup("Evil skull"),
-        .color  = BLACK,
-        .y      = 200,
-        .x      = 300
-    };
-    addObject(skullObj);
+    // The scene starts from the first frame where storage is ready
+    storageInit();
 
     #ifdef __EMSCRIPTEN__
-        EM_ASM(
-            FS.mkdir('/work');
-            FS.mount(IDBFS, { }, '/work');
-            FS.syncfs(true, function(err) {
-        assert(!err);
-    });
-        );
-        struct timespec ts  = { .tv_sec = 0, .tv_nsec = 100000000 };
-        struct timespec ts2 = { .tv_sec = 0, .tv_nsec = 100000000 };
-        nanosleep(&ts, &ts2);
-        idbfs_put("file.txt", "Some dynamic file contents...\n");
         emscripten_set_main_loop(gameLoop, 0, 0);
     #else  /* ifdef __EMSCRIPTEN__ */
         while (!WindowShouldClose())
@@ -647,9 +1935,30 @@ int main() {
 
     #endif /* ifdef __EMSCRIPTEN__ */
 
-    for (int i = 0; i < objsLen; i++)
-        if (objs[i].label != NULL)
-            free(objs[i].label);
+    layoutStop(&layout);
+    pathFinderFree(&paths);
+    journalClose(&autosave);
+    if (paging)
+        pagerFree(&pager);
+    storageClose();
+    spatialGridFree(&objGrid);
+    visibleSetFree(&visible);
+    selectionFree(&selection);
+    free(lasso);
+    clusterIndexFree(&clusters);
+    minimapFree(&minimap);
+    free(markers);
+    gridRendererUnload(&gridlines);
+    labelCacheUnload(&labels);
+    spriteBatchUnload(&sprites);
+    edgeDensityFree(&density);
+    UnloadTexture(densityTexture);
+    UnloadTexture(minimapTexture);
+    objectStoreFree(&objs);
+    connectionStoreFree(&cons);
+    stringArenaFree(&labelStrings);
+    adjacencyFree(&adjacency);
+    profilerCloseCsv();
 
     return 0;
 } /* main */
@@ -0,0 +1,213 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "minimap.h"
+
+static uint32_t levelSide(int level) {
+    return MINIMAP_CELLS >> level;
+}
+
+static int64_t extent(struct minimap * map) {
+    return (int64_t) map->cellSize * MINIMAP_CELLS;
+}
+
+static int covers(struct minimap * map, int y, int x) {
+    return y >= map->originY && y - (int64_t) map->originY < extent(map)
+           && x >= map->originX && x - (int64_t) map->originX < extent(map);
+}
+
+/**
+ * Level 0 cell of a world position, clamped to the grid for positions
+ * past the largest square the minimap grows to.
+ */
+static void cellOf(struct minimap * map, int y, int x, uint32_t * cy,
+  uint32_t * cx) {
+    int64_t row = ((int64_t) y - map->originY) / map->cellSize;
+    int64_t col = ((int64_t) x - map->originX) / map->cellSize;
+
+    *cy = row < 0 ? 0 : row >= MINIMAP_CELLS ? MINIMAP_CELLS - 1 : row;
+    *cx = col < 0 ? 0 : col >= MINIMAP_CELLS ? MINIMAP_CELLS - 1 : col;
+}
+
+static void shade(struct minimap * map, uint32_t cy, uint32_t cx) {
+    uint32_t count = map->counts[0][cy * MINIMAP_CELLS + cx];
+    float    alpha = count ? MINIMAP_ALPHA * (1 + log2f(count)) : 0;
+
+    map->pixels[cy * MINIMAP_CELLS + cx] = (Color) {
+        0, 82, 172, alpha > 255 ? 255 : alpha
+    };
+    map->dirty = 1;
+}
+
+static void shadeAll(struct minimap * map) {
+    for (uint32_t cy = 0; cy < MINIMAP_CELLS; cy++)
+        for (uint32_t cx = 0; cx < MINIMAP_CELLS; cx++)
+            shade(map, cy, cx);
+}
+
+/**
+ * Sets the covered square to the smallest one centred on (y, x) whose cells
+ * are at least cellSize wide and which spans span world units.
+ */
+static void anchor(struct minimap * map, int y, int x, int64_t span) {
+    int cellSize = MINIMAP_MIN_CELL;
+
+    while ((int64_t) cellSize * MINIMAP_CELLS < span
+      && cellSize < MINIMAP_MAX_CELL)
+        cellSize *= 2;
+    map->cellSize = cellSize;
+    map->originY  = y - (int64_t) cellSize * MINIMAP_CELLS / 2;
+    map->originX  = x - (int64_t) cellSize * MINIMAP_CELLS / 2;
+    map->anchored = 1;
+}
+
+/**
+ * Doubles the covered square around its centre. Level l of the new grid is
+ * level l + 1 of the old one, a quarter of the way in from every side;
+ * the levels too coarse for that are summed from the level below.
+ */
+static void grow(struct minimap * map) {
+    for (int l = 0; l < MINIMAP_LEVELS; l++) {
+        uint32_t   side   = levelSide(l);
+        uint32_t * counts = map->counts[l];
+
+        if (side >= 4 && l + 1 < MINIMAP_LEVELS) {
+            uint32_t   oldSide = levelSide(l + 1);
+            uint32_t * old     = map->counts[l + 1];
+            uint32_t   offset  = side / 4;
+            memset(counts, 0, side * side * sizeof(uint32_t));
+            for (uint32_t cy = 0; cy < oldSide; cy++)
+                memcpy(&counts[(cy + offset) * side + offset],
+                  &old[cy * oldSide], oldSide * sizeof(uint32_t));
+        } else {
+            uint32_t * below = map->counts[l - 1];
+            for (uint32_t cy = 0; cy < side; cy++) {
+                for (uint32_t cx = 0; cx < side; cx++) {
+                    uint32_t i = 2 * cy * 2 * side + 2 * cx;
+                    counts[cy * side + cx] = below[i] + below[i + 1]
+                                             + below[i + 2 * side]
+                                             + below[i + 2 * side + 1];
+                }
+            }
+        }
+    }
+
+    map->originY  -= extent(map) / 2;
+    map->originX  -= extent(map) / 2;
+    map->cellSize *= 2;
+    shadeAll(map);
+}
+
+/**
+ * Adds delta to the counts of the cell holding (y, x) on every level.
+ */
+static void count(struct minimap * map, int y, int x, int delta) {
+    uint32_t cy, cx;
+
+    cellOf(map, y, x, &cy, &cx);
+    if (delta < 0 && map->counts[0][cy * MINIMAP_CELLS + cx] == 0)
+        return;
+    for (int l = 0; l < MINIMAP_LEVELS; l++)
+        map->counts[l][(cy >> l) * levelSide(l) + (cx >> l)] += delta;
+    shade(map, cy, cx);
+}
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void minimapInit(struct minimap * map) {
+    for (int l = 0; l < MINIMAP_LEVELS; l++)
+        map->counts[l] = malloc(levelSide(l) * levelSide(l)
+            * sizeof(uint32_t));
+    minimapClear(map);
+}
+
+void minimapFree(struct minimap * map) {
+    for (int l = 0; l < MINIMAP_LEVELS; l++) {
+        free(map->counts[l]);
+        map->counts[l] = NULL;
+    }
+}
+
+void minimapClear(struct minimap * map) {
+    for (int l = 0; l < MINIMAP_LEVELS; l++)
+        memset(map->counts[l], 0, levelSide(l) * levelSide(l)
+          * sizeof(uint32_t));
+    anchor(map, 0, 0, 0);
+    map->anchored = 0;
+    shadeAll(map);
+}
+
+void minimapRebuild(struct minimap * map, struct objectStore * objs) {
+    minimapClear(map);
+    if (objs->len == 0)
+        return;
+
+    int minY = OBJECT_FIELD(objs, y, 0), maxY = minY;
+    int minX = OBJECT_FIELD(objs, x, 0), maxX = minX;
+    for (uint32_t i = 1; i < objs->len; i++) {
+        int y = OBJECT_FIELD(objs, y, i);
+        int x = OBJECT_FIELD(objs, x, i);
+        minY = y < minY ? y : minY;
+        maxY = y > maxY ? y : maxY;
+        minX = x < minX ? x : minX;
+        maxX = x > maxX ? x : maxX;
+    }
+
+    // A cell to spare on either side, so that the edges don't sit on the
+    // border
+    int64_t h = (int64_t) maxY - minY;
+    int64_t w = (int64_t) maxX - minX;
+    anchor(map, minY + h / 2, minX + w / 2,
+      (h > w ? h : w) * (MINIMAP_CELLS + 2) / MINIMAP_CELLS + 1);
+
+    for (uint32_t i = 0; i < objs->len; i++)
+        count(map, OBJECT_FIELD(objs, y, i), OBJECT_FIELD(objs, x, i), 1);
+} /* minimapRebuild */
+
+void minimapAdd(struct minimap * map, int y, int x) {
+    if (!map->anchored)
+        anchor(map, y, x, 0);
+    while (!covers(map, y, x) && map->cellSize < MINIMAP_MAX_CELL)
+        grow(map);
+    count(map, y, x, 1);
+}
+
+void minimapRemove(struct minimap * map, int y, int x) {
+    count(map, y, x, -1);
+}
+
+void minimapMove(struct minimap * map, int oldY, int oldX, int newY,
+  int newX) {
+    uint32_t oldCy, oldCx, newCy, newCx;
+
+    // Most moves are a few units, within one cell
+    cellOf(map, oldY, oldX, &oldCy, &oldCx);
+    cellOf(map, newY, newX, &newCy, &newCx);
+    if (oldCy == newCy && oldCx == newCx && covers(map, newY, newX))
+        return;
+
+    minimapRemove(map, oldY, oldX);
+    minimapAdd(map, newY, newX);
+}
+
+int minimapTakeDirty(struct minimap * map) {
+    int dirty = map->dirty;
+
+    map->dirty = 0;
+    return dirty;
+}
+
+void minimapFromWorld(struct minimap * map, int y, int x, float * v,
+  float * u) {
+    *v = ((int64_t) y - map->originY) / (float) extent(map);
+    *u = ((int64_t) x - map->originX) / (float) extent(map);
+}
+
+void minimapToWorld(struct minimap * map, float v, float u, int * y,
+  int * x) {
+    *y = map->originY + (int64_t) (v * extent(map));
+    *x = map->originX + (int64_t) (u * extent(map));
+}
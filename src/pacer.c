@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pacer.h"
+
+// Frame rates to pick from, fastest first. 60 and its fractions suit the
+// common displays; 144, 120, 90 and 72 the faster ones.
+static const int rates[] = { 144, 120, 90, 72, 60, 48, 40, 30, 20 };
+
+#define RUNGS ((int) (sizeof(rates) / sizeof(rates[0])))
+
+static float budgetMs(int rung) {
+    return 1000.0f / rates[rung];
+}
+
+static int compareFloats(const void * a, const void * b) {
+    float x = *(const float *) a;
+    float y = *(const float *) b;
+
+    return (x > y) - (x < y);
+}
+
+void pacerInit(struct framePacer * pacer, int maxRate) {
+    memset(pacer, 0, sizeof(*pacer));
+
+    // The fastest rate on the ladder no faster than maxRate
+    pacer->topRung = RUNGS - 1;
+    for (int r = 0; r < RUNGS; r++) {
+        if (rates[r] <= maxRate) {
+            pacer->topRung = r;
+            break;
+        }
+    }
+    pacer->rung = pacer->topRung;
+}
+
+void pacerBeginFrame(struct framePacer * pacer, double now) {
+    pacer->frameStart = now;
+    pacer->dragging   = 0;
+}
+
+void pacerMarkDrag(struct framePacer * pacer) {
+    pacer->dragging = 1;
+}
+
+int pacerEndFrame(struct framePacer * pacer, double now) {
+    float ms = (now - pacer->frameStart) * 1000;
+
+    if (pacer->dragging) {
+        pacer->latencies[pacer->latencyNext] = ms;
+        pacer->latencyNext = (pacer->latencyNext + 1) % PACER_LATENCY_WINDOW;
+        if (pacer->latencyLen < PACER_LATENCY_WINDOW)
+            pacer->latencyLen++;
+    }
+
+    // A stall such as a file dialog or a page load counts for no more than
+    // a couple of missed frames; frames that are slow for real keep coming
+    // and still pull the cost up
+    float spike = budgetMs(pacer->rung) * PACER_SPIKE_BUDGETS;
+    pacer->cost += PACER_SMOOTHING * ((ms < spike ? ms : spike) - pacer->cost);
+
+    // Too slow for this rate: drop at once, a missed deadline shows
+    if (pacer->rung < RUNGS - 1
+      && pacer->cost > budgetMs(pacer->rung) * PACER_HEADROOM) {
+        pacer->rung++;
+        pacer->fastFrames = 0;
+        return 1;
+    }
+
+    // Fast enough for the next rate up: climb only once that has held for
+    // a while, so a few cheap frames don't set off another drop
+    if (pacer->rung > pacer->topRung
+      && pacer->cost < budgetMs(pacer->rung - 1) * PACER_HEADROOM) {
+        if (++pacer->fastFrames >= PACER_UP_FRAMES) {
+            pacer->rung--;
+            pacer->fastFrames = 0;
+            return 1;
+        }
+    } else {
+        pacer->fastFrames = 0;
+    }
+    return 0;
+} /* pacerEndFrame */
+
+int pacerRate(struct framePacer * pacer) {
+    return rates[pacer->rung];
+}
+
+float pacerCost(struct framePacer * pacer) {
+    return pacer->cost;
+}
+
+void pacerLatencyStats(struct framePacer * pacer,
+  struct pacerLatency * stats) {
+    uint32_t n = pacer->latencyLen;
+    float    sorted[PACER_LATENCY_WINDOW];
+
+    memset(stats, 0, sizeof(*stats));
+    if (n == 0)
+        return;
+
+    memcpy(sorted, pacer->latencies, n * sizeof(float));
+    qsort(sorted, n, sizeof(float), compareFloats);
+
+    float sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+        sum += sorted[i];
+
+    stats->avg     = sum / n;
+    stats->p99     = sorted[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+    stats->max     = sorted[n - 1];
+    stats->samples = n;
+}
@@ -0,0 +1,968 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+# include <direct.h>
+#else
+# include <sys/stat.h>
+#endif
+
+#include "pager.h"
+#include "scenefile.h"
+
+enum pageTag {
+    PAGE_OBJECT = 1,
+    PAGE_CONNECTION
+};
+
+/**
+ * Objects and connections are written as a tag, one of these and then the
+ * label's bytes.
+ */
+struct pageObject {
+    struct handle h;
+    int32_t       y, x;
+    int32_t       radius;
+    Color         color;
+    uint8_t       type;
+    uint8_t       sticky;
+    uint32_t      labelLen;
+};
+
+struct pageConnection {
+    struct handle src;
+    struct handle dest;
+    int32_t       width;
+    Color         color;
+    uint32_t      labelLen;
+};
+
+/**
+ * Where an evicted object went, by slot.
+ */
+struct pagerHome {
+    struct pagerTile tile;
+    int32_t          y, x;
+    uint32_t         generation;
+    uint8_t          paged;
+};
+
+/**
+ * Everything paging a tile in or out needs.
+ */
+struct pagerCtx {
+    struct pager *              pager;
+    struct objectStore *        objs;
+    struct connectionStore *    cons;
+    struct adjacencyIndex *     adjacency;
+    struct stringArena *        labels;
+    const struct pagerHandler * handler;
+    void *                      ctx;
+    FILE *                      page;
+};
+
+/**
+ * An object about to be evicted, and the tile it goes to.
+ */
+struct pagerVictim {
+    struct pagerTile tile;
+    struct handle    h;
+};
+
+static int floorDiv(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static int tileCompare(const void * a, const void * b) {
+    const struct pagerTile * p = a;
+    const struct pagerTile * q = b;
+
+    if (p->ty != q->ty)
+        return p->ty < q->ty ? -1 : 1;
+    return (p->tx > q->tx) - (p->tx < q->tx);
+}
+
+static int victimCompare(const void * a, const void * b) {
+    return tileCompare(&((const struct pagerVictim *) a)->tile,
+             &((const struct pagerVictim *) b)->tile);
+}
+
+static void tilePath(struct pager * pager, struct pagerTile t, char * buf,
+  size_t size) {
+    snprintf(buf, size, "%s/tile_%d_%d.page", pager->dir, t.ty, t.tx);
+}
+
+/*****************************************************************************
+* Tile and home bookkeeping
+*****************************************************************************/
+
+/**
+ * Returns the position of t in the paged list, or where it would go.
+ */
+static uint32_t pagedFind(struct pager * pager, struct pagerTile t,
+  int * found) {
+    uint32_t lo = 0, hi = pager->pagedLen;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int      c   = tileCompare(&pager->paged[mid], &t);
+        if (c == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = 0;
+    return lo;
+}
+
+static void pagedAdd(struct pager * pager, struct pagerTile t) {
+    int      found;
+    uint32_t i = pagedFind(pager, t, &found);
+
+    if (found)
+        return;
+    if (pager->pagedLen == pager->pagedCap) {
+        pager->pagedCap = pager->pagedCap ? pager->pagedCap * 2 : 64;
+        pager->paged    = realloc(pager->paged,
+          pager->pagedCap * sizeof(struct pagerTile));
+    }
+    memmove(&pager->paged[i + 1], &pager->paged[i],
+      (pager->pagedLen - i) * sizeof(struct pagerTile));
+    pager->paged[i] = t;
+    pager->pagedLen++;
+}
+
+static void pagedDrop(struct pager * pager, struct pagerTile t) {
+    int      found;
+    uint32_t i = pagedFind(pager, t, &found);
+
+    if (!found)
+        return;
+    memmove(&pager->paged[i], &pager->paged[i + 1],
+      (pager->pagedLen - i - 1) * sizeof(struct pagerTile));
+    pager->pagedLen--;
+}
+
+static struct pagerHome * homeOf(struct pager * pager, uint32_t slot) {
+    if (slot >= pager->homesLen) {
+        uint32_t cap = pager->homesLen ? pager->homesLen : 1024;
+        while (cap <= slot)
+            cap *= 2;
+        pager->homes = realloc(pager->homes, cap * sizeof(struct pagerHome));
+        memset(&pager->homes[pager->homesLen], 0,
+          (cap - pager->homesLen) * sizeof(struct pagerHome));
+        pager->homesLen = cap;
+    }
+    return &pager->homes[slot];
+}
+
+/**
+ * Returns the home of an object that is paged out, or NULL if h isn't.
+ */
+static struct pagerHome * pagedHome(struct pager * pager, struct handle h) {
+    if (h.index >= pager->homesLen)
+        return NULL;
+
+    struct pagerHome * home = &pager->homes[h.index];
+    return home->paged && home->generation == h.generation ? home : NULL;
+}
+
+static int inRegion(struct pagerRegion r, struct pagerTile t) {
+    return t.ty >= r.ty0 && t.ty <= r.ty1 && t.tx >= r.tx0 && t.tx <= r.tx1;
+}
+
+/*****************************************************************************
+* Records
+*****************************************************************************/
+
+static void writeLabel(FILE * f, const char * label, uint32_t len) {
+    if (len > 0)
+        fwrite(label, 1, len, f);
+}
+
+static struct pageObject objectRecord(struct handle h, struct object obj) {
+    return (struct pageObject) {
+        .h        = h,
+        .y        = obj.y,
+        .x        = obj.x,
+        .radius   = obj.radius,
+        .color    = obj.color,
+        .type     = obj.type,
+        .sticky   = obj.sticky != 0,
+        .labelLen = obj.label ? strlen(obj.label) : 0
+    };
+}
+
+static struct pageConnection connectionRecord(struct connection con) {
+    return (struct pageConnection) {
+        .src      = con.src,
+        .dest     = con.dest,
+        .width    = con.width,
+        .color    = con.color,
+        .labelLen = con.label ? strlen(con.label) : 0
+    };
+}
+
+static void writeObject(FILE * f, struct handle h, struct object obj) {
+    uint8_t           tag = PAGE_OBJECT;
+    struct pageObject rec = objectRecord(h, obj);
+
+    fwrite(&tag, 1, 1, f);
+    fwrite(&rec, sizeof(rec), 1, f);
+    writeLabel(f, obj.label, rec.labelLen);
+}
+
+static void writeConnection(FILE * f, struct connection con) {
+    uint8_t               tag = PAGE_CONNECTION;
+    struct pageConnection rec = connectionRecord(con);
+
+    fwrite(&tag, 1, 1, f);
+    fwrite(&rec, sizeof(rec), 1, f);
+    writeLabel(f, con.label, rec.labelLen);
+}
+
+static struct object storedObject(struct objectStore * objs, uint32_t dense) {
+    return (struct object) {
+        .type   = OBJECT_FIELD(objs, type, dense),
+        .sticky = OBJECT_FIELD(objs, sticky, dense),
+        .label  = OBJECT_FIELD(objs, label, dense),
+        .radius = OBJECT_FIELD(objs, radius, dense),
+        .color  = OBJECT_FIELD(objs, color, dense),
+        .y      = OBJECT_FIELD(objs, y, dense),
+        .x      = OBJECT_FIELD(objs, x, dense)
+    };
+}
+
+static struct connection storedConnection(struct connectionStore * cons,
+  uint32_t dense) {
+    return (struct connection) {
+        .label = CONNECTION_FIELD(cons, label, dense),
+        .width = CONNECTION_FIELD(cons, width, dense),
+        .color = CONNECTION_FIELD(cons, color, dense),
+        .src   = CONNECTION_FIELD(cons, src, dense),
+        .dest  = CONNECTION_FIELD(cons, dest, dense)
+    };
+}
+
+/**
+ * Marks h as paged out to a tile, with the position it was at.
+ */
+static void setHome(struct pager * pager, struct handle h,
+  struct pagerTile t, int y, int x) {
+    struct pagerHome * home = homeOf(pager, h.index);
+
+    home->tile       = t;
+    home->y          = y;
+    home->x          = x;
+    home->generation = h.generation;
+    home->paged      = 1;
+}
+
+/**
+ * Reads a label of len bytes into a buffer grown as needed. Returns NULL
+ * at the end of the file.
+ */
+static const char * readLabel(FILE * f, uint32_t len, char ** buf,
+  size_t * cap) {
+    if (len + 1 > *cap) {
+        *cap = len + 1;
+        *buf = realloc(*buf, *cap);
+    }
+    if (len > 0 && fread(*buf, 1, len, f) != len)
+        return NULL;
+    (*buf)[len] = '\0';
+    return *buf;
+}
+
+/**
+ * Reads the next record of a page into obj or con, with its label in a
+ * buffer grown as needed. Returns the record's tag, 0 at the end of the
+ * file or -1 if the page is corrupt.
+ */
+static int readRecord(FILE * f, struct pageObject * obj,
+  struct pageConnection * con, const char ** label, char ** buf,
+  size_t * cap) {
+    uint8_t tag;
+
+    if (fread(&tag, 1, 1, f) != 1)
+        return 0;
+    if (tag == PAGE_OBJECT) {
+        if (fread(obj, sizeof(*obj), 1, f) != 1
+          || (*label = readLabel(f, obj->labelLen, buf, cap)) == NULL)
+            return 0;
+    } else if (tag == PAGE_CONNECTION) {
+        if (fread(con, sizeof(*con), 1, f) != 1
+          || (*label = readLabel(f, con->labelLen, buf, cap)) == NULL)
+            return 0;
+    } else {
+        return -1;
+    }
+    return tag;
+} /* readRecord */
+
+/*****************************************************************************
+* Paging out
+*****************************************************************************/
+
+static void evictConnection(struct handle con, void * ctx) {
+    struct pagerCtx * p = ctx;
+
+    writeConnection(p->page,
+      storedConnection(p->cons, connectionStoreDense(p->cons, con)));
+    connectionStoreRemove(p->cons, con);
+    adjacencyRemove(p->adjacency);
+}
+
+/**
+ * Writes the victims of one tile to its page and takes them out of the
+ * stores, along with the connections still touching them.
+ */
+static void evictTile(struct pagerCtx * p, const struct pagerVictim * v,
+  uint32_t n) {
+    struct pager * pager = p->pager;
+    char           path[1024];
+
+    tilePath(pager, v[0].tile, path, sizeof(path));
+    p->page = fopen(path, "ab");
+    if (p->page == NULL) {
+        // Keep the tile in memory rather than lose it
+        fprintf(stderr, "Could not page out to %s\n", path);
+        return;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        struct handle h   = v[i].h;
+        struct object obj = storedObject(p->objs,
+            objectStoreDense(p->objs, h));
+
+        adjacencyQuery(p->adjacency, p->cons, h, evictConnection, p);
+        if (p->handler->evicting)
+            p->handler->evicting(h, obj.y, obj.x, p->ctx);
+
+        writeObject(p->page, h, obj);
+        setHome(pager, h, v[i].tile, obj.y, obj.x);
+        objectStoreEvict(p->objs, h);
+        pager->evicted++;
+    }
+
+    fclose(p->page);
+    p->page = NULL;
+    pagedAdd(pager, v[0].tile);
+}
+
+/**
+ * Evicts every object outside keep.
+ */
+static void evictOutside(struct pagerCtx * p, struct pagerRegion keep) {
+    struct pager *       pager   = p->pager;
+    struct pagerVictim * victims = NULL;
+    uint32_t             n = 0, cap = 0;
+
+    for (uint32_t i = 0; i < p->objs->len; i++) {
+        struct pagerTile t = {
+            floorDiv(OBJECT_FIELD(p->objs, y, i), pager->tileSize),
+            floorDiv(OBJECT_FIELD(p->objs, x, i), pager->tileSize)
+        };
+        if (inRegion(keep, t))
+            continue;
+        if (n == cap) {
+            cap     = cap ? cap * 2 : 1024;
+            victims = realloc(victims, cap * sizeof(struct pagerVictim));
+        }
+        victims[n++] = (struct pagerVictim) {
+            t, objectStoreHandle(p->objs, i)
+        };
+    }
+
+    if (n == 0)
+        return;
+
+    // One page file open at a time
+    qsort(victims, n, sizeof(struct pagerVictim), victimCompare);
+    for (uint32_t i = 0, j; i < n; i = j) {
+        for (j = i + 1; j < n; j++)
+            if (tileCompare(&victims[i].tile, &victims[j].tile) != 0)
+                break;
+        evictTile(p, &victims[i], j - i);
+    }
+    free(victims);
+}
+
+/*****************************************************************************
+* Paging in
+*****************************************************************************/
+
+/**
+ * Puts back a paged out connection if both its ends are back, or else moves
+ * it to the page of whichever end is still out. Connections to deleted
+ * objects are dropped.
+ */
+static void restoreConnection(struct pagerCtx * p, struct connection con) {
+    struct pager * pager = p->pager;
+    int            src   = objectStoreDense(p->objs, con.src) != STORE_NONE;
+    int            dest  = objectStoreDense(p->objs, con.dest) != STORE_NONE;
+
+    if (src && dest) {
+        struct handle h = connectionStoreAdd(p->cons, con);
+        adjacencyAdd(p->adjacency, p->cons, h);
+        return;
+    }
+
+    struct pagerHome * home = pagedHome(pager, src ? con.dest : con.src);
+    if (home == NULL)
+        return;
+
+    char path[1024];
+    tilePath(pager, home->tile, path, sizeof(path));
+    FILE * f = fopen(path, "ab");
+    if (f == NULL) {
+        fprintf(stderr, "Could not page out to %s\n", path);
+        return;
+    }
+
+    writeConnection(f, con);
+    fclose(f);
+}
+
+/**
+ * Reads a tile's page back into the stores and deletes it. Objects go back
+ * first, so that connections within the tile find both their ends.
+ */
+static void restoreTile(struct pagerCtx * p, struct pagerTile t) {
+    struct pager *        pager = p->pager;
+    struct connection *   pending = NULL;
+    uint32_t              n = 0, cap = 0;
+    char *                buf = NULL;
+    size_t                bufCap = 0;
+    char                  path[1024];
+    int                   tag;
+    struct pageObject     objRec;
+    struct pageConnection conRec;
+    const char *          label;
+
+    tilePath(pager, t, path, sizeof(path));
+    FILE * f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Could not page in %s\n", path);
+        pagedDrop(pager, t);
+        return;
+    }
+
+    while ((tag = readRecord(f, &objRec, &conRec, &label, &buf,
+      &bufCap)) > 0) {
+        if (tag == PAGE_OBJECT) {
+            struct object obj = {
+                .type   = objRec.type,
+                .sticky = objRec.sticky,
+                .label  = stringArenaIntern(p->labels, label),
+                .radius = objRec.radius,
+                .color  = objRec.color,
+                .y      = objRec.y,
+                .x      = objRec.x
+            };
+            struct pagerHome * home = pagedHome(pager, objRec.h);
+            if (home == NULL || !objectStoreRestore(p->objs, objRec.h, obj))
+                continue;
+            home->paged = 0;
+            pager->restored++;
+            if (p->handler->restored)
+                p->handler->restored(objRec.h, obj, p->ctx);
+        } else {
+            if (n == cap) {
+                cap     = cap ? cap * 2 : 256;
+                pending = realloc(pending, cap * sizeof(struct connection));
+            }
+            pending[n++] = (struct connection) {
+                .label = stringArenaIntern(p->labels, label),
+                .width = conRec.width,
+                .color = conRec.color,
+                .src   = conRec.src,
+                .dest  = conRec.dest
+            };
+        }
+    }
+    if (tag < 0)
+        fprintf(stderr, "Corrupt page %s\n", path);
+    fclose(f);
+    remove(path);
+    pagedDrop(pager, t);
+
+    for (uint32_t i = 0; i < n; i++)
+        restoreConnection(p, pending[i]);
+    free(pending);
+    free(buf);
+}
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+int pagerInit(struct pager * pager, const char * dir, int tileSize) {
+    memset(pager, 0, sizeof(*pager));
+    pager->dir      = strdup(dir);
+    pager->tileSize = tileSize;
+    pager->lastTime = -1;
+
+    #ifdef _WIN32
+        int err = _mkdir(dir);
+    #else
+        int err = mkdir(dir, 0755);
+    #endif
+    return err != 0 && errno != EEXIST ? -1 : 0;
+}
+
+void pagerClear(struct pager * pager) {
+    char path[1024];
+
+    for (uint32_t i = 0; i < pager->pagedLen; i++) {
+        tilePath(pager, pager->paged[i], path, sizeof(path));
+        remove(path);
+    }
+    pager->pagedLen  = 0;
+    pager->keptValid = 0;
+    pager->evicted   = 0;
+    pager->restored  = 0;
+    if (pager->homes != NULL)
+        memset(pager->homes, 0, pager->homesLen * sizeof(struct pagerHome));
+}
+
+void pagerFree(struct pager * pager) {
+    pagerClear(pager);
+    free(pager->paged);
+    free(pager->homes);
+    free(pager->dir);
+    pager->paged = NULL;
+    pager->homes = NULL;
+    pager->dir   = NULL;
+}
+
+/**
+ * Works out the tiles to keep for a viewport, stretched ahead along the pan
+ * velocity and capped at PAGER_MAX_SPAN tiles across.
+ */
+static struct pagerRegion regionFor(struct pager * pager, int y, int x,
+  int h, int w) {
+    float y0 = y, y1 = y + h;
+    float x0 = x, x1 = x + w;
+    float aheadY = pager->velY * PAGER_PREFETCH_SECONDS;
+    float aheadX = pager->velX * PAGER_PREFETCH_SECONDS;
+
+    if (aheadY > 0)
+        y1 += aheadY;
+    else
+        y0 += aheadY;
+    if (aheadX > 0)
+        x1 += aheadX;
+    else
+        x0 += aheadX;
+
+    struct pagerRegion r = {
+        floorDiv(y0, pager->tileSize) - PAGER_MARGIN_TILES,
+        floorDiv(x0, pager->tileSize) - PAGER_MARGIN_TILES,
+        floorDiv(y1, pager->tileSize) + PAGER_MARGIN_TILES,
+        floorDiv(x1, pager->tileSize) + PAGER_MARGIN_TILES
+    };
+
+    // Zoomed far out, keep the tiles around the centre of the view
+    int cy = floorDiv(y + h / 2, pager->tileSize);
+    int cx = floorDiv(x + w / 2, pager->tileSize);
+    if (r.ty1 - r.ty0 >= PAGER_MAX_SPAN) {
+        r.ty0 = cy - PAGER_MAX_SPAN / 2;
+        r.ty1 = r.ty0 + PAGER_MAX_SPAN - 1;
+    }
+    if (r.tx1 - r.tx0 >= PAGER_MAX_SPAN) {
+        r.tx0 = cx - PAGER_MAX_SPAN / 2;
+        r.tx1 = r.tx0 + PAGER_MAX_SPAN - 1;
+    }
+    return r;
+}
+
+void pagerUpdate(struct pager * pager, struct objectStore * objs,
+  struct connectionStore * cons, struct adjacencyIndex * adjacency,
+  struct stringArena * labels, const struct pagerHandler * handler, void * ctx,
+  int y, int x, int h, int w, double now) {
+    double dt = now - pager->lastTime;
+
+    if (pager->lastTime >= 0 && dt > 0) {
+        pager->velY += PAGER_VELOCITY_SMOOTHING
+          * ((y - pager->lastY) / dt - pager->velY);
+        pager->velX += PAGER_VELOCITY_SMOOTHING
+          * ((x - pager->lastX) / dt - pager->velX);
+    }
+    pager->lastY    = y;
+    pager->lastX    = x;
+    pager->lastTime = now;
+
+    struct pagerRegion keep = regionFor(pager, y, x, h, w);
+    if (pager->keptValid && memcmp(&keep, &pager->kept, sizeof(keep)) == 0)
+        return;
+    pager->kept      = keep;
+    pager->keptValid = 1;
+
+    struct pagerCtx p = {
+        pager, objs, cons, adjacency, labels, handler, ctx, NULL
+    };
+
+    // Restoring changes the paged list, so take the tiles to restore first
+    uint32_t           n    = 0;
+    struct pagerTile * back = malloc(
+      (pager->pagedLen + 1) * sizeof(struct pagerTile));
+    for (uint32_t i = 0; i < pager->pagedLen; i++)
+        if (inRegion(keep, pager->paged[i]))
+            back[n++] = pager->paged[i];
+    for (uint32_t i = 0; i < n; i++)
+        restoreTile(&p, back[i]);
+    free(back);
+
+    struct pagerRegion hold = {
+        keep.ty0 - PAGER_HYSTERESIS_TILES, keep.tx0 - PAGER_HYSTERESIS_TILES,
+        keep.ty1 + PAGER_HYSTERESIS_TILES, keep.tx1 + PAGER_HYSTERESIS_TILES
+    };
+    evictOutside(&p, hold);
+}
+
+void pagerRestoreAll(struct pager * pager, struct objectStore * objs,
+  struct connectionStore * cons, struct adjacencyIndex * adjacency,
+  struct stringArena * labels, const struct pagerHandler * handler,
+  void * ctx) {
+    struct pagerCtx p = {
+        pager, objs, cons, adjacency, labels, handler, ctx, NULL
+    };
+
+    while (pager->pagedLen > 0)
+        restoreTile(&p, pager->paged[0]);
+
+    // Page out again on the next update
+    pager->keptValid = 0;
+}
+
+/*****************************************************************************
+* Whole scenes
+*****************************************************************************/
+
+/**
+ * Looks up where an object is, in memory or paged out. Returns 0 if it is
+ * neither.
+ */
+static int positionOf(struct pager * pager, struct objectStore * objs,
+  struct handle h, int * y, int * x) {
+    uint32_t dense = objectStoreDense(objs, h);
+
+    if (dense != STORE_NONE) {
+        *y = OBJECT_FIELD(objs, y, dense);
+        *x = OBJECT_FIELD(objs, x, dense);
+        return 1;
+    }
+
+    struct pagerHome * home = pagedHome(pager, h);
+    if (home == NULL)
+        return 0;
+    *y = home->y;
+    *x = home->x;
+    return 1;
+}
+
+void pagerWalk(struct pager * pager, struct objectStore * objs,
+  const struct pagerVisitor * visitor, void * ctx) {
+    char *                buf = NULL;
+    size_t                bufCap = 0;
+    char                  path[1024];
+    int                   tag;
+    struct pageObject     objRec;
+    struct pageConnection conRec;
+    const char *          label;
+
+    for (uint32_t i = 0; i < pager->pagedLen; i++) {
+        struct pagerTile t = pager->paged[i];
+
+        tilePath(pager, t, path, sizeof(path));
+        FILE * f = fopen(path, "rb");
+        if (f == NULL) {
+            fprintf(stderr, "Could not read %s\n", path);
+            continue;
+        }
+
+        while ((tag = readRecord(f, &objRec, &conRec, &label, &buf,
+          &bufCap)) > 0) {
+            if (tag == PAGE_OBJECT) {
+                struct pagerHome * home = pagedHome(pager, objRec.h);
+                if (visitor->object == NULL || home == NULL
+                  || tileCompare(&home->tile, &t) != 0)
+                    continue;
+                visitor->object(objRec.h, (struct object) {
+                    .type   = objRec.type,
+                    .sticky = objRec.sticky,
+                    .label  = label,
+                    .radius = objRec.radius,
+                    .color  = objRec.color,
+                    .y      = objRec.y,
+                    .x      = objRec.x
+                }, ctx);
+            } else {
+                int srcY, srcX, destY, destX;
+
+                // Connections to deleted objects wait in their page to be
+                // dropped on the way back in
+                if (visitor->connection == NULL
+                  || !positionOf(pager, objs, conRec.src, &srcY, &srcX)
+                  || !positionOf(pager, objs, conRec.dest, &destY, &destX))
+                    continue;
+                visitor->connection((struct connection) {
+                    .label = label,
+                    .width = conRec.width,
+                    .color = conRec.color,
+                    .src   = conRec.src,
+                    .dest  = conRec.dest
+                }, srcY, srcX, destY, destX, ctx);
+            }
+        }
+        if (tag < 0)
+            fprintf(stderr, "Corrupt page %s\n", path);
+        fclose(f);
+    }
+    free(buf);
+} /* pagerWalk */
+
+/**
+ * Records gathered for a tile's page while loading a scene, in a hash table
+ * by tile.
+ */
+struct pagerLoadPage {
+    struct pagerTile tile;
+    uint8_t *        data;
+    uint32_t         len;
+    uint32_t         cap;
+    uint8_t          used;
+};
+
+/**
+ * Everything loading a scene straight to pages needs.
+ */
+struct pagerLoad {
+    struct pager *              pager;
+    struct objectStore *        objs;
+    struct connectionStore *    cons;
+    struct stringArena *        labels;
+    const struct pagerHandler * handler;
+    void *                      ctx;
+    struct pagerRegion          keep;
+
+    struct pagerLoadPage *      pages;
+    uint32_t                    pagesLen;
+    uint32_t                    pagesCap;
+
+    // Bytes gathered in all pages since they were last written out
+    size_t                      buffered;
+    int                         failed;
+};
+
+static uint32_t tileHash(struct pagerTile t) {
+    return (uint32_t) t.ty * 0x9e3779b1u ^ (uint32_t) t.tx * 0x85ebca77u;
+}
+
+/**
+ * Returns the slot for a tile in the table, which must have room.
+ */
+static struct pagerLoadPage * pageSlot(struct pagerLoadPage * pages,
+  uint32_t cap, struct pagerTile t) {
+    uint32_t i = tileHash(t) & (cap - 1);
+
+    while (pages[i].used && tileCompare(&pages[i].tile, &t) != 0)
+        i = (i + 1) & (cap - 1);
+    return &pages[i];
+}
+
+/**
+ * Returns the gathered records for a tile, adding it to the table and the
+ * paged list the first time.
+ */
+static struct pagerLoadPage * loadPage(struct pagerLoad * l,
+  struct pagerTile t) {
+    if (2 * (l->pagesLen + 1) > l->pagesCap) {
+        uint32_t               cap   = l->pagesCap ? l->pagesCap * 2 : 256;
+        struct pagerLoadPage * pages = calloc(cap, sizeof(*pages));
+        for (uint32_t i = 0; i < l->pagesCap; i++)
+            if (l->pages[i].used)
+                *pageSlot(pages, cap, l->pages[i].tile) = l->pages[i];
+        free(l->pages);
+        l->pages    = pages;
+        l->pagesCap = cap;
+    }
+
+    struct pagerLoadPage * page = pageSlot(l->pages, l->pagesCap, t);
+    if (!page->used) {
+        page->used = 1;
+        page->tile = t;
+        l->pagesLen++;
+        pagedAdd(l->pager, t);
+    }
+    return page;
+}
+
+/**
+ * Appends everything gathered to the page files, one open per tile.
+ */
+static void loadFlush(struct pagerLoad * l) {
+    char path[1024];
+
+    for (uint32_t i = 0; i < l->pagesCap; i++) {
+        struct pagerLoadPage * page = &l->pages[i];
+        if (!page->used || page->len == 0)
+            continue;
+
+        tilePath(l->pager, page->tile, path, sizeof(path));
+        FILE * f = fopen(path, "ab");
+        if (f == NULL || fwrite(page->data, 1, page->len, f) != page->len) {
+            fprintf(stderr, "Could not page out to %s\n", path);
+            l->failed = 1;
+        }
+        if (f != NULL && fclose(f) != 0)
+            l->failed = 1;
+        free(page->data);
+        page->data = NULL;
+        page->len  = 0;
+        page->cap  = 0;
+    }
+    l->buffered = 0;
+}
+
+/**
+ * Gathers a tagged record and its label for a tile's page, writing every
+ * page out once PAGER_LOAD_BUFFER bytes are waiting.
+ */
+static void loadAppend(struct pagerLoad * l, struct pagerTile t, uint8_t tag,
+  const void * rec, uint32_t size, const char * label, uint32_t labelLen) {
+    struct pagerLoadPage * page = loadPage(l, t);
+    uint32_t               n    = 1 + size + labelLen;
+
+    if (page->len + n > page->cap) {
+        while (page->len + n > page->cap)
+            page->cap = page->cap ? page->cap * 2 : 256;
+        page->data = realloc(page->data, page->cap);
+    }
+    page->data[page->len] = tag;
+    memcpy(page->data + page->len + 1, rec, size);
+    if (labelLen > 0)
+        memcpy(page->data + page->len + 1 + size, label, labelLen);
+    page->len   += n;
+    l->buffered += n;
+    if (l->buffered >= PAGER_LOAD_BUFFER)
+        loadFlush(l);
+}
+
+static struct handle loadObject(struct handle saved, struct object obj,
+  void * ctx) {
+    struct pagerLoad * l     = ctx;
+    struct pager *     pager = l->pager;
+    struct pagerTile   t     = {
+        floorDiv(obj.y, pager->tileSize), floorDiv(obj.x, pager->tileSize)
+    };
+    struct handle      h;
+
+    if (!inRegion(l->keep, t)) {
+        h = objectStoreReserve(l->objs, saved);
+
+        struct pageObject rec = objectRecord(h, obj);
+        loadAppend(l, t, PAGE_OBJECT, &rec, sizeof(rec), obj.label,
+          rec.labelLen);
+        setHome(pager, h, t, obj.y, obj.x);
+        pager->evicted++;
+        if (l->handler->paged)
+            l->handler->paged(h, obj.y, obj.x, l->ctx);
+        return h;
+    }
+
+    obj.label = stringArenaIntern(l->labels, obj.label);
+    h         = NULL_HANDLE;
+    if (saved.index != STORE_NONE)
+        h = objectStoreAddAt(l->objs, saved, obj);
+    if (handleEqual(h, NULL_HANDLE))
+        h = objectStoreAdd(l->objs, obj);
+    return h;
+} /* loadObject */
+
+static void loadConnection(struct connection con, void * ctx) {
+    struct pagerLoad * l    = ctx;
+    int                src  = objectStoreDense(l->objs, con.src) != STORE_NONE;
+    int                dest = objectStoreDense(l->objs, con.dest) != STORE_NONE;
+
+    if (src && dest) {
+        con.label = stringArenaIntern(l->labels, con.label);
+        connectionStoreAdd(l->cons, con);
+        return;
+    }
+
+    // With the first end that is paged out, as if it had been evicted
+    struct pagerHome *    home = pagedHome(l->pager, src ? con.dest : con.src);
+    struct pageConnection rec  = connectionRecord(con);
+    if (home == NULL)
+        return;
+    loadAppend(l, home->tile, PAGE_CONNECTION, &rec, sizeof(rec), con.label,
+      rec.labelLen);
+}
+
+int pagerLoadScene(struct pager * pager, const char * path,
+  struct objectStore * objs, struct connectionStore * cons,
+  struct stringArena * labels, const struct pagerHandler * handler,
+  void * ctx, int y, int x, int h, int w) {
+    static const struct sceneSink sink = {
+        .object     = loadObject,
+        .connection = loadConnection
+    };
+    struct pagerLoad l = {
+        .pager   = pager,
+        .objs    = objs,
+        .cons    = cons,
+        .labels  = labels,
+        .handler = handler,
+        .ctx     = ctx,
+        .keep    = regionFor(pager, y, x, h, w)
+    };
+
+    pager->kept      = l.keep;
+    pager->keptValid = 1;
+
+    int err = sceneLoadWith(path, &sink, &l, NULL);
+    loadFlush(&l);
+    free(l.pages);
+    return err != 0 || l.failed ? -1 : 0;
+} /* pagerLoadScene */
+
+static void saveObject(struct handle h, struct object obj, void * ctx) {
+    sceneWriterObject(ctx, h, obj);
+}
+
+static void saveConnection(struct connection con, int srcY, int srcX,
+  int destY, int destX, void * ctx) {
+    sceneWriterConnection(ctx, con);
+}
+
+int pagerSaveScene(struct pager * pager, const char * path,
+  struct objectStore * objs, struct connectionStore * cons,
+  uint32_t checkpoint) {
+    static const struct pagerVisitor objects = { .object = saveObject };
+    static const struct pagerVisitor connections = {
+        .connection = saveConnection
+    };
+    struct sceneWriter w;
+
+    if (sceneWriterOpen(&w, path, checkpoint) != 0)
+        return -1;
+
+    // Every object, in memory or not, before the first connection
+    for (uint32_t i = 0; i < objs->len; i++)
+        sceneWriterObject(&w, objectStoreHandle(objs, i),
+          storedObject(objs, i));
+    pagerWalk(pager, objs, &objects, &w);
+    for (uint32_t i = 0; i < cons->len; i++)
+        sceneWriterConnection(&w, storedConnection(cons, i));
+    pagerWalk(pager, objs, &connections, &w);
+
+    return sceneWriterClose(&w);
+}
@@ -0,0 +1,422 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pathfind.h"
+#include "timing.h"
+
+#ifdef PATH_THREADS
+# define LOCK(finder)   pthread_mutex_lock(&(finder)->lock)
+# define UNLOCK(finder) pthread_mutex_unlock(&(finder)->lock)
+#else
+# define LOCK(finder)
+# define UNLOCK(finder)
+#endif
+
+/*****************************************************************************
+* Snapshot
+*****************************************************************************/
+
+/**
+ * Copies what the search needs out of the stores. Every field is copied a
+ * chunk at a time, so this is a handful of memcpy()s per 4096 objects or
+ * connections.
+ */
+static struct pathSearch * takeSnapshot(struct objectStore * objs,
+  struct connectionStore * cons, struct handle start, struct handle goal) {
+    struct pathSearch * s = calloc(1, sizeof(struct pathSearch));
+    uint32_t            n = objs->len;
+    uint32_t            e = cons->len;
+
+    s->nodeCount  = n;
+    s->nodeSlot   = malloc((n + 1) * sizeof(uint32_t));
+    s->y          = malloc((n + 1) * sizeof(int));
+    s->x          = malloc((n + 1) * sizeof(int));
+    s->slotCount  = objs->slots.len;
+    s->generation = malloc((s->slotCount + 1) * sizeof(uint32_t));
+    s->edgeCount  = e;
+    s->edgeSrc    = malloc((e + 1) * sizeof(struct handle));
+    s->edgeDest   = malloc((e + 1) * sizeof(struct handle));
+    s->start      = start;
+    s->goal       = goal;
+
+    for (uint32_t c = 0; c < STORE_CHUNKS_USED(n); c++) {
+        uint32_t             base  = c << STORE_CHUNK_SHIFT;
+        uint32_t             len   = STORE_CHUNK_LEN(n, c);
+        struct objectChunk * chunk = objs->chunks[c];
+        memcpy(&s->nodeSlot[base], chunk->slot, len * sizeof(uint32_t));
+        memcpy(&s->y[base], chunk->y, len * sizeof(int));
+        memcpy(&s->x[base], chunk->x, len * sizeof(int));
+    }
+    memcpy(s->generation, objs->slots.generation,
+      s->slotCount * sizeof(uint32_t));
+
+    for (uint32_t c = 0; c < STORE_CHUNKS_USED(e); c++) {
+        uint32_t                 base  = c << STORE_CHUNK_SHIFT;
+        uint32_t                 len   = STORE_CHUNK_LEN(e, c);
+        struct connectionChunk * chunk = cons->chunks[c];
+        memcpy(&s->edgeSrc[base], chunk->src, len * sizeof(struct handle));
+        memcpy(&s->edgeDest[base], chunk->dest, len * sizeof(struct handle));
+    }
+    return s;
+} /* takeSnapshot */
+
+static void freeSearch(struct pathSearch * s) {
+    free(s->nodeSlot);
+    free(s->y);
+    free(s->x);
+    free(s->generation);
+    free(s->edgeSrc);
+    free(s->edgeDest);
+    free(s->offsets);
+    free(s->neighbors);
+    free(s->nodeOfSlot);
+    free(s->cursor);
+    free(s->g);
+    free(s->from);
+    free(s->closed);
+    free(s->heap);
+    free(s);
+}
+
+/*****************************************************************************
+* Search
+*****************************************************************************/
+
+static float distance(struct pathSearch * s, uint32_t a, uint32_t b) {
+    return hypotf(s->y[a] - s->y[b], s->x[a] - s->x[b]);
+}
+
+static void heapPush(struct pathSearch * s, float f, uint32_t node) {
+    if (s->heapLen == s->heapCap) {
+        s->heapCap = s->heapCap ? s->heapCap * 2 : 1024;
+        s->heap    = realloc(s->heap,
+          s->heapCap * sizeof(struct pathHeapEntry));
+    }
+
+    uint32_t i = s->heapLen++;
+    while (i > 0 && s->heap[(i - 1) / 2].f > f) {
+        s->heap[i] = s->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    s->heap[i] = (struct pathHeapEntry) { f, node };
+}
+
+static uint32_t heapPop(struct pathSearch * s) {
+    uint32_t             top  = s->heap[0].node;
+    struct pathHeapEntry last = s->heap[--s->heapLen];
+    uint32_t             i    = 0;
+
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= s->heapLen)
+            break;
+        if (child + 1 < s->heapLen && s->heap[child + 1].f < s->heap[child].f)
+            child++;
+        if (s->heap[child].f >= last.f)
+            break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    if (s->heapLen > 0)
+        s->heap[i] = last;
+    return top;
+}
+
+/**
+ * Returns the node of an object, or STORE_NONE if it was gone or paged out
+ * at the time of the snapshot.
+ */
+static uint32_t nodeOf(struct pathSearch * s, const uint32_t * nodeOfSlot,
+  struct handle h) {
+    if (h.index >= s->slotCount || s->generation[h.index] != h.generation)
+        return STORE_NONE;
+    return nodeOfSlot[h.index];
+}
+
+/**
+ * Returns where a slice of budget items starting at at ends, in len items.
+ */
+static uint32_t sliceEnd(uint32_t at, uint32_t budget, uint32_t len) {
+    return len - at > budget ? at + budget : len;
+}
+
+/**
+ * Builds the neighbours of every node from the snapshot's connections, in
+ * both directions, a slice of up to budget nodes or connections at a time,
+ * and sets up the search from the start node at the end. Returns 1 once
+ * the graph is built.
+ */
+static int buildStep(struct pathSearch * s, uint32_t budget) {
+    uint32_t n   = s->nodeCount;
+    uint32_t at  = s->stageAt;
+    uint32_t len = n;
+    uint32_t end = 0;
+
+    switch (s->stage) {
+    case PATH_BUILD_NODES:
+        if (at == 0) {
+            s->nodeOfSlot = malloc((s->slotCount + 1) * sizeof(uint32_t));
+            memset(s->nodeOfSlot, 0xff, s->slotCount * sizeof(uint32_t));
+            s->g = malloc((n + 1) * sizeof(float));
+        }
+        end = sliceEnd(at, budget, len);
+        for (uint32_t i = at; i < end; i++) {
+            s->nodeOfSlot[s->nodeSlot[i]] = i;
+            s->g[i] = INFINITY;
+        }
+        break;
+
+    case PATH_BUILD_COUNT:
+        if (at == 0)
+            s->offsets = calloc(n + 2, sizeof(uint32_t));
+        len = s->edgeCount;
+        end = sliceEnd(at, budget, len);
+        for (uint32_t c = at; c < end; c++) {
+            uint32_t a = nodeOf(s, s->nodeOfSlot, s->edgeSrc[c]);
+            uint32_t b = nodeOf(s, s->nodeOfSlot, s->edgeDest[c]);
+            if (a == STORE_NONE || b == STORE_NONE || a == b)
+                continue;
+            s->offsets[a + 1]++;
+            s->offsets[b + 1]++;
+        }
+        break;
+
+    case PATH_BUILD_SUM:
+        end = sliceEnd(at, budget, len);
+        for (uint32_t i = at; i < end; i++)
+            s->offsets[i + 1] += s->offsets[i];
+        break;
+
+    case PATH_BUILD_FILL:
+        if (at == 0) {
+            s->cursor = malloc((n + 1) * sizeof(uint32_t));
+            memcpy(s->cursor, s->offsets, (n + 1) * sizeof(uint32_t));
+            s->neighbors = malloc((s->offsets[n] + 1) * sizeof(uint32_t));
+        }
+        len = s->edgeCount;
+        end = sliceEnd(at, budget, len);
+        for (uint32_t c = at; c < end; c++) {
+            uint32_t a = nodeOf(s, s->nodeOfSlot, s->edgeSrc[c]);
+            uint32_t b = nodeOf(s, s->nodeOfSlot, s->edgeDest[c]);
+            if (a == STORE_NONE || b == STORE_NONE || a == b)
+                continue;
+            s->neighbors[s->cursor[a]++] = b;
+            s->neighbors[s->cursor[b]++] = a;
+        }
+        break;
+
+    case PATH_BUILD_DONE:
+        return 1;
+    } /* switch */
+
+    s->stageAt = end;
+    if (end < len)
+        return 0;
+    s->stageAt = 0;
+    if (++s->stage < PATH_BUILD_DONE)
+        return 0;
+
+    s->startNode = nodeOf(s, s->nodeOfSlot, s->start);
+    s->goalNode  = nodeOf(s, s->nodeOfSlot, s->goal);
+    free(s->nodeOfSlot);
+    free(s->cursor);
+    s->nodeOfSlot = NULL;
+    s->cursor     = NULL;
+
+    s->from   = malloc((n + 1) * sizeof(uint32_t));
+    s->closed = calloc(n + 1, 1);
+    if (s->startNode != STORE_NONE && s->goalNode != STORE_NONE) {
+        s->g[s->startNode]    = 0;
+        s->from[s->startNode] = STORE_NONE;
+        heapPush(s, distance(s, s->startNode, s->goalNode), s->startNode);
+    }
+    return 1;
+} /* buildStep */
+
+/**
+ * Expands up to budget nodes, or builds a slice of the graph while it is
+ * not built yet. Returns 1 once the search is over, found or not.
+ */
+static int searchStep(struct pathSearch * s, uint32_t budget) {
+    if (s->stage != PATH_BUILD_DONE)
+        return buildStep(s, PATH_BUILD_BUDGET) && s->heapLen == 0;
+
+    for (uint32_t b = 0; b < budget; b++) {
+        if (s->heapLen == 0)
+            return 1;
+
+        // Nodes are pushed again when a shorter way to them turns up, and
+        // the stale entries skipped here
+        uint32_t node = heapPop(s);
+        if (s->closed[node])
+            continue;
+        s->closed[node] = 1;
+        s->expanded++;
+
+        if (node == s->goalNode) {
+            s->found = 1;
+            return 1;
+        }
+
+        for (uint32_t e = s->offsets[node]; e < s->offsets[node + 1]; e++) {
+            uint32_t next = s->neighbors[e];
+            if (s->closed[next])
+                continue;
+
+            float g = s->g[node] + distance(s, node, next);
+            if (g < s->g[next]) {
+                s->g[next]    = g;
+                s->from[next] = node;
+                heapPush(s, g + distance(s, next, s->goalNode), next);
+            }
+        }
+    }
+    return 0;
+} /* searchStep */
+
+#ifdef PATH_THREADS
+static void * searchMain(void * arg) {
+    struct pathFinder * finder = arg;
+    struct pathSearch * s      = finder->search;
+
+    for (;;) {
+        int done = searchStep(s, PATH_STEP_BUDGET);
+
+        LOCK(finder);
+        if (done || s->cancel) {
+            s->seconds  = monotonicSeconds() - s->startTime;
+            s->finished = 1;
+            UNLOCK(finder);
+            return NULL;
+        }
+        UNLOCK(finder);
+    }
+}
+#endif /* ifdef PATH_THREADS */
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+void pathFinderInit(struct pathFinder * finder) {
+    memset(finder, 0, sizeof(*finder));
+    finder->state = PATH_IDLE;
+    #ifdef PATH_THREADS
+        pthread_mutex_init(&finder->lock, NULL);
+    #endif
+}
+
+/**
+ * Stops the search in flight, if any, and waits for its thread.
+ */
+static void cancelSearch(struct pathFinder * finder) {
+    if (finder->search == NULL)
+        return;
+
+    #ifdef PATH_THREADS
+        if (finder->threaded) {
+            LOCK(finder);
+            finder->search->cancel = 1;
+            UNLOCK(finder);
+            pthread_join(finder->thread, NULL);
+            finder->threaded = 0;
+        }
+    #endif
+    freeSearch(finder->search);
+    finder->search = NULL;
+}
+
+void pathFinderClear(struct pathFinder * finder) {
+    cancelSearch(finder);
+    finder->state    = PATH_IDLE;
+    finder->routeLen = 0;
+    finder->length   = 0;
+}
+
+void pathFinderFree(struct pathFinder * finder) {
+    pathFinderClear(finder);
+    free(finder->route);
+    finder->route    = NULL;
+    finder->routeCap = 0;
+    #ifdef PATH_THREADS
+        pthread_mutex_destroy(&finder->lock);
+    #endif
+}
+
+void pathFinderStart(struct pathFinder * finder, struct objectStore * objs,
+  struct connectionStore * cons, struct handle start, struct handle goal) {
+    pathFinderClear(finder);
+
+    finder->search            = takeSnapshot(objs, cons, start, goal);
+    finder->search->startTime = monotonicSeconds();
+    finder->state             = PATH_SEARCHING;
+    #ifdef PATH_THREADS
+        // Without a thread pathFinderPoll() searches in slices instead
+        finder->threaded = pthread_create(&finder->thread, NULL, searchMain,
+          finder) == 0;
+    #endif
+}
+
+/**
+ * Copies the route out of a finished search, walking back from the goal.
+ */
+static void takeRoute(struct pathFinder * finder, struct pathSearch * s) {
+    finder->expanded = s->expanded;
+    finder->seconds  = s->seconds;
+    finder->routeLen = 0;
+    if (!s->found) {
+        finder->state = PATH_NOT_FOUND;
+        return;
+    }
+
+    uint32_t len = 0;
+    for (uint32_t node = s->goalNode; node != STORE_NONE; node = s->from[node])
+        len++;
+    if (len > finder->routeCap) {
+        finder->routeCap = len;
+        finder->route    = realloc(finder->route,
+          len * sizeof(struct handle));
+    }
+
+    uint32_t i = len;
+    for (uint32_t node = s->goalNode; node != STORE_NONE;
+      node = s->from[node]) {
+        uint32_t slot = s->nodeSlot[node];
+        finder->route[--i] = (struct handle) { slot, s->generation[slot] };
+    }
+    finder->routeLen = len;
+    finder->length   = s->g[s->goalNode];
+    finder->state    = PATH_FOUND;
+}
+
+int pathFinderPoll(struct pathFinder * finder) {
+    struct pathSearch * s = finder->search;
+
+    if (s == NULL)
+        return 0;
+
+    #ifdef PATH_THREADS
+        if (finder->threaded) {
+            LOCK(finder);
+            int finished = s->finished;
+            UNLOCK(finder);
+            if (!finished)
+                return 0;
+            pthread_join(finder->thread, NULL);
+            finder->threaded = 0;
+        }
+    #endif
+    if (!s->finished) {
+        // No thread: search a slice right here, once per frame
+        if (!searchStep(s, PATH_STEP_BUDGET))
+            return 0;
+        s->seconds  = monotonicSeconds() - s->startTime;
+        s->finished = 1;
+    }
+
+    takeRoute(finder, s);
+    freeSearch(s);
+    finder->search = NULL;
+    return 1;
+} /* pathFinderPoll */
@@ -0,0 +1,54 @@
+#include "pick.h"
+
+struct hitTest {
+    struct objectStore * objs;
+
+    // World position being tested
+    int                  y, x;
+
+    // Collision margin in world units
+    float                margin;
+
+    // Lowest slot hit so far, or -1
+    int                  hit;
+};
+
+static void hitTestVisitor(int id, void * ctx) {
+    struct hitTest * test = ctx;
+
+    // The lowest slot wins, so the pick doesn't depend on the order the
+    // grid visits cells in. Slots are reused, so this is not the oldest
+    // object.
+    if (test->hit != -1 && id > test->hit)
+        return;
+
+    // Compare squared distances to skip the sqrt
+    uint32_t i      = test->objs->slots.dense[id];
+    float    yDelta = OBJECT_FIELD(test->objs, y, i) - test->y;
+    float    xDelta = OBJECT_FIELD(test->objs, x, i) - test->x;
+    float    reach  = OBJECT_FIELD(test->objs, radius, i) + test->margin;
+
+    // Check if within that distance allowing a certain margin of error
+    if ((yDelta * yDelta) + (xDelta * xDelta) < reach * reach)
+        test->hit = id;
+}
+
+struct handle pickObject(struct spatialGrid * grid, struct objectStore * objs,
+  int y, int x, float margin, int maxRadius) {
+    struct hitTest test = {
+        .objs   = objs,
+        .y      = y,
+        .x      = x,
+        .margin = margin,
+        .hit    = -1
+    };
+    int reach = maxRadius + margin + 1;
+
+    // Only the cells an object could reach the position from are looked at
+    spatialGridQuery(grid, y - reach, x - reach, y + reach, x + reach,
+      hitTestVisitor, &test);
+
+    if (test.hit == -1)
+        return NULL_HANDLE;
+    return objectStoreSlotHandle(objs, test.hit);
+}
@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "pngwriter.h"
+
+#define FILTER_SUB  1
+#define MAX_MATCH   258
+#define END_OF_DATA 256
+
+// First length and extra bits of each deflate length code from 257 on
+static const uint16_t lengthBase[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0
+};
+
+static uint32_t crcTable[256];
+
+static void buildCrcTable() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crcUpdate(uint32_t crc, const uint8_t * data, size_t len) {
+    for (size_t i = 0; i < len; i++)
+        crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static void putBigEndian(uint8_t * out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+static void writeChunk(FILE * f, const char * type, const uint8_t * data,
+  uint32_t len) {
+    uint8_t header[8];
+
+    putBigEndian(header, len);
+    memcpy(header + 4, type, 4);
+    fwrite(header, 1, 8, f);
+
+    // IEND has no data, and fwrite() wants a buffer even for no bytes
+    if (len > 0)
+        fwrite(data, 1, len, f);
+
+    uint8_t crc[4];
+    putBigEndian(crc, ~crcUpdate(crcUpdate(0xffffffffu, header + 4, 4),
+      data, len));
+    fwrite(crc, 1, 4, f);
+}
+
+/*****************************************************************************
+* Deflate
+*****************************************************************************/
+
+static void flushIdat(struct pngWriter * png) {
+    if (png->idatLen == 0)
+        return;
+    writeChunk(png->file, "IDAT", png->idat, png->idatLen);
+    png->idatLen = 0;
+}
+
+static void putByte(struct pngWriter * png, uint8_t byte) {
+    if (png->idatLen == PNG_IDAT_SIZE)
+        flushIdat(png);
+    png->idat[png->idatLen++] = byte;
+}
+
+/**
+ * Adds count bits of value to the stream, least significant first.
+ */
+static void putBits(struct pngWriter * png, uint32_t value, int count) {
+    png->bits     |= (uint64_t) value << png->bitCount;
+    png->bitCount += count;
+    while (png->bitCount >= 8) {
+        putByte(png, png->bits & 0xff);
+        png->bits    >>= 8;
+        png->bitCount -= 8;
+    }
+}
+
+/**
+ * Adds a Huffman code, which deflate stores most significant bit first.
+ */
+static void putCode(struct pngWriter * png, uint32_t code, int length) {
+    uint32_t reversed = 0;
+
+    for (int i = 0; i < length; i++)
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    putBits(png, reversed, length);
+}
+
+/**
+ * Adds a literal/length symbol with its fixed Huffman code.
+ */
+static void putSymbol(struct pngWriter * png, uint32_t symbol) {
+    if (symbol < 144)
+        putCode(png, 0x30 + symbol, 8);
+    else if (symbol < 256)
+        putCode(png, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        putCode(png, symbol - 256, 7);
+    else
+        putCode(png, 0xc0 + symbol - 280, 8);
+}
+
+/**
+ * Adds a copy of the previous byte, length times.
+ */
+static void putRepeat(struct pngWriter * png, uint32_t length) {
+    int code = 0;
+
+    while (code < 28 && lengthBase[code + 1] <= length)
+        code++;
+    putSymbol(png, 257 + code);
+    putBits(png, length - lengthBase[code], lengthExtra[code]);
+
+    // Distance 1 is distance code 0, with no extra bits
+    putCode(png, 0, 5);
+}
+
+/**
+ * Encodes the repeats of the previous byte seen so far.
+ */
+static void flushRun(struct pngWriter * png) {
+    if (png->run >= 3) {
+        putRepeat(png, png->run);
+    } else {
+        for (uint32_t i = 0; i < png->run; i++)
+            putSymbol(png, png->last);
+    }
+    png->run = 0;
+}
+
+static void deflateBytes(struct pngWriter * png, const uint8_t * data,
+  size_t len) {
+    uint32_t a = png->adler & 0xffff;
+    uint32_t b = png->adler >> 16;
+
+    for (size_t i = 0; i < len; i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+
+        if (data[i] == png->last) {
+            if (++png->run == MAX_MATCH)
+                flushRun(png);
+            continue;
+        }
+        flushRun(png);
+        putSymbol(png, data[i]);
+        png->last = data[i];
+    }
+    png->adler = b << 16 | a;
+}
+
+/*****************************************************************************
+* Functions Provided
+*****************************************************************************/
+
+int pngWriterOpen(struct pngWriter * png, const char * path, uint32_t width,
+  uint32_t height) {
+    static const uint8_t signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+    };
+
+    memset(png, 0, sizeof(*png));
+    if (crcTable[1] == 0)
+        buildCrcTable();
+
+    png->file = fopen(path, "wb");
+    if (png->file == NULL)
+        return -1;
+    png->width    = width;
+    png->height   = height;
+    png->last     = -1;
+    png->adler    = 1;
+    png->filtered = malloc((size_t) width * 3 + 1);
+
+    // 8 bits per channel, RGB, no interlacing
+    uint8_t ihdr[13] = { 0 };
+    putBigEndian(ihdr, width);
+    putBigEndian(ihdr + 4, height);
+    ihdr[8] = 8;
+    ihdr[9] = 2;
+    fwrite(signature, 1, sizeof(signature), png->file);
+    writeChunk(png->file, "IHDR", ihdr, sizeof(ihdr));
+
+    // zlib header for a 32K window, then a single final block with the
+    // fixed codes
+    putByte(png, 0x78);
+    putByte(png, 0x01);
+    putBits(png, 1, 1);
+    putBits(png, 1, 2);
+    return 0;
+} /* pngWriterOpen */
+
+void pngWriterRow(struct pngWriter * png, const uint8_t * rgb) {
+    uint8_t * out = png->filtered;
+    size_t    len = (size_t) png->width * 3;
+
+    out[0] = FILTER_SUB;
+    for (size_t i = 0; i < len; i++)
+        out[i + 1] = rgb[i] - (i >= 3 ? rgb[i - 3] : 0);
+    deflateBytes(png, out, len + 1);
+    png->rows++;
+}
+
+int pngWriterClose(struct pngWriter * png) {
+    flushRun(png);
+    putSymbol(png, END_OF_DATA);
+    if (png->bitCount > 0)
+        putBits(png, 0, 8 - png->bitCount);
+
+    uint8_t adler[4];
+    putBigEndian(adler, png->adler);
+    for (int i = 0; i < 4; i++)
+        putByte(png, adler[i]);
+    flushIdat(png);
+    writeChunk(png->file, "IEND", NULL, 0);
+
+    int err = ferror(png->file) || png->rows != png->height;
+    if (fclose(png->file) != 0)
+        err = 1;
+    free(png->filtered);
+    png->file     = NULL;
+    png->filtered = NULL;
+    return err ? -1 : 0;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "timing.h"
+
+// Rows are flushed to the CSV file this often, in frames
+#define CSV_FLUSH_FRAMES 60
+
+static const char * phaseNames[PHASE_COUNT] = {
+    "input", "cull", "gridlines", "connections", "objects", "labels", "blit",
+    "frame"
+};
+
+// When each phase was last started, and its total so far this frame
+static uint64_t started[PHASE_COUNT];
+static uint64_t current[PHASE_COUNT];
+
+// Ring buffer of finished frames, in milliseconds
+static float    window[PHASE_COUNT][PROFILE_WINDOW];
+static uint32_t frames = 0;
+
+static FILE * csv = NULL;
+
+void profilerBegin(enum profilePhase phase) {
+    started[phase] = monotonicNanos();
+}
+
+void profilerEnd(enum profilePhase phase) {
+    current[phase] += monotonicNanos() - started[phase];
+}
+
+void profilerEndFrame(void) {
+    uint32_t slot = frames % PROFILE_WINDOW;
+
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        window[p][slot] = current[p] * 1e-6f;
+        current[p]      = 0;
+    }
+
+    if (csv != NULL) {
+        fprintf(csv, "%u", frames);
+        for (int p = 0; p < PHASE_COUNT; p++)
+            fprintf(csv, ",%.4f", window[p][slot]);
+        fputc('\n', csv);
+        if (frames % CSV_FLUSH_FRAMES == 0)
+            fflush(csv);
+    }
+
+    frames++;
+}
+
+static int compareFloats(const void * a, const void * b) {
+    float x = *(const float *) a;
+    float y = *(const float *) b;
+
+    return (x > y) - (x < y);
+}
+
+void profilerStats(enum profilePhase phase, struct phaseStats * stats) {
+    uint32_t n = frames < PROFILE_WINDOW ? frames : PROFILE_WINDOW;
+    float    sorted[PROFILE_WINDOW];
+
+    memset(stats, 0, sizeof(*stats));
+    if (n == 0)
+        return;
+
+    memcpy(sorted, window[phase], n * sizeof(float));
+    qsort(sorted, n, sizeof(float), compareFloats);
+
+    float sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+        sum += sorted[i];
+
+    stats->min  = sorted[0];
+    stats->avg  = sum / n;
+    stats->p99  = sorted[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1];
+    stats->last = window[phase][(frames - 1) % PROFILE_WINDOW];
+}
+
+const char * profilerPhaseName(enum profilePhase phase) {
+    return phaseNames[phase];
+}
+
+int profilerOpenCsv(const char * path) {
+    profilerCloseCsv();
+    csv = fopen(path, "w");
+    if (csv == NULL)
+        return -1;
+
+    fprintf(csv, "frame");
+    for (int p = 0; p < PHASE_COUNT; p++)
+        fprintf(csv, ",%s_ms", phaseNames[p]);
+    fputc('\n', csv);
+    return 0;
+}
+
+void profilerCloseCsv(void) {
+    if (csv != NULL)
+        fclose(csv);
+    csv = NULL;
+}
@@ -0,0 +1,26 @@
+#include "redraw.h"
+
+// Start dirty so the first frame gets drawn
+static int dirtyFlags = REDRAW_ALL;
+static enum redrawMode mode = REDRAW_ON_DEMAND;
+
+void markDirty(int flags) {
+    dirtyFlags |= flags;
+}
+
+int isDirty(int flags) {
+    return mode == REDRAW_ALWAYS || (dirtyFlags & flags) != 0;
+}
+
+void clearDirty(void) {
+    dirtyFlags = REDRAW_NONE;
+}
+
+void setRedrawMode(enum redrawMode newMode) {
+    mode = newMode;
+    markDirty(REDRAW_ALL);
+}
+
+enum redrawMode getRedrawMode(void) {
+    return mode;
+}
@@ -0,0 +1,576 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __unix__
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "scenefile.h"
+
+_Static_assert(sizeof(struct sceneHeader) == 32, "scene header size");
+_Static_assert(sizeof(struct sceneObjectRecord) == 32, "object record size");
+_Static_assert(sizeof(struct sceneConnectionRecord) == 20,
+  "connection record size");
+
+/*****************************************************************************
+* Reading
+*****************************************************************************/
+
+/**
+ * A read-only view of a whole file, memory mapped where possible.
+ */
+struct fileView {
+    const uint8_t * data;
+    size_t          size;
+    int             mapped;
+};
+
+static int openView(const char * path, struct fileView * view) {
+    view->data   = NULL;
+    view->size   = 0;
+    view->mapped = 0;
+
+    #ifdef __unix__
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return -1;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void * p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                // Records are read once front to back
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                view->data   = p;
+                view->size   = st.st_size;
+                view->mapped = 1;
+            }
+        }
+        close(fd);
+        if (view->mapped)
+            return 0;
+    #endif /* ifdef __unix__ */
+
+    // No mmap (or it failed): read the file into memory instead
+    FILE * f = fopen(path, "rb");
+    if (f == NULL)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t * buf = size > 0 ? malloc(size) : NULL;
+    if (buf == NULL || fread(buf, 1, size, f) != (size_t) size) {
+        free(buf);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    view->data = buf;
+    view->size = size;
+    return 0;
+} /* openView */
+
+static void closeView(struct fileView * view) {
+    #ifdef __unix__
+        if (view->mapped) {
+            munmap((void *) view->data, view->size);
+            return;
+        }
+    #endif
+    free((void *) view->data);
+}
+
+static Color unpackColor(uint32_t packed) {
+    Color c;
+
+    memcpy(&c, &packed, sizeof(c));
+    return c;
+}
+
+/**
+ * The parts of a scene file, once checked.
+ */
+struct sceneParts {
+    const struct sceneHeader *           header;
+    const uint8_t *                      objRecs;
+    size_t                               recordBytes;
+    const struct sceneConnectionRecord * conRecs;
+    const char *                         strings;
+};
+
+/**
+ * Checks the whole file, so that nothing is loaded from a bad one. Returns
+ * 0 and fills in parts if it is a valid scene file.
+ */
+static int checkScene(struct fileView * view, struct sceneParts * parts) {
+    const struct sceneHeader * header = (const void *) view->data;
+
+    if (view->size < sizeof(*header)
+      || memcmp(header->magic, SCENE_MAGIC, 4) != 0
+      || header->version < 1 || header->version > SCENE_VERSION)
+        return -1;
+
+    size_t recordBytes = header->version == 1 ? SCENE_V1_OBJECT_BYTES :
+      sizeof(struct sceneObjectRecord);
+    uint64_t objectBytes = (uint64_t) header->objectCount * recordBytes;
+    uint64_t connectionBytes = (uint64_t) header->connectionCount *
+      sizeof(struct sceneConnectionRecord);
+    if (sizeof(*header) + objectBytes + connectionBytes + header->stringBytes
+      > view->size)
+        return -1;
+
+    const uint8_t * objRecs = view->data + sizeof(*header);
+    const struct sceneConnectionRecord * conRecs =
+      (const void *) (objRecs + objectBytes);
+    const char * strings = (const char *) conRecs + connectionBytes;
+
+    // Labels must land inside the string table, which must end in a NUL so
+    // that no label can run off the end
+    if (header->stringBytes > 0 && strings[header->stringBytes - 1] != '\0')
+        return -1;
+    for (uint32_t i = 0; i < header->objectCount; i++) {
+        const struct sceneObjectRecord * r =
+          (const void *) (objRecs + i * recordBytes);
+        if (r->label != SCENE_NO_LABEL && r->label >= header->stringBytes)
+            return -1;
+    }
+    for (uint32_t i = 0; i < header->connectionCount; i++)
+        if (conRecs[i].src >= header->objectCount
+          || conRecs[i].dest >= header->objectCount
+          || (conRecs[i].label != SCENE_NO_LABEL
+          && conRecs[i].label >= header->stringBytes))
+            return -1;
+
+    parts->header      = header;
+    parts->objRecs     = objRecs;
+    parts->recordBytes = recordBytes;
+    parts->conRecs     = conRecs;
+    parts->strings     = strings;
+    return 0;
+} /* checkScene */
+
+static const char * labelIn(const struct sceneParts * parts,
+  uint32_t offset) {
+    return offset == SCENE_NO_LABEL ? NULL : parts->strings + offset;
+}
+
+int sceneCheck(const char * path) {
+    struct fileView   view;
+    struct sceneParts parts;
+
+    if (openView(path, &view) != 0)
+        return -1;
+
+    int err = checkScene(&view, &parts);
+    closeView(&view);
+    return err;
+}
+
+int sceneLoadWith(const char * path, const struct sceneSink * sink,
+  void * ctx, uint32_t * checkpoint) {
+    struct fileView   view;
+    struct sceneParts parts;
+
+    if (openView(path, &view) != 0)
+        return -1;
+    if (checkScene(&view, &parts) != 0) {
+        closeView(&view);
+        return -1;
+    }
+
+    const struct sceneHeader * header = parts.header;
+
+    // Handles of the objects added, by record index, for the connections
+    struct handle * handles = malloc(
+        (header->objectCount + 1) * sizeof(struct handle));
+
+    for (uint32_t i = 0; i < header->objectCount; i++) {
+        const struct sceneObjectRecord * r =
+          (const void *) (parts.objRecs + i * parts.recordBytes);
+        struct object obj = {
+            .type   = r->type,
+            .sticky = r->sticky,
+            .label  = labelIn(&parts, r->label),
+            .radius = r->radius,
+            .color  = unpackColor(r->color),
+            .y      = r->y,
+            .x      = r->x
+        };
+        struct handle saved = header->version >= 2 ?
+          (struct handle) { r->slot, r->generation } : NULL_HANDLE;
+
+        handles[i] = sink->object(saved, obj, ctx);
+    }
+
+    for (uint32_t i = 0; i < header->connectionCount; i++) {
+        const struct sceneConnectionRecord * r = &parts.conRecs[i];
+        if (handles[r->src].index == STORE_NONE
+          || handles[r->dest].index == STORE_NONE)
+            continue;
+        sink->connection((struct connection) {
+            .label = labelIn(&parts, r->label),
+            .width = r->width,
+            .color = unpackColor(r->color),
+            .src   = handles[r->src],
+            .dest  = handles[r->dest]
+        }, ctx);
+    }
+
+    if (checkpoint != NULL)
+        *checkpoint = header->checkpoint;
+    free(handles);
+    closeView(&view);
+    return 0;
+} /* sceneLoadWith */
+
+static const char * labelAt(struct stringArena * labels,
+  const struct sceneParts * parts, uint32_t offset) {
+    return offset == SCENE_NO_LABEL ? NULL :
+           stringArenaIntern(labels, parts->strings + offset);
+}
+
+int sceneLoad(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, struct stringArena * labels,
+  uint32_t * checkpoint) {
+    struct fileView   view;
+    struct sceneParts parts;
+
+    if (openView(path, &view) != 0)
+        return -1;
+    if (checkScene(&view, &parts) != 0) {
+        closeView(&view);
+        return -1;
+    }
+
+    const struct sceneHeader * header = parts.header;
+
+    // Saved handles can only be handed out again in an empty store
+    int restoreHandles = header->version >= 2 && objs->slots.len == 0;
+
+    // Handles of the objects added, by record index, for the connections
+    struct handle * handles = malloc(
+        (header->objectCount + 1) * sizeof(struct handle));
+
+    for (uint32_t i = 0; i < header->objectCount; i++) {
+        const struct sceneObjectRecord * r =
+          (const void *) (parts.objRecs + i * parts.recordBytes);
+        struct object obj = {
+            .type   = r->type,
+            .sticky = r->sticky,
+            .label  = labelAt(labels, &parts, r->label),
+            .radius = r->radius,
+            .color  = unpackColor(r->color),
+            .y      = r->y,
+            .x      = r->x
+        };
+        handles[i] = NULL_HANDLE;
+        if (restoreHandles)
+            handles[i] = objectStoreAddAt(objs,
+                (struct handle) { r->slot, r->generation }, obj);
+
+        // A handle clashing with an earlier record still gets the object in
+        if (handleEqual(handles[i], NULL_HANDLE))
+            handles[i] = objectStoreAdd(objs, obj);
+    }
+
+    for (uint32_t i = 0; i < header->connectionCount; i++) {
+        const struct sceneConnectionRecord * r = &parts.conRecs[i];
+        connectionStoreAdd(cons, (struct connection) {
+            .label = labelAt(labels, &parts, r->label),
+            .width = r->width,
+            .color = unpackColor(r->color),
+            .src   = handles[r->src],
+            .dest  = handles[r->dest]
+        });
+    }
+
+    if (checkpoint != NULL)
+        *checkpoint = header->checkpoint;
+    free(handles);
+    closeView(&view);
+    return 0;
+} /* sceneLoad */
+
+/*****************************************************************************
+* Writing
+*****************************************************************************/
+
+/**
+ * Growable buffer for the string table.
+ */
+struct stringTable {
+    char *   data;
+    uint32_t len;
+    uint32_t cap;
+};
+
+static uint32_t addString(struct stringTable * table, const char * s) {
+    if (s == NULL)
+        return SCENE_NO_LABEL;
+
+    uint32_t n = strlen(s) + 1;
+    if (table->len + n > table->cap) {
+        while (table->len + n > table->cap)
+            table->cap = table->cap ? table->cap * 2 : 4096;
+        table->data = realloc(table->data, table->cap);
+    }
+    memcpy(table->data + table->len, s, n);
+    table->len += n;
+    return table->len - n;
+}
+
+static uint32_t packColor(Color c) {
+    uint32_t packed;
+
+    memcpy(&packed, &c, sizeof(packed));
+    return packed;
+}
+
+static int writeFailed(struct sceneWriter * w, int ok) {
+    if (!ok)
+        w->failed = 1;
+    return !ok;
+}
+
+/**
+ * Appends n bytes to a buffer of SCENE_WRITER_BUFFER bytes, writing it out
+ * to f first if they don't fit.
+ */
+static void writeBuffered(struct sceneWriter * w, FILE * f, uint8_t * buf,
+  size_t * len, const void * data, size_t n) {
+    if (*len + n > SCENE_WRITER_BUFFER) {
+        writeFailed(w, fwrite(buf, 1, *len, f) == *len);
+        *len = 0;
+    }
+    if (n > SCENE_WRITER_BUFFER) {
+        writeFailed(w, fwrite(data, 1, n, f) == n);
+        return;
+    }
+    memcpy(buf + *len, data, n);
+    *len += n;
+}
+
+/**
+ * Appends a label to the string table, returning its offset.
+ */
+static uint32_t writeString(struct sceneWriter * w, const char * s) {
+    if (s == NULL)
+        return SCENE_NO_LABEL;
+
+    uint32_t n = strlen(s) + 1;
+    writeBuffered(w, w->strings, w->labels, &w->labelsLen, s, n);
+    w->header.stringBytes += n;
+    return w->header.stringBytes - n;
+}
+
+int sceneWriterOpen(struct sceneWriter * w, const char * path,
+  uint32_t checkpoint) {
+    *w = (struct sceneWriter) {
+        .path   = path,
+        .header = {
+            .version    = SCENE_VERSION,
+            .checkpoint = checkpoint
+        }
+    };
+    memcpy(w->header.magic, SCENE_MAGIC, 4);
+    snprintf(w->tmpPath, sizeof(w->tmpPath), "%s.tmp", path);
+
+    // Labels go to a scratch file until the records are done, since the
+    // string table comes after them
+    w->file    = fopen(w->tmpPath, "wb");
+    w->strings = tmpfile();
+    if (w->file == NULL || w->strings == NULL
+      || fwrite(&w->header, sizeof(w->header), 1, w->file) != 1) {
+        if (w->file != NULL) {
+            fclose(w->file);
+            remove(w->tmpPath);
+        }
+        if (w->strings != NULL)
+            fclose(w->strings);
+        return -1;
+    }
+    w->records = malloc(SCENE_WRITER_BUFFER);
+    w->labels  = malloc(SCENE_WRITER_BUFFER);
+    return 0;
+} /* sceneWriterOpen */
+
+void sceneWriterObject(struct sceneWriter * w, struct handle h,
+  struct object obj) {
+    // Connections refer back to objects, so every object comes first
+    if (writeFailed(w, w->header.connectionCount == 0))
+        return;
+
+    if (h.index >= w->cap) {
+        uint32_t cap = w->cap ? w->cap : 1024;
+        while (h.index >= cap)
+            cap *= 2;
+        w->written = realloc(w->written, cap * sizeof(*w->written));
+        for (uint32_t i = w->cap; i < cap; i++)
+            w->written[i] = (struct sceneWritten) { STORE_NONE, 0 };
+        w->cap = cap;
+    }
+    w->written[h.index] = (struct sceneWritten) {
+        w->header.objectCount, h.generation
+    };
+
+    struct sceneObjectRecord r = {
+        .x          = obj.x,
+        .y          = obj.y,
+        .radius     = obj.radius,
+        .color      = packColor(obj.color),
+        .label      = writeString(w, obj.label),
+        .type       = obj.type,
+        .sticky     = obj.sticky != 0,
+        .slot       = h.index,
+        .generation = h.generation
+    };
+    writeBuffered(w, w->file, w->records, &w->recordsLen, &r, sizeof(r));
+    w->header.objectCount++;
+} /* sceneWriterObject */
+
+/**
+ * Returns the record index a handle was written at, or STORE_NONE.
+ */
+static uint32_t writtenRecord(struct sceneWriter * w, struct handle h) {
+    if (h.index >= w->cap || w->written[h.index].generation != h.generation)
+        return STORE_NONE;
+    return w->written[h.index].record;
+}
+
+void sceneWriterConnection(struct sceneWriter * w, struct connection con) {
+    uint32_t src  = writtenRecord(w, con.src);
+    uint32_t dest = writtenRecord(w, con.dest);
+
+    // Connections to removed objects have nothing to point at
+    if (src == STORE_NONE || dest == STORE_NONE)
+        return;
+
+    struct sceneConnectionRecord r = {
+        .src   = src,
+        .dest  = dest,
+        .width = con.width,
+        .color = packColor(con.color),
+        .label = writeString(w, con.label)
+    };
+    writeBuffered(w, w->file, w->records, &w->recordsLen, &r, sizeof(r));
+    w->header.connectionCount++;
+}
+
+int sceneWriterClose(struct sceneWriter * w) {
+    int ok = !w->failed
+      && fwrite(w->records, 1, w->recordsLen, w->file) == w->recordsLen;
+
+    // Put the string table after the records, by way of the scratch file if
+    // it didn't all fit in the buffer, then fill in the counts
+    if (w->labelsLen == w->header.stringBytes) {
+        ok = ok && fwrite(w->labels, 1, w->labelsLen, w->file) == w->labelsLen;
+    } else {
+        size_t n;
+        ok = ok
+          && fwrite(w->labels, 1, w->labelsLen, w->strings) == w->labelsLen
+          && fseek(w->strings, 0, SEEK_SET) == 0;
+        while (ok && (n = fread(w->labels, 1, SCENE_WRITER_BUFFER,
+          w->strings)) > 0)
+            ok = fwrite(w->labels, 1, n, w->file) == n;
+        ok = ok && !ferror(w->strings);
+    }
+    ok = ok && fseek(w->file, 0, SEEK_SET) == 0
+      && fwrite(&w->header, sizeof(w->header), 1, w->file) == 1;
+    #ifdef __unix__
+        // On disk before the rename makes it the scene
+        ok = ok && fflush(w->file) == 0 && fsync(fileno(w->file)) == 0;
+    #endif
+    ok = (fclose(w->file) == 0) && ok;
+    fclose(w->strings);
+    free(w->records);
+    free(w->labels);
+    free(w->written);
+
+    if (ok)
+        ok = rename(w->tmpPath, w->path) == 0;
+    else
+        remove(w->tmpPath);
+    return ok ? 0 : -1;
+} /* sceneWriterClose */
+
+int sceneSave(const char * path, struct objectStore * objs,
+  struct connectionStore * cons, uint32_t checkpoint) {
+    struct stringTable strings = { NULL, 0, 0 };
+    struct sceneHeader header  = {
+        .version    = SCENE_VERSION,
+        .checkpoint = checkpoint
+    };
+
+    memcpy(header.magic, SCENE_MAGIC, 4);
+
+    struct sceneObjectRecord * objRecs =
+      malloc((objs->len + 1) * sizeof(struct sceneObjectRecord));
+    struct sceneConnectionRecord * conRecs =
+      malloc((cons->len + 1) * sizeof(struct sceneConnectionRecord));
+
+    // Objects are written in dense order, so a dense position is also the
+    // record index connections refer to
+    for (uint32_t i = 0; i < objs->len; i++) {
+        struct handle h = objectStoreHandle(objs, i);
+        objRecs[i] = (struct sceneObjectRecord) {
+            .x          = OBJECT_FIELD(objs, x, i),
+            .y          = OBJECT_FIELD(objs, y, i),
+            .radius     = OBJECT_FIELD(objs, radius, i),
+            .color      = packColor(OBJECT_FIELD(objs, color, i)),
+            .label      = addString(&strings, OBJECT_FIELD(objs, label, i)),
+            .type       = OBJECT_FIELD(objs, type, i),
+            .sticky     = OBJECT_FIELD(objs, sticky, i),
+            .slot       = h.index,
+            .generation = h.generation
+        };
+    }
+    header.objectCount = objs->len;
+
+    for (uint32_t i = 0; i < cons->len; i++) {
+        uint32_t src  = objectStoreDense(objs, CONNECTION_FIELD(cons, src, i));
+        uint32_t dest = objectStoreDense(objs, CONNECTION_FIELD(cons, dest, i));
+        // Connections to removed objects have nothing to point at
+        if (src == STORE_NONE || dest == STORE_NONE)
+            continue;
+        conRecs[header.connectionCount++] = (struct sceneConnectionRecord) {
+            .src   = src,
+            .dest  = dest,
+            .width = CONNECTION_FIELD(cons, width, i),
+            .color = packColor(CONNECTION_FIELD(cons, color, i)),
+            .label = addString(&strings, CONNECTION_FIELD(cons, label, i))
+        };
+    }
+    header.stringBytes = strings.len;
+
+    char tmpPath[4096];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    int    ok = 0;
+    FILE * f  = fopen(tmpPath, "wb");
+    if (f != NULL) {
+        ok = fwrite(&header, sizeof(header), 1, f) == 1
+          && fwrite(objRecs, sizeof(*objRecs), header.objectCount, f)
+          == header.objectCount
+          && fwrite(conRecs, sizeof(*conRecs), header.connectionCount, f)
+          == header.connectionCount
+          && fwrite(strings.data, 1, strings.len, f) == strings.len;
+        #ifdef __unix__
+            // On disk before the rename makes it the scene
+            ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+        #endif
+        ok = (fclose(f) == 0) && ok;
+    }
+    if (ok)
+        ok = rename(tmpPath, path) == 0;
+    else
+        remove(tmpPath);
+
+    free(objRecs);
+    free(conRecs);
+    free(strings.data);
+    return ok ? 0 : -1;
+} /* sceneSave */
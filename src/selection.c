@@ -0,0 +1,183 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "selection.h"
+
+void selectionInit(struct selection * sel) {
+    memset(sel, 0, sizeof(*sel));
+}
+
+void selectionFree(struct selection * sel) {
+    free(sel->bits);
+    free(sel->slots);
+    free(sel->startY);
+    free(sel->startX);
+    free(sel->y);
+    free(sel->x);
+    selectionInit(sel);
+}
+
+void selectionClear(struct selection * sel) {
+    for (uint32_t i = 0; i < sel->len; i++)
+        sel->bits[sel->slots[i] >> 6] = 0;
+    sel->len = 0;
+}
+
+int selectionContains(struct selection * sel, uint32_t slot) {
+    return (slot >> 6) < sel->words
+           && (sel->bits[slot >> 6] >> (slot & 63) & 1);
+}
+
+void selectionAdd(struct selection * sel, uint32_t slot) {
+    if (selectionContains(sel, slot))
+        return;
+
+    if ((slot >> 6) >= sel->words) {
+        uint32_t words = sel->words ? sel->words : 16;
+        while (words <= (slot >> 6))
+            words *= 2;
+        sel->bits = realloc(sel->bits, words * sizeof(uint64_t));
+        memset(sel->bits + sel->words, 0,
+          (words - sel->words) * sizeof(uint64_t));
+        sel->words = words;
+    }
+
+    if (sel->len == sel->cap) {
+        sel->cap    = sel->cap ? sel->cap * 2 : 256;
+        sel->slots  = realloc(sel->slots, sel->cap * sizeof(uint32_t));
+        sel->startY = realloc(sel->startY, sel->cap * sizeof(int));
+        sel->startX = realloc(sel->startX, sel->cap * sizeof(int));
+        sel->y      = realloc(sel->y, sel->cap * sizeof(int));
+        sel->x      = realloc(sel->x, sel->cap * sizeof(int));
+    }
+
+    sel->bits[slot >> 6] |= (uint64_t) 1 << (slot & 63);
+    sel->slots[sel->len++] = slot;
+}
+
+void selectionRemove(struct selection * sel, uint32_t slot) {
+    if (!selectionContains(sel, slot))
+        return;
+
+    sel->bits[slot >> 6] &= ~((uint64_t) 1 << (slot & 63));
+    for (uint32_t i = 0; i < sel->len; i++) {
+        if (sel->slots[i] != slot)
+            continue;
+        uint32_t last = --sel->len;
+        sel->slots[i]  = sel->slots[last];
+        sel->startY[i] = sel->startY[last];
+        sel->startX[i] = sel->startX[last];
+        sel->y[i]      = sel->y[last];
+        sel->x[i]      = sel->x[last];
+        return;
+    }
+}
+
+/*****************************************************************************
+* Region Queries
+*****************************************************************************/
+
+struct regionQuery {
+    struct selection *            sel;
+    struct objectStore *          objs;
+
+    // Box, which is also the lasso's bounding box
+    int                           minY, minX;
+    int                           maxY, maxX;
+
+    // Lasso, or NULL for just the box
+    const struct selectionPoint * points;
+    uint32_t                      n;
+};
+
+/**
+ * Even-odd test: a point is inside if a ray from it crosses the polygon's
+ * edges an odd number of times.
+ */
+static int insidePolygon(const struct selectionPoint * points, uint32_t n,
+  int y, int x) {
+    int inside = 0;
+
+    for (uint32_t i = 0, j = n - 1; i < n; j = i++) {
+        struct selectionPoint a = points[i];
+        struct selectionPoint b = points[j];
+        if ((a.y > y) != (b.y > y)
+          && x < (float) (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+    return inside;
+}
+
+static void regionVisitor(int id, void * ctx) {
+    struct regionQuery * q = ctx;
+    uint32_t i = q->objs->slots.dense[id];
+    int      y = OBJECT_FIELD(q->objs, y, i);
+    int      x = OBJECT_FIELD(q->objs, x, i);
+
+    if (y < q->minY || y > q->maxY || x < q->minX || x > q->maxX)
+        return;
+    if (q->points != NULL && !insidePolygon(q->points, q->n, y, x))
+        return;
+    selectionAdd(q->sel, id);
+}
+
+void selectBox(struct selection * sel, struct spatialGrid * grid,
+  struct objectStore * objs, int minY, int minX, int maxY, int maxX) {
+    struct regionQuery q = {
+        .sel  = sel,
+        .objs = objs,
+        .minY = minY,
+        .minX = minX,
+        .maxY = maxY,
+        .maxX = maxX
+    };
+
+    spatialGridQuery(grid, minY, minX, maxY, maxX, regionVisitor, &q);
+}
+
+void selectLasso(struct selection * sel, struct spatialGrid * grid,
+  struct objectStore * objs, const struct selectionPoint * points,
+  uint32_t n) {
+    if (n < 3)
+        return;
+
+    struct regionQuery q = {
+        .sel    = sel,
+        .objs   = objs,
+        .minY   = points[0].y,
+        .minX   = points[0].x,
+        .maxY   = points[0].y,
+        .maxX   = points[0].x,
+        .points = points,
+        .n      = n
+    };
+    for (uint32_t i = 1; i < n; i++) {
+        q.minY = points[i].y < q.minY ? points[i].y : q.minY;
+        q.minX = points[i].x < q.minX ? points[i].x : q.minX;
+        q.maxY = points[i].y > q.maxY ? points[i].y : q.maxY;
+        q.maxX = points[i].x > q.maxX ? points[i].x : q.maxX;
+    }
+
+    // Only objects in the bounding box get the polygon test
+    spatialGridQuery(grid, q.minY, q.minX, q.maxY, q.maxX, regionVisitor, &q);
+}
+
+/*****************************************************************************
+* Group Moves
+*****************************************************************************/
+
+void selectionBeginMove(struct selection * sel, struct objectStore * objs) {
+    for (uint32_t i = 0; i < sel->len; i++) {
+        uint32_t dense = objs->slots.dense[sel->slots[i]];
+        sel->startY[i] = OBJECT_FIELD(objs, y, dense);
+        sel->startX[i] = OBJECT_FIELD(objs, x, dense);
+    }
+}
+
+void selectionOffset(struct selection * sel, int dy, int dx) {
+    // Plain arrays in and out, so this compiles to vector adds
+    for (uint32_t i = 0; i < sel->len; i++) {
+        sel->y[i] = sel->startY[i] + dy;
+        sel->x[i] = sel->startX[i] + dx;
+    }
+}
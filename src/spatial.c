@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "spatial.h"
+
+// Grow the bucket table once buckets hold this many entries on average
+#define SPATIAL_MAX_LOAD 4
+
+/**
+ * Floor division, so that cells left of and above the origin line up the
+ * same way as the ones right of and below it.
+ */
+static int cellOf(int position, int cellSize) {
+    int q = position / cellSize;
+
+    if ((position % cellSize != 0) && (position < 0))
+        q--;
+    return q;
+}
+
+static int bucketOf(struct spatialGrid * grid, int cy, int cx) {
+    uint32_t h = ((uint32_t) cy * 73856093u) ^ ((uint32_t) cx * 19349663u);
+
+    return h & (grid->bucketCount - 1);
+}
+
+static void bucketPush(struct spatialBucket * bucket, struct spatialEntry e) {
+    if (bucket->len == bucket->cap) {
+        bucket->cap     = bucket->cap ? bucket->cap * 2 : 4;
+        bucket->entries = realloc(bucket->entries,
+            bucket->cap * sizeof(struct spatialEntry));
+    }
+    bucket->entries[bucket->len++] = e;
+}
+
+static void rehash(struct spatialGrid * grid, int bucketCount) {
+    struct spatialBucket * old = grid->buckets;
+    int oldCount = grid->bucketCount;
+
+    grid->bucketCount = bucketCount;
+    grid->buckets     = calloc(bucketCount, sizeof(struct spatialBucket));
+
+    for (int b = 0; b < oldCount; b++) {
+        for (int i = 0; i < old[b].len; i++) {
+            struct spatialEntry e = old[b].entries[i];
+            bucketPush(&grid->buckets[bucketOf(grid, e.cy, e.cx)], e);
+        }
+        free(old[b].entries);
+    }
+    free(old);
+}
+
+void spatialGridInit(struct spatialGrid * grid, int cellSize, int bucketCount) {
+    int n = 1;
+
+    while (n < bucketCount)
+        n *= 2;
+
+    grid->cellSize    = cellSize;
+    grid->bucketCount = n;
+    grid->buckets     = calloc(n, sizeof(struct spatialBucket));
+    grid->count       = 0;
+}
+
+void spatialGridFree(struct spatialGrid * grid) {
+    for (int b = 0; b < grid->bucketCount; b++)
+        free(grid->buckets[b].entries);
+    free(grid->buckets);
+    grid->buckets     = NULL;
+    grid->bucketCount = 0;
+    grid->count       = 0;
+}
+
+void spatialGridClear(struct spatialGrid * grid) {
+    for (int b = 0; b < grid->bucketCount; b++)
+        grid->buckets[b].len = 0;
+    grid->count = 0;
+}
+
+void spatialGridInsert(struct spatialGrid * grid, int id, int y, int x) {
+    struct spatialEntry e = {
+        .cy = cellOf(y, grid->cellSize),
+        .cx = cellOf(x, grid->cellSize),
+        .id = id
+    };
+
+    if (grid->count >= grid->bucketCount * SPATIAL_MAX_LOAD)
+        rehash(grid, grid->bucketCount * 2);
+
+    bucketPush(&grid->buckets[bucketOf(grid, e.cy, e.cx)], e);
+    grid->count++;
+}
+
+int spatialGridRemove(struct spatialGrid * grid, int id, int y, int x) {
+    int cy = cellOf(y, grid->cellSize);
+    int cx = cellOf(x, grid->cellSize);
+    struct spatialBucket * bucket = &grid->buckets[bucketOf(grid, cy, cx)];
+
+    for (int i = 0; i < bucket->len; i++) {
+        struct spatialEntry * e = &bucket->entries[i];
+        if (e->id == id && e->cy == cy && e->cx == cx) {
+            // Order within a bucket doesn't matter, so swap with the last
+            *e = bucket->entries[--bucket->len];
+            grid->count--;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void spatialGridMove(struct spatialGrid * grid, int id, int oldY, int oldX,
+  int newY, int newX) {
+    if (cellOf(oldY, grid->cellSize) == cellOf(newY, grid->cellSize)
+      && cellOf(oldX, grid->cellSize) == cellOf(newX, grid->cellSize))
+        return;
+
+    spatialGridRemove(grid, id, oldY, oldX);
+    spatialGridInsert(grid, id, newY, newX);
+}
+
+void spatialGridQuery(struct spatialGrid * grid, int minY, int minX, int maxY,
+  int maxX, spatialVisitor visit, void * ctx) {
+    int cy0 = cellOf(minY, grid->cellSize);
+    int cx0 = cellOf(minX, grid->cellSize);
+    int cy1 = cellOf(maxY, grid->cellSize);
+    int cx1 = cellOf(maxX, grid->cellSize);
+    long cells = (long) (cy1 - cy0 + 1) * (cx1 - cx0 + 1);
+
+    // A huge rectangle touches more cells than there are buckets, at which
+    // point walking every bucket once is cheaper than hashing every cell.
+    if (cells > grid->bucketCount) {
+        for (int b = 0; b < grid->bucketCount; b++) {
+            struct spatialBucket * bucket = &grid->buckets[b];
+            for (int i = 0; i < bucket->len; i++) {
+                struct spatialEntry e = bucket->entries[i];
+                if (e.cy >= cy0 && e.cy <= cy1 && e.cx >= cx0 && e.cx <= cx1)
+                    visit(e.id, ctx);
+            }
+        }
+        return;
+    }
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            struct spatialBucket * bucket =
+              &grid->buckets[bucketOf(grid, cy, cx)];
+            for (int i = 0; i < bucket->len; i++) {
+                struct spatialEntry e = bucket->entries[i];
+                if (e.cy == cy && e.cx == cx)
+                    visit(e.id, ctx);
+            }
+        }
+    }
+} /* spatialGridQuery */
@@ -0,0 +1,126 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "rlgl.h"
+#include "spritebatch.h"
+
+// The atlas is two cells by two, a power of two so it can have mipmaps on
+// the web too
+#define ATLAS_SIZE (SPRITE_CELL * 2)
+
+/**
+ * Rasterizes an antialiased circle into the cell at (cellX, cellY). inner
+ * is the radius of the hole, 0 for a disc.
+ */
+static void rasterCircle(Image * img, int cellX, int cellY, float inner) {
+    Color * pixels = img->data;
+    float   centre = SPRITE_CELL / 2.0f;
+
+    for (int y = 0; y < SPRITE_CELL; y++) {
+        for (int x = 0; x < SPRITE_CELL; x++) {
+            float d = hypotf(x + 0.5f - centre, y + 0.5f - centre);
+
+            // Coverage of the pixel, ramping over one pixel at each edge
+            float a = fminf(SPRITE_CIRCLE_RADIUS + 0.5f - d, 1);
+            if (inner > 0)
+                a = fminf(a, d - inner + 0.5f);
+            if (a <= 0)
+                continue;
+            pixels[(cellY + y) * img->width + cellX + x] = (Color) {
+                255, 255, 255, a * 255
+            };
+        }
+    }
+}
+
+static Rectangle cellAt(int cellX, int cellY) {
+    return (Rectangle) {
+        (float) cellX / ATLAS_SIZE, (float) cellY / ATLAS_SIZE,
+        (float) SPRITE_CELL / ATLAS_SIZE, (float) SPRITE_CELL / ATLAS_SIZE
+    };
+}
+
+void spriteBatchInit(struct spriteBatch * batch, const char * imagePath) {
+    Image atlas = GenImageColor(ATLAS_SIZE, ATLAS_SIZE, BLANK);
+
+    rasterCircle(&atlas, 0, 0, 0);
+    rasterCircle(&atlas, SPRITE_CELL, 0,
+      SPRITE_CIRCLE_RADIUS - SPRITE_RING_WIDTH);
+
+    // The sprite is squeezed into its cell if need be, but drawn at the
+    // size it was loaded at
+    Image image = LoadImage(imagePath);
+    batch->imageWidth  = image.width;
+    batch->imageHeight = image.height;
+    if (image.data != NULL) {
+        ImageDraw(&atlas, image,
+          (Rectangle) { 0, 0, image.width, image.height },
+          (Rectangle) { 0, SPRITE_CELL, SPRITE_CELL, SPRITE_CELL }, WHITE);
+        UnloadImage(image);
+    }
+
+    batch->atlas = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+
+    // Mipmaps keep small circles from sparkling when zoomed out
+    GenTextureMipmaps(&batch->atlas);
+    SetTextureFilter(batch->atlas, TEXTURE_FILTER_TRILINEAR);
+
+    batch->cells[SPRITE_DISC]  = cellAt(0, 0);
+    batch->cells[SPRITE_RING]  = cellAt(SPRITE_CELL, 0);
+    batch->cells[SPRITE_IMAGE] = cellAt(0, SPRITE_CELL);
+}
+
+void spriteBatchUnload(struct spriteBatch * batch) {
+    UnloadTexture(batch->atlas);
+}
+
+void spriteBatchBegin(struct spriteBatch * batch) {
+    rlSetTexture(batch->atlas.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0, 0, 1);
+}
+
+void spriteBatchEnd(struct spriteBatch * batch) {
+    rlEnd();
+    rlSetTexture(0);
+}
+
+/**
+ * Adds a quad with corners a (top left), b, c and d going anticlockwise, the
+ * order raylib's own textured quads use.
+ */
+static void quad(Rectangle uv, Color color, Vector2 a, Vector2 b, Vector2 c,
+  Vector2 d) {
+    // Flushes the batch if it's full
+    rlCheckRenderBatchLimit(4);
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    rlTexCoord2f(uv.x, uv.y);
+    rlVertex2f(a.x, a.y);
+    rlTexCoord2f(uv.x, uv.y + uv.height);
+    rlVertex2f(b.x, b.y);
+    rlTexCoord2f(uv.x + uv.width, uv.y + uv.height);
+    rlVertex2f(c.x, c.y);
+    rlTexCoord2f(uv.x + uv.width, uv.y);
+    rlVertex2f(d.x, d.y);
+}
+
+void spriteBatchCircle(struct spriteBatch * batch, enum spriteShape shape,
+  float x, float y, float radius, Color color) {
+    // The circle doesn't fill its cell
+    float h = radius * (SPRITE_CELL / 2.0f) / SPRITE_CIRCLE_RADIUS;
+
+    quad(batch->cells[shape], color,
+      (Vector2) { x - h, y - h }, (Vector2) { x - h, y + h },
+      (Vector2) { x + h, y + h }, (Vector2) { x + h, y - h });
+}
+
+void spriteBatchImage(struct spriteBatch * batch, float x, float y,
+  float scale, Color tint) {
+    float w = batch->imageWidth * scale;
+    float h = batch->imageHeight * scale;
+
+    quad(batch->cells[SPRITE_IMAGE], tint,
+      (Vector2) { x, y }, (Vector2) { x, y - h },
+      (Vector2) { x - w, y - h }, (Vector2) { x - w, y });
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __EMSCRIPTEN__
+# include <emscripten.h>
+#endif
+
+#include "storage.h"
+
+/**
+ * A cached file. data is NULL for a file known not to exist.
+ */
+struct storageEntry {
+    char * name;
+    char * data;
+    size_t len;
+    int    dirty;
+};
+
+static struct storageEntry * entries;
+static size_t entriesLen;
+static size_t entriesCap;
+
+// Set by writes since the last tick
+static int    changed;
+
+// When the cache first got ahead of the disk, and when it last changed
+static double dirtySince  = -1;
+static double lastChange;
+
+// Whether files on disk changed and still have to be persisted
+static int    unsynced;
+
+#ifdef __EMSCRIPTEN__
+EM_JS(void, storage_js_mount, (const char * dir), {
+    var path = UTF8ToString(dir);
+    Module.storageReady   = 0;
+    Module.storageSyncing = 1;
+    FS.mkdir(path);
+    FS.mount(IDBFS, { }, path);
+    FS.syncfs(true, function(err) {
+        if (err)
+            console.error(err);
+        Module.storageReady   = 1;
+        Module.storageSyncing = 0;
+    });
+});
+
+EM_JS(int, storage_js_ready, (), {
+    return Module.storageReady;
+});
+
+EM_JS(int, storage_js_syncing, (), {
+    return Module.storageSyncing;
+});
+
+EM_JS(void, storage_js_sync, (), {
+    Module.storageSyncing = 1;
+    FS.syncfs(false, function(err) {
+        if (err)
+            console.error(err);
+        Module.storageSyncing = 0;
+    });
+});
+#endif /* ifdef __EMSCRIPTEN__ */
+
+void storageInit(void) {
+    #ifdef __EMSCRIPTEN__
+        storage_js_mount(STORAGE_DIR);
+    #endif
+}
+
+int storageReady(void) {
+    #ifdef __EMSCRIPTEN__
+        return storage_js_ready();
+    #else
+        return 1;
+    #endif
+}
+
+int storagePath(char * buf, size_t size, const char * name) {
+    int n = snprintf(buf, size, "%s/%s", STORAGE_DIR, name);
+
+    return n < 0 || (size_t) n >= size ? -1 : 0;
+}
+
+/**
+ * Starts persisting files on disk, unless that is already under way, in
+ * which case the next tick tries again.
+ */
+static void syncFiles(void) {
+    #ifdef __EMSCRIPTEN__
+        if (storage_js_syncing())
+            return;
+        storage_js_sync();
+    #endif
+    unsynced = 0;
+}
+
+static struct storageEntry * findEntry(const char * name) {
+    for (size_t i = 0; i < entriesLen; i++)
+        if (strcmp(entries[i].name, name) == 0)
+            return &entries[i];
+    return NULL;
+}
+
+static struct storageEntry * addEntry(const char * name) {
+    if (entriesLen == entriesCap) {
+        entriesCap = entriesCap ? entriesCap * 2 : 8;
+        entries    = realloc(entries, entriesCap * sizeof(*entries));
+    }
+
+    struct storageEntry * e = &entries[entriesLen++];
+    e->name  = strdup(name);
+    e->data  = NULL;
+    e->len   = 0;
+    e->dirty = 0;
+    return e;
+}
+
+/**
+ * Reads a whole file into a NUL-terminated buffer, or returns NULL.
+ */
+static char * readFile(const char * name, size_t * len) {
+    char path[256];
+
+    if (storagePath(path, sizeof(path), name) != 0)
+        return NULL;
+
+    FILE * f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long   size = ftell(f);
+    char * data = size >= 0 ? malloc(size + 1) : NULL;
+    fseek(f, 0, SEEK_SET);
+    if (data != NULL && fread(data, 1, size, f) != (size_t) size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+
+    if (data != NULL) {
+        data[size] = '\0';
+        *len       = size;
+    }
+    return data;
+}
+
+const char * storageGet(const char * name) {
+    struct storageEntry * e = findEntry(name);
+
+    // Misses are cached too, so asking every frame stays cheap
+    if (e == NULL) {
+        e       = addEntry(name);
+        e->data = readFile(name, &e->len);
+    }
+    return e->data;
+}
+
+void storagePut(const char * name, const char * data, size_t len) {
+    struct storageEntry * e = findEntry(name);
+
+    if (e == NULL)
+        e = addEntry(name);
+
+    free(e->data);
+    e->data = malloc(len + 1);
+    memcpy(e->data, data, len);
+    e->data[len] = '\0';
+    e->len       = len;
+    e->dirty     = 1;
+    changed      = 1;
+}
+
+void storageTouch(void) {
+    unsynced = 1;
+    changed  = 1;
+}
+
+void storageFlush(void) {
+    for (size_t i = 0; i < entriesLen; i++) {
+        struct storageEntry * e = &entries[i];
+        char   path[256];
+
+        if (!e->dirty || storagePath(path, sizeof(path), e->name) != 0)
+            continue;
+
+        FILE * f = fopen(path, "wb");
+        if (f == NULL) {
+            fprintf(stderr, "Could not write %s\n", path);
+            continue;
+        }
+        fwrite(e->data, 1, e->len, f);
+        fclose(f);
+        e->dirty = 0;
+        unsynced = 1;
+    }
+
+    dirtySince = -1;
+    if (unsynced)
+        syncFiles();
+}
+
+void storageTick(double now) {
+    if (changed) {
+        if (dirtySince < 0)
+            dirtySince = now;
+        lastChange = now;
+        changed    = 0;
+    }
+
+    if (dirtySince >= 0
+      && ((now - lastChange) * 1000 >= STORAGE_FLUSH_MS
+      || (now - dirtySince) * 1000 >= STORAGE_MAX_DELAY_MS))
+        storageFlush();
+    else if (dirtySince < 0 && unsynced)
+        // A sync that was already under way when we flushed
+        syncFiles();
+}
+
+void storageClose(void) {
+    storageFlush();
+    for (size_t i = 0; i < entriesLen; i++) {
+        free(entries[i].name);
+        free(entries[i].data);
+    }
+    free(entries);
+    entries    = NULL;
+    entriesLen = 0;
+    entriesCap = 0;
+}
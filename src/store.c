@@ -0,0 +1,377 @@
+#include <stdlib.h>
+
+#include "store.h"
+
+// prevFree of a slot that isn't on the free list
+#define SLOT_IN_USE (STORE_NONE - 1)
+
+/*****************************************************************************
+* Slot Table
+*****************************************************************************/
+
+static void slotsInit(struct slotTable * slots) {
+    slots->generation = NULL;
+    slots->dense      = NULL;
+    slots->prevFree   = NULL;
+    slots->len        = 0;
+    slots->cap        = 0;
+    slots->freeHead   = STORE_NONE;
+}
+
+static void slotsFree(struct slotTable * slots) {
+    free(slots->generation);
+    free(slots->dense);
+    free(slots->prevFree);
+    slotsInit(slots);
+}
+
+/**
+ * Makes room for slot index in the table.
+ */
+static void slotsReserve(struct slotTable * slots, uint32_t index) {
+    if (index < slots->cap)
+        return;
+    while (index >= slots->cap)
+        slots->cap = slots->cap ? slots->cap * 2 : 64;
+    slots->generation = realloc(slots->generation,
+        slots->cap * sizeof(uint32_t));
+    slots->dense    = realloc(slots->dense, slots->cap * sizeof(uint32_t));
+    slots->prevFree = realloc(slots->prevFree, slots->cap * sizeof(uint32_t));
+}
+
+/**
+ * Puts a slot at the head of the free list.
+ */
+static void slotsPushFree(struct slotTable * slots, uint32_t index) {
+    if (slots->freeHead != STORE_NONE)
+        slots->prevFree[slots->freeHead] = index;
+    slots->prevFree[index] = STORE_NONE;
+    slots->dense[index]    = slots->freeHead;
+    slots->freeHead        = index;
+}
+
+/**
+ * Takes a free slot off the free list, wherever it is on it.
+ */
+static void slotsUnlinkFree(struct slotTable * slots, uint32_t index) {
+    uint32_t prev = slots->prevFree[index];
+    uint32_t next = slots->dense[index];
+
+    if (prev == STORE_NONE)
+        slots->freeHead = next;
+    else
+        slots->dense[prev] = next;
+    if (next != STORE_NONE)
+        slots->prevFree[next] = prev;
+    slots->prevFree[index] = SLOT_IN_USE;
+}
+
+/**
+ * Takes a slot off the free list, or appends a new one, and points it at the
+ * given dense position.
+ */
+static struct handle slotsAcquire(struct slotTable * slots, uint32_t dense) {
+    uint32_t index;
+
+    if (slots->freeHead != STORE_NONE) {
+        index = slots->freeHead;
+        slotsUnlinkFree(slots, index);
+    } else {
+        slotsReserve(slots, slots->len);
+        index = slots->len++;
+        slots->generation[index] = 0;
+        slots->prevFree[index]   = SLOT_IN_USE;
+    }
+
+    slots->dense[index] = dense;
+    return (struct handle) { index, slots->generation[index] };
+}
+
+/**
+ * Takes the exact slot and generation of h, which must be free or past the
+ * end of the table, and points it at the given dense position. Slots skipped
+ * over on the way go on the free list. Returns 0 if the slot is in use.
+ */
+static int slotsClaim(struct slotTable * slots, struct handle h,
+  uint32_t dense) {
+    if (h.index == STORE_NONE)
+        return 0;
+
+    if (h.index >= slots->len) {
+        slotsReserve(slots, h.index);
+        while (slots->len < h.index) {
+            slots->generation[slots->len] = 0;
+            slotsPushFree(slots, slots->len++);
+        }
+        slots->len++;
+        slots->prevFree[h.index] = SLOT_IN_USE;
+    } else {
+        if (slots->prevFree[h.index] == SLOT_IN_USE)
+            return 0;
+        slotsUnlinkFree(slots, h.index);
+    }
+
+    slots->generation[h.index] = h.generation;
+    slots->dense[h.index]      = dense;
+    return 1;
+}
+
+/**
+ * Returns the dense position of a live handle, or STORE_NONE.
+ */
+static uint32_t slotsLookup(struct slotTable * slots, struct handle h) {
+    if (h.index >= slots->len || slots->generation[h.index] != h.generation)
+        return STORE_NONE;
+    return slots->dense[h.index];
+}
+
+/**
+ * Bumps the slot's generation so old handles go stale, and frees it.
+ */
+static void slotsRelease(struct slotTable * slots, uint32_t index) {
+    slots->generation[index]++;
+    slotsPushFree(slots, index);
+}
+
+/**
+ * Makes sure the chunk holding dense position len exists.
+ */
+static void ensureChunk(void *** chunks, uint32_t * chunkCount, uint32_t len,
+  size_t chunkSize) {
+    uint32_t needed = (len >> STORE_CHUNK_SHIFT) + 1;
+
+    if (needed <= *chunkCount)
+        return;
+
+    // Only the array of chunk pointers moves; chunk contents stay put
+    *chunks = realloc(*chunks, needed * sizeof(void *));
+    while (*chunkCount < needed)
+        (*chunks)[(*chunkCount)++] = malloc(chunkSize);
+}
+
+int handleEqual(struct handle a, struct handle b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+/*****************************************************************************
+* Object Store
+*****************************************************************************/
+
+void objectStoreInit(struct objectStore * store) {
+    slotsInit(&store->slots);
+    store->chunks     = NULL;
+    store->chunkCount = 0;
+    store->len        = 0;
+}
+
+void objectStoreFree(struct objectStore * store) {
+    for (uint32_t c = 0; c < store->chunkCount; c++)
+        free(store->chunks[c]);
+    free(store->chunks);
+    slotsFree(&store->slots);
+    objectStoreInit(store);
+}
+
+/**
+ * Writes obj into a new dense position owned by slot h.index.
+ */
+static void objectStoreFill(struct objectStore * store, uint32_t dense,
+  struct handle h, struct object obj) {
+    OBJECT_FIELD(store, x, dense)      = obj.x;
+    OBJECT_FIELD(store, y, dense)      = obj.y;
+    OBJECT_FIELD(store, radius, dense) = obj.radius;
+    OBJECT_FIELD(store, color, dense)  = obj.color;
+    OBJECT_FIELD(store, type, dense)   = obj.type;
+    OBJECT_FIELD(store, sticky, dense) = obj.sticky != 0;
+    OBJECT_FIELD(store, label, dense)  = obj.label;
+    OBJECT_FIELD(store, slot, dense)   = h.index;
+}
+
+struct handle objectStoreAdd(struct objectStore * store, struct object obj) {
+    ensureChunk((void ***) &store->chunks, &store->chunkCount, store->len,
+      sizeof(struct objectChunk));
+
+    uint32_t dense  = store->len++;
+    struct handle h = slotsAcquire(&store->slots, dense);
+
+    objectStoreFill(store, dense, h, obj);
+    return h;
+}
+
+struct handle objectStoreAddAt(struct objectStore * store, struct handle h,
+  struct object obj) {
+    ensureChunk((void ***) &store->chunks, &store->chunkCount, store->len,
+      sizeof(struct objectChunk));
+
+    if (!slotsClaim(&store->slots, h, store->len))
+        return NULL_HANDLE;
+
+    objectStoreFill(store, store->len++, h, obj);
+    return h;
+}
+
+/**
+ * Takes the object at a dense position out of the arrays by moving the last
+ * one into its place. Its slot is left for the caller to deal with.
+ */
+static void objectStoreUnlink(struct objectStore * store, uint32_t dense) {
+    uint32_t last = --store->len;
+
+    if (dense != last) {
+        OBJECT_FIELD(store, x, dense)      = OBJECT_FIELD(store, x, last);
+        OBJECT_FIELD(store, y, dense)      = OBJECT_FIELD(store, y, last);
+        OBJECT_FIELD(store, radius, dense) = OBJECT_FIELD(store, radius, last);
+        OBJECT_FIELD(store, color, dense)  = OBJECT_FIELD(store, color, last);
+        OBJECT_FIELD(store, type, dense)   = OBJECT_FIELD(store, type, last);
+        OBJECT_FIELD(store, sticky, dense) = OBJECT_FIELD(store, sticky, last);
+        OBJECT_FIELD(store, label, dense)  = OBJECT_FIELD(store, label, last);
+        OBJECT_FIELD(store, slot, dense)   = OBJECT_FIELD(store, slot, last);
+        store->slots.dense[OBJECT_FIELD(store, slot, dense)] = dense;
+    }
+}
+
+int objectStoreRemove(struct objectStore * store, struct handle h) {
+    uint32_t dense = slotsLookup(&store->slots, h);
+
+    if (dense == STORE_NONE)
+        return 0;
+
+    objectStoreUnlink(store, dense);
+    slotsRelease(&store->slots, h.index);
+    return 1;
+}
+
+int objectStoreEvict(struct objectStore * store, struct handle h) {
+    uint32_t dense = slotsLookup(&store->slots, h);
+
+    if (dense == STORE_NONE)
+        return 0;
+
+    // Neither freed nor bumped, so nothing else gets the slot and h is
+    // good again once the object is restored
+    objectStoreUnlink(store, dense);
+    store->slots.dense[h.index] = STORE_NONE;
+    return 1;
+}
+
+int objectStoreRestore(struct objectStore * store, struct handle h,
+  struct object obj) {
+    if (h.index >= store->slots.len
+      || store->slots.generation[h.index] != h.generation
+      || store->slots.dense[h.index] != STORE_NONE)
+        return 0;
+
+    ensureChunk((void ***) &store->chunks, &store->chunkCount, store->len,
+      sizeof(struct objectChunk));
+    store->slots.dense[h.index] = store->len;
+    objectStoreFill(store, store->len++, h, obj);
+    return 1;
+}
+
+struct handle objectStoreReserve(struct objectStore * store,
+  struct handle h) {
+    if (slotsClaim(&store->slots, h, STORE_NONE))
+        return h;
+    return slotsAcquire(&store->slots, STORE_NONE);
+}
+
+uint32_t objectStoreDense(struct objectStore * store, struct handle h) {
+    return slotsLookup(&store->slots, h);
+}
+
+struct handle objectStoreHandle(struct objectStore * store, uint32_t dense) {
+    uint32_t slot = OBJECT_FIELD(store, slot, dense);
+
+    return (struct handle) { slot, store->slots.generation[slot] };
+}
+
+struct handle objectStoreSlotHandle(struct objectStore * store, uint32_t slot) {
+    struct handle h;
+
+    if (slot >= store->slots.len)
+        return NULL_HANDLE;
+
+    h = (struct handle) { slot, store->slots.generation[slot] };
+    if (slotsLookup(&store->slots, h) >= store->len)
+        return NULL_HANDLE;
+
+    // A free slot's dense field is a free list link, which can look like a
+    // valid position, so confirm the dense element points back at us.
+    if (OBJECT_FIELD(store, slot, store->slots.dense[slot]) != slot)
+        return NULL_HANDLE;
+    return h;
+}
+
+/*****************************************************************************
+* Connection Store
+*****************************************************************************/
+
+void connectionStoreInit(struct connectionStore * store) {
+    slotsInit(&store->slots);
+    store->chunks     = NULL;
+    store->chunkCount = 0;
+    store->len        = 0;
+}
+
+void connectionStoreFree(struct connectionStore * store) {
+    for (uint32_t c = 0; c < store->chunkCount; c++)
+        free(store->chunks[c]);
+    free(store->chunks);
+    slotsFree(&store->slots);
+    connectionStoreInit(store);
+}
+
+struct handle connectionStoreAdd(struct connectionStore * store,
+  struct connection con) {
+    ensureChunk((void ***) &store->chunks, &store->chunkCount, store->len,
+      sizeof(struct connectionChunk));
+
+    uint32_t dense  = store->len++;
+    struct handle h = slotsAcquire(&store->slots, dense);
+
+    CONNECTION_FIELD(store, src, dense)   = con.src;
+    CONNECTION_FIELD(store, dest, dense)  = con.dest;
+    CONNECTION_FIELD(store, width, dense) = con.width;
+    CONNECTION_FIELD(store, color, dense) = con.color;
+    CONNECTION_FIELD(store, label, dense) = con.label;
+    CONNECTION_FIELD(store, slot, dense)  = h.index;
+
+    return h;
+}
+
+int connectionStoreRemove(struct connectionStore * store, struct handle h) {
+    uint32_t dense = slotsLookup(&store->slots, h);
+
+    if (dense == STORE_NONE)
+        return 0;
+
+    uint32_t last = --store->len;
+    if (dense != last) {
+        CONNECTION_FIELD(store, src, dense) = CONNECTION_FIELD(store, src, last);
+        CONNECTION_FIELD(store, dest, dense) =
+          CONNECTION_FIELD(store, dest, last);
+        CONNECTION_FIELD(store, width, dense) =
+          CONNECTION_FIELD(store, width, last);
+        CONNECTION_FIELD(store, color, dense) =
+          CONNECTION_FIELD(store, color, last);
+        CONNECTION_FIELD(store, label, dense) =
+          CONNECTION_FIELD(store, label, last);
+        CONNECTION_FIELD(store, slot, dense) =
+          CONNECTION_FIELD(store, slot, last);
+        store->slots.dense[CONNECTION_FIELD(store, slot, dense)] = dense;
+    }
+
+    slotsRelease(&store->slots, h.index);
+    return 1;
+}
+
+uint32_t connectionStoreDense(struct connectionStore * store, struct handle h) {
+    return slotsLookup(&store->slots, h);
+}
+
+struct handle connectionStoreHandle(struct connectionStore * store,
+  uint32_t dense) {
+    uint32_t slot = CONNECTION_FIELD(store, slot, dense);
+
+    return (struct handle) { slot, store->slots.generation[slot] };
+}
@@ -0,0 +1,136 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synth.h"
+
+#define SYNTH_BLOBS       64
+#define SYNTH_BLOB_SPREAD 0.02f
+
+/**
+ * xorshift32, so scenes come out the same on every platform
+ */
+static uint32_t nextRandom(uint32_t * state) {
+    uint32_t x = *state;
+
+    x     ^= x << 13;
+    x     ^= x >> 17;
+    x     ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static float randomUnit(uint32_t * state) {
+    return (nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * Roughly normal, by summing uniforms
+ */
+static float randomNormal(uint32_t * state) {
+    return randomUnit(state) + randomUnit(state) + randomUnit(state)
+           + randomUnit(state) - 2.0f;
+}
+
+void synthGenerate(struct synthParams * params, struct objectStore * objs,
+  struct connectionStore * cons, struct stringArena * labels) {
+    uint32_t state = params->seed ? params->seed : 1;
+    int      world = params->worldSize;
+    struct handle * handles = malloc(
+        (params->objects + 1) * sizeof(struct handle));
+
+    // Uniform scenes use a jittered grid in index order, so objects with
+    // neighbouring indices are neighbours on the plane too
+    uint32_t cols = ceilf(sqrtf(params->objects > 0 ? params->objects : 1));
+    float    cell = (float) world / cols;
+
+    float blobY[SYNTH_BLOBS];
+    float blobX[SYNTH_BLOBS];
+    for (int b = 0; b < SYNTH_BLOBS; b++) {
+        blobY[b] = randomUnit(&state) * world;
+        blobX[b] = randomUnit(&state) * world;
+    }
+
+    for (uint32_t i = 0; i < params->objects; i++) {
+        int y, x;
+        if (params->shape == SYNTH_CLUSTERED) {
+            // Objects are dealt out to blobs in turn, so that consecutive
+            // indices land in different blobs and i % SYNTH_BLOBS is the blob
+            int b = i % SYNTH_BLOBS;
+            y = blobY[b] + randomNormal(&state) * world * SYNTH_BLOB_SPREAD;
+            x = blobX[b] + randomNormal(&state) * world * SYNTH_BLOB_SPREAD;
+        } else if (params->shape == SYNTH_UNIFORM) {
+            y = (i / cols + randomUnit(&state)) * cell;
+            x = (i % cols + randomUnit(&state)) * cell;
+        } else {
+            y = randomUnit(&state) * world;
+            x = randomUnit(&state) * world;
+        }
+
+        const char * label = NULL;
+        if (params->labels) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "Object %u", i + 1);
+            label = stringArenaIntern(labels, buf);
+        }
+
+        handles[i] = objectStoreAdd(objs, (struct object) {
+            .type   = DOT,
+            .sticky = 0,
+            .label  = label,
+            .radius = 10,
+            .color  = (Color) {
+                10 + nextRandom(&state) % 245,
+                10 + nextRandom(&state) % 245,
+                10 + nextRandom(&state) % 245,
+                255
+            },
+            .y = y,
+            .x = x
+        });
+    }
+
+    for (uint32_t i = 0; i < params->connections && params->objects > 1; i++) {
+        uint32_t src = nextRandom(&state) % params->objects;
+        uint32_t dest;
+        switch (params->shape) {
+            case SYNTH_UNIFORM:
+                // The next object along, or the one below on the grid
+                dest = (src + (nextRandom(&state) % 2 ? 1 : cols)) %
+                  params->objects;
+                break;
+            case SYNTH_CLUSTERED:
+                // Same blob: step by a multiple of the blob count
+                dest = (src + SYNTH_BLOBS *
+                  (1 + nextRandom(&state) % 16)) % params->objects;
+                break;
+            case SYNTH_LONG_EDGES:
+            default:
+                dest = nextRandom(&state) % params->objects;
+                break;
+        }
+        if (dest == src)
+            dest = (src + 1) % params->objects;
+
+        connectionStoreAdd(cons, (struct connection) {
+            .label = NULL,
+            .width = 1,
+            .color = BLACK,
+            .src   = handles[src],
+            .dest  = handles[dest]
+        });
+    }
+
+    free(handles);
+} /* synthGenerate */
+
+int synthShapeFromName(const char * name) {
+    if (strcmp(name, "uniform") == 0)
+        return SYNTH_UNIFORM;
+    if (strcmp(name, "clustered") == 0)
+        return SYNTH_CLUSTERED;
+    if (strcmp(name, "long") == 0)
+        return SYNTH_LONG_EDGES;
+    return -1;
+}
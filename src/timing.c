@@ -0,0 +1,14 @@
+#include <time.h>
+
+#include "timing.h"
+
+uint64_t monotonicNanos(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+double monotonicSeconds(void) {
+    return monotonicNanos() * 1e-9;
+}
@@ -1,7 +1,13 @@
+#include <math.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #include "viewport.h"
 
 int projectY(struct viewport * vp, int positionY) {
-    return vp->h - (positionY - vp->y);
+    return vp->h - (positionY - vp->y) * vp->scale;
 }
 
 int clampProjectY(struct viewport * vp, int positionY, int clamp) {
@@ -9,15 +15,15 @@ int clampProjectY(struct viewport * vp, int positionY, int clamp) {
     if (positionY < vp->y)
         return clamp ? vp->h - BORDER_MARGIN : -1000;
     // Case: positionY is below the screen => clamp to bottom border
-    else if (positionY > vp->y + vp->h)
+    else if (positionY > vp->y + worldHeight(vp))
         return clamp ? BORDER_MARGIN : -1000;
     // Case: positionY is on screen
     else
-        return vp->h - (positionY - vp->y);
+        return projectY(vp, positionY);
 }
 
 int projectX(struct viewport * vp, int positionX) {
-    return positionX - vp->x;
+    return (positionX - vp->x) * vp->scale;
 }
 
 int clampProjectX(struct viewport * vp, int positionX, int clamp) {
@@ -25,16 +31,108 @@ int clampProjectX(struct viewport * vp, int positionX, int clamp) {
     if (positionX < vp->x)
         return clamp ? BORDER_MARGIN : -1000;
     // Case: positionX is right of the screen => clamp to right border
-    else if (positionX > vp->x + vp->w)
+    else if (positionX > vp->x + worldWidth(vp))
         return clamp ? vp->w - BORDER_MARGIN : -1000;
     // Case: positionX is on screen
     else
         return projectX(vp, positionX);
 }
 
+void projectBatch(struct viewport * vp, const int * ys, const int * xs,
+  const int * radius, uint32_t n, int margin, float * outY, float * outX,
+  uint8_t * visible) {
+    uint32_t i = 0;
+
+    #ifdef __SSE2__
+        __m128i originY = _mm_set1_epi32(vp->y);
+        __m128i originX = _mm_set1_epi32(vp->x);
+        __m128  scale   = _mm_set1_ps(vp->scale);
+        __m128  height  = _mm_set1_ps(vp->h);
+        __m128  width   = _mm_set1_ps(vp->w);
+        __m128  pad     = _mm_set1_ps(margin);
+        __m128  zero    = _mm_setzero_ps();
+
+        for (; i + 4 <= n; i += 4) {
+            __m128 dy = _mm_cvtepi32_ps(_mm_sub_epi32(
+                  _mm_loadu_si128((const __m128i *) (ys + i)), originY));
+            __m128 dx = _mm_cvtepi32_ps(_mm_sub_epi32(
+                  _mm_loadu_si128((const __m128i *) (xs + i)), originX));
+
+            // Truncated to whole pixels like the scalar versions' int
+            // results
+            __m128 y = _mm_cvtepi32_ps(_mm_cvttps_epi32(
+                  _mm_sub_ps(height, _mm_mul_ps(dy, scale))));
+            __m128 x = _mm_cvtepi32_ps(_mm_cvttps_epi32(
+                  _mm_mul_ps(dx, scale)));
+            _mm_storeu_ps(outY + i, y);
+            _mm_storeu_ps(outX + i, x);
+
+            __m128 extent = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(
+                  _mm_loadu_si128((const __m128i *) (radius + i))), scale),
+                pad);
+            __m128 in = _mm_and_ps(
+                _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(x, extent), zero),
+                _mm_cmple_ps(_mm_sub_ps(x, extent), width)),
+                _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(y, extent), zero),
+                _mm_cmple_ps(_mm_sub_ps(y, extent), height)));
+
+            int mask = _mm_movemask_ps(in);
+            visible[i]     = mask & 1;
+            visible[i + 1] = (mask >> 1) & 1;
+            visible[i + 2] = (mask >> 2) & 1;
+            visible[i + 3] = (mask >> 3) & 1;
+        }
+    #endif /* ifdef __SSE2__ */
+
+    for (; i < n; i++) {
+        float y      = projectY(vp, ys[i]);
+        float x      = projectX(vp, xs[i]);
+        float extent = radius[i] * vp->scale + margin;
+        outY[i]    = y;
+        outX[i]    = x;
+        visible[i] = x + extent >= 0 && x - extent <= vp->w
+                     && y + extent >= 0 && y - extent <= vp->h;
+    }
+} /* projectBatch */
+
 int positionVisible(struct viewport * vp, int y, int x) {
-    int yInRange = (y >= 0 + vp->y) && (y <= (vp->y + vp->h));
-    int xInRange = (x >= 0 + vp->x) && (x <= (vp->x + vp->w));
+    int yInRange = (y >= 0 + vp->y) && (y <= (vp->y + worldHeight(vp)));
+    int xInRange = (x >= 0 + vp->x) && (x <= (vp->x + worldWidth(vp)));
 
     return yInRange && xInRange;
 }
+
+int unprojectX(struct viewport * vp, int screenX) {
+    return vp->x + floorf(screenX / vp->scale);
+}
+
+int unprojectY(struct viewport * vp, int screenY) {
+    return vp->y + floorf(screenY / vp->scale);
+}
+
+int worldWidth(struct viewport * vp) {
+    return vp->w / vp->scale;
+}
+
+int worldHeight(struct viewport * vp) {
+    return vp->h / vp->scale;
+}
+
+void zoomAt(struct viewport * vp, float factor, int screenY, int screenX) {
+    // World point under the cursor, which should stay under it
+    float wy = vp->y + screenY / vp->scale;
+    float wx = vp->x + screenX / vp->scale;
+
+    float scale = roundf(vp->scale * factor * 100) / 100;
+    // Always move at least one step, or small factors would get stuck
+    if (scale == vp->scale)
+        scale += factor > 1 ? 0.01f : -0.01f;
+    if (scale < MIN_ZOOM)
+        scale = MIN_ZOOM;
+    if (scale > MAX_ZOOM)
+        scale = MAX_ZOOM;
+
+    vp->scale = scale;
+    vp->y     = roundf(wy - screenY / scale);
+    vp->x     = roundf(wx - screenX / scale);
+}